@@ -207,6 +207,9 @@ module grid_tb();
     .imem_dina(imem_dina),
     .imem_wea(imem_wea),
     .imem_addra(imem_addra),
+    .lockstep_we(1'b0),
+    .lockstep_pe('0),
+    .lockstep_leader('0),
     .host_load_store_data_req(host_load_store_data_req),
     .host_load_store_req(host_load_store_req),
     .host_dmem_addr(host_dmem_addr),
@@ -214,7 +217,13 @@ module grid_tb();
 
     .host_load_store_grant_i(host_load_store_grant_i),
     .host_data_req_valid_i(host_data_req_valid_i),
-    .host_dmem_out(host_dmem_out)
+    .host_dmem_out(host_dmem_out),
+    .host_burst_req(1'b0),
+    .host_burst_we(1'b0),
+    .host_burst_lane_ena('0),
+    .host_burst_row('0),
+    .host_burst_din('0),
+    .host_burst_dout()
   );
 
   // Clock Generation
@@ -77,6 +77,7 @@ module grid # (
     output  logic [(N_R*N_C)-1:0][31:0] dmem_addr,
     output  logic [(N_R*N_C)-1:0][31:0] dmem_din, // data in to mem 
     input   logic [(N_R*N_C)-1:0][31:0] dmem_dout, // data out from mem 
+    input   logic [(N_R*N_C)-1:0][31:0] dmem_dout_hi, // second word of psrf.ld2
     output  logic [(N_R*N_C)-1:0][3:0]  dmem_we,
     output  logic [(N_R*N_C)-1:0]       dmem_en, 
 
@@ -85,6 +86,7 @@ module grid # (
     input  logic [(N_R*N_C)-1:0]        data_req_valid_i,
     output logic [(N_R*N_C)-1:0]        load_store_req, 
     output logic [(N_R*N_C)-1:0]        load_store_data_req,
+    output logic [(N_R*N_C)-1:0]        load_store_pair_req, // psrf.ld2
 
     // zero tcdm interface
     output logic [(N_R*N_C)-1:0][31:0]  zero_pe_dmem_addr,
@@ -97,11 +99,17 @@ module grid # (
     input  logic [(N_R*N_C)-1:0]        zero_pe_reg_we,
     input  logic [(N_R*N_C)-1:0][31:0]  zero_pe_data,
 
+    // lockstep groups, a follower executes the fetch of its leader
+    input  logic [(N_R*N_C)-1:0]                      lockstep_follow,
+    input  logic [(N_R*N_C)-1:0][$clog2(N_R*N_C)-1:0] lockstep_leader,
+
     // analsis signals 
     output logic [(N_R*N_C)-1:0]       dbg_finish,
     output logic [(N_R*N_C)-1:0][31:0] dbg_ic, 
     output logic [(N_R*N_C)-1:0][31:0] dbg_ic_trap, 
-    output logic [(N_R*N_C)-1:0][31:0] dbg_mem_conflict
+    output logic [(N_R*N_C)-1:0][31:0] dbg_mem_conflict,
+    output logic [(N_R*N_C)-1:0][31:0] dbg_ld2,
+    output logic [(N_R*N_C)-1:0][31:0] dbg_lb_hit
 ); 
 
 
@@ -151,6 +159,25 @@ always @(*) begin
   end
 end
 
+// Lockstep: the PEs following one leader and the leader form a group. They
+// share its fetched instruction and, through grid_mask, stall on each other's
+// memory accesses, so they leave every load or store in the same cycle.
+logic [n_pe-1:0][31:0] fetched_inst, lockstep_inst; 
+logic [n_pe-1:0][$clog2(n_pe)-1:0] lockstep_group; 
+logic [n_pe-1:0][n_pe-1:0] lockstep_mask; 
+integer mm; 
+always @(*) begin
+  for (kk = 0; kk<n_pe; kk++) begin
+    lockstep_group[kk] = lockstep_follow[kk] ? lockstep_leader[kk] : kk[$clog2(n_pe)-1:0];
+    lockstep_inst[kk] = fetched_inst[lockstep_leader[kk]];
+  end
+  for (kk = 0; kk<n_pe; kk++) begin
+    for (mm = 0; mm<n_pe; mm++) begin
+      lockstep_mask[kk][mm] = (lockstep_group[kk] == lockstep_group[mm]);
+    end
+  end
+end
+
 logic [n_pe-1:0][n_pe-1:0] masked_cond;
 
 genvar k;
@@ -223,6 +250,7 @@ generate
           .dmem_addr(dmem_addr_temp[i*N_C + j]),
           .dmem_din(dmem_din[i*N_C + j]), // data to mem
           .dmem_dout(dmem_dout[i*N_C + j]), 
+          .dmem_dout_hi(dmem_dout_hi[i*N_C + j]), 
           .dmem_we(dmem_we[i*N_C + j]),
           .dmem_en(dmem_en[i*N_C + j]),
 
@@ -238,13 +266,21 @@ generate
           .zero_pe_reg_we(zero_pe_reg_we[i*N_C + j]),
           .zero_pe_data(zero_pe_data[0]),
 
+          .lockstep_follow(lockstep_follow[i*N_C + j]),
+          .lockstep_inst(lockstep_inst[i*N_C + j]),
+          .lockstep_mask(lockstep_mask[i*N_C + j]),
+          .fetched_inst(fetched_inst[i*N_C + j]),
+
           .load_store_grant_i(load_store_grant_i[i*N_C + j]), 
           .data_req_valid_i(data_req_valid_i[i*N_C + j]), 
           .load_store_req(load_store_req[i*N_C + j]), 
           .load_store_data_req(load_store_data_req[i*N_C + j]),
+          .load_store_pair_req(load_store_pair_req[i*N_C + j]),
           .dbg_mem_conflict(dbg_mem_conflict[i*N_C + j]),
           .dbg_ic(dbg_ic[i*N_C + j]),
-          .dbg_ic_trap(dbg_ic_trap[i*N_C + j])
+          .dbg_ic_trap(dbg_ic_trap[i*N_C + j]),
+          .dbg_ld2(dbg_ld2[i*N_C + j]),
+          .dbg_lb_hit(dbg_lb_hit[i*N_C + j])
         );
       end else begin
         for (k = 0; k < n_pe; k = k + 1) begin : gen_mask
@@ -291,6 +327,7 @@ generate
           .dmem_addr(dmem_addr_temp[i*N_C + j]),
           .dmem_din(dmem_din[i*N_C + j]), // data to mem
           .dmem_dout(dmem_dout[i*N_C + j]), 
+          .dmem_dout_hi(dmem_dout_hi[i*N_C + j]), 
           .dmem_we(dmem_we[i*N_C + j]),
           .dmem_en(dmem_en[i*N_C + j]),
 
@@ -303,14 +340,22 @@ generate
 
           .zero_pe_reg_we(zero_pe_reg_we[i*N_C + j]),
           .zero_pe_data(zero_pe_data[0]),
+
+          .lockstep_follow(lockstep_follow[i*N_C + j]),
+          .lockstep_inst(lockstep_inst[i*N_C + j]),
+          .lockstep_mask(lockstep_mask[i*N_C + j]),
+          .fetched_inst(fetched_inst[i*N_C + j]),
           
           .load_store_grant_i(load_store_grant_i[i*N_C + j]), 
           .data_req_valid_i(data_req_valid_i[i*N_C + j]), 
           .load_store_req(load_store_req[i*N_C + j]), 
           .load_store_data_req(load_store_data_req[i*N_C + j]),
+          .load_store_pair_req(load_store_pair_req[i*N_C + j]),
           .dbg_mem_conflict(dbg_mem_conflict[i*N_C + j]), 
           .dbg_ic(dbg_ic[i*N_C + j]),
-          .dbg_ic_trap(dbg_ic_trap[i*N_C + j])
+          .dbg_ic_trap(dbg_ic_trap[i*N_C + j]),
+          .dbg_ld2(dbg_ld2[i*N_C + j]),
+          .dbg_lb_hit(dbg_lb_hit[i*N_C + j])
         );
       end
     end
@@ -665,7 +665,7 @@ module agu #(
 
 
   // sw 3'b100 sw
-  assign is_psrf_lw = ((inst_x[14:12] == 3'b111 || inst_x[14:12] == 3'b0) && is_lw) ? 1:0;
+  assign is_psrf_lw = ((inst_x[14:12] == 3'b111 || inst_x[14:12] == 3'b0 || inst_x[14:12] == 3'b011) && is_lw) ? 1:0;
   assign is_psrf_sw = ((inst_x[14:12] == 3'b100 || inst_x[14:12] == 3'b0) && is_sw) ? 1:0; 
   assign is_psrf_zd_lw = ((inst_x[14:12] == 3'b110) && is_lw) ? 1:0;
 
@@ -41,6 +41,9 @@
 //       * 9 : AND
 //       * 10: Pass Immediate (`rs2`)
 //       * 11: Multiplication (`rs1[15:0] * rs2[15:0]`)
+//       * 12: Multiply-accumulate (`acc + rs1 * rs2`, low 32 bits)
+//       * 13: Fixed-point multiply-accumulate (`acc` plus the `mul` product)
+//       * 14: Packed int8 dot product (`acc` plus the four signed byte products)
 //       * Default: Addition
 //   - Handles signed and unsigned operations for comparison and shifting.
 //   - Considered the lower 5 bits of `rs2` for shift operations.
@@ -55,6 +58,7 @@ module alu (
     input [31:0] rs1,
     input [31:0] rs2,
     input [3:0] alu_sel,
+    input [31:0] acc, // rd of mac/mac.fxp/dot4
     input vec_op_en, 
     output reg [31:0] out
 );
@@ -68,6 +72,8 @@ module alu (
     // we only consider the lowermost 5 bits.
     wire [4:0] rs2_res = rs2[4:0];
     logic [31:0] mult_out; 
+    logic [31:0] mult_lo; // low word of the product for mac
+    logic signed [31:0] dot_out; // sum of the byte lane products for dot4
     logic [31:0] addsub_out; 
     logic [31:0] out_tmp; 
     logic clk_mult_enable; 
@@ -103,6 +109,9 @@ module alu (
                 'd9: out_tmp = rs1 & rs2;
                 'd10: out_tmp = rs2;
                 'd11: out_tmp = mult_out; 
+                'd12: out_tmp = acc + mult_lo; 
+                'd13: out_tmp = acc + mult_out; 
+                'd14: out_tmp = acc + dot_out; 
                 default: out_tmp = '0;
             endcase
         end else if (vec_op_en == 1) begin 
@@ -134,6 +143,12 @@ module alu (
         end     
     end
 
+    // Lane i of rs1 and rs2 is byte i, each lane is a signed int8
+    assign dot_out = $signed(rs1[7:0])   * $signed(rs2[7:0])
+                   + $signed(rs1[15:8])  * $signed(rs2[15:8])
+                   + $signed(rs1[23:16]) * $signed(rs2[23:16])
+                   + $signed(rs1[31:24]) * $signed(rs2[31:24]);
+
     `ifdef FPGA
         mult_0 mult_0 (
             .CLK(clk), 
@@ -142,15 +157,20 @@ module alu (
             .P(mult_out)
             // .CE(clk_mult_enable)
         );
+        // mult_0 is a pipelined IP on the low halfwords, mac takes the low
+        // word of its own single-cycle multiplier
+        assign mult_lo = rs1 * rs2; 
 
         assign addsub_out = (!alu_sel[0]) ? rs1+rs2 : rs1-rs2; 
     `elsif ASIC
         assign mult_out_full = ($signed(rs1[31:0]) * $signed(rs2[31:0])); 
         assign mult_out = mult_out_full[47:16];  // mult_out_full[47:16]; 
+        assign mult_lo = mult_out_full[31:0]; 
         assign addsub_out = (!alu_sel[0]) ? rs1+rs2 : rs1-rs2; 
         
     `else
         assign mult_out = ($signed(rs1[31:0]) * $signed(rs2[31:0])); 
+        assign mult_lo = mult_out; 
         assign addsub_out = (!alu_sel[0]) ? rs1+rs2 : rs1-rs2; 
     `endif
 
@@ -63,6 +63,7 @@ module control_logic #(
     input [n_pe-1:0] cond_state,
     input is_sync_beq,
     output logic vec_op_en, 
+    output logic is_delay,
     output reg asel,  
     output reg bsel, 
     output reg [3:0] alusel,  
@@ -90,6 +91,9 @@ module control_logic #(
     wire is_jalr = inst[6:0] == 7'h67 && inst[14:12] == 3'h0;
     wire is_jal = inst[6:0] == 7'h6F;
 
+    // r_opc == 7'h0B -> delay, the cpu stalls for inst[31:20] cycles
+    assign is_delay = r_opc == `OPC_DELAY;
+
     // update: psrf.lw change opc to 7'h04 due to the need of lb
     wire is_load = inst[6:0] == 7'h03 || inst[6:0] == 7'h04; 
     
@@ -130,7 +134,7 @@ module control_logic #(
     /*
         ADD = 0, SUB = 1, SLL = 2, SLT = 3
         SLTU = 4, XOR = 5, SRL = 6, SRA = 7, OR = 8,
-        AND = 9, PASSIMM = 10
+        AND = 9, PASSIMM = 10, MUL = 11, MAC = 12, MAC.FXP = 13, DOT4 = 14
     */
     // r_opc == 7'h15 -> psrf.addi
     always @(*) begin
@@ -145,6 +149,12 @@ module control_logic #(
                             alusel = 1; // sub 
                         end else if (r_func7 == 7'b0000001) begin
                             alusel = 11; // mul
+                        end else if (r_func7 == 7'b0000010) begin
+                            alusel = 12; // mac
+                        end else if (r_func7 == 7'b0000011) begin
+                            alusel = 13; // mac.fxp
+                        end else if (r_func7 == 7'b0000100) begin
+                            alusel = 14; // dot4
                         end else begin
                             alusel = alusel_reg;
                         end
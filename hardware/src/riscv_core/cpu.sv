@@ -92,6 +92,8 @@ module cpu
     input   logic        data_req_valid_i, 
     output  logic        load_store_req, 
     output  logic        load_store_data_req,
+    output  logic        load_store_pair_req, // psrf.ld2, both lanes of pair_req
+    input   logic [31:0] dmem_dout_hi,        // second word of psrf.ld2
 
     // zero tcdm interface
     output  logic [31:0] zero_pe_dmem_addr,
@@ -104,10 +106,18 @@ module cpu
     input   logic        zero_pe_reg_we,
     input   logic [31:0] zero_pe_data,
 
+    // lockstep group, the execution section comes from the leader's fetch
+    input   logic             lockstep_follow,
+    input   logic [31:0]      lockstep_inst,  // instruction fetched by the leader
+    input   logic [n_pe-1:0]  lockstep_mask,  // PEs of the group, they share the grid_state stall
+    output  logic [31:0]      fetched_inst,   // own fetch, the leader's lockstep_inst
+
     // analsis signals 
     output logic [31:0] dbg_mem_conflict,
     output logic [31:0] dbg_ic, 
-    output logic [31:0] dbg_ic_trap
+    output logic [31:0] dbg_ic_trap,
+    output logic [31:0] dbg_ld2,
+    output logic [31:0] dbg_lb_hit
   );
     
     logic [n_pe-1:0] mem_mask;
@@ -155,6 +165,7 @@ module cpu
     localparam [2:0] cpu_state_trap   = 3'b100; // 4
     localparam [2:0] cpu_state_wait   = 3'b101; // 5
     localparam [2:0] cpu_state_pc     = 3'b110; // 6
+    localparam [2:0] cpu_state_delay  = 3'b111; // 7
 
     localparam RESET_PC = 32'h1000_0000;
 
@@ -171,6 +182,8 @@ module cpu
     logic is_psrf_lw; 
     logic is_psrf_sw; 
     logic is_psrf_zd_lw; 
+    logic is_ld2, is_ld2_x; // psrf.ld2
+    logic we2; 
     logic [17:0] psrf_addr;
 
     logic is_hwLrf_addi; 
@@ -201,13 +214,20 @@ module cpu
     reg we;
     reg [4:0] ra1, ra2, wa, wa_x, wa_master;
     reg [31:0] wd;
-    wire [31:0] rd1, rd2;
+    wire [31:0] rd1, rd2, rd3;
 
     reg mem_operation; 
     reg mem_op_in_state; 
     logic [4:0] hwLrf_tag_end; 
+    logic is_delay; 
+    logic [11:0] delay_cnt; // remaining cycles of a delay instruction
     logic [3:0] grid_state_sum; 
     logic pc_hwl_end_zero_flag; 
+    logic [8:0] lb_loop_start; // innermost hardware loop, for the loop buffer
+    logic [5:0] lb_loop_len; 
+    logic lb_loop_active; 
+    logic lb_hit; 
+    logic lockstep_fetch; // follower in its execution section
     logic vec_op_en; 
 
     reg [31:0] rs1_x, rs2_x, inst_x, imm_x, pc_x; 
@@ -255,7 +275,7 @@ module cpu
 
     logic [n_pe-1:0] temp_grid, grid_state;
     assign temp_grid = (const_mask << (id_vec & and_mask));
-    assign grid_mask = (one_hot_id) | (temp_grid); 
+    assign grid_mask = (one_hot_id) | (temp_grid) | (lockstep_mask); 
 
       
     always @(posedge clk) begin
@@ -273,7 +293,7 @@ module cpu
 
     imem imem (
       .clk(clk),
-      .ena(imem_ena || imem_wea),
+      .ena((imem_ena && !lb_hit && !lockstep_fetch) || imem_wea),
       .wea(imem_wea),
       .addra(imem_addr),
       .dina(imem_dina), // idata write
@@ -284,9 +304,10 @@ module cpu
     reg_file rf (
         .clk(clk),
         .we(we),  
-        .ra1(ra1), .ra2(ra2), .wa(wa_master), //| wa_x
+        .ra1(ra1), .ra2(ra2), .ra3(inst[11:7]), .wa(wa_master), //| wa_x
         .wd(wd), 
-        .rd1(rd1), .rd2(rd2)
+        .we2(we2), .wa2({inst_x[11:8], 1'b1}), .wd2(dmem_dout_hi), // rd+1 of psrf.ld2
+        .rd1(rd1), .rd2(rd2), .rd3(rd3) // rd3: accumulator of mac and dot4
     );
 
     assign is_lw = inst[6:0] == 7'b0000011 || inst[6:0] == 7'b0000100;
@@ -303,7 +324,7 @@ module cpu
     
 
     always @(*) begin
-      if (cpu_state != cpu_state_idle && cpu_state != cpu_state_mem) begin 
+      if (cpu_state != cpu_state_idle && cpu_state != cpu_state_mem && cpu_state != cpu_state_delay) begin 
         if (pc != 32'h10000000 && pc != 32'h800)  begin//&& pc != 32'h800) begin
           if (inst[31:0] == '0 || inst_x == '0) begin
             if (is_lw || is_sw || is_lw_x || is_sw_x) begin 
@@ -347,6 +368,7 @@ module cpu
         .cond_state('0), 
         .is_sync_beq('0), 
         .vec_op_en(vec_op_en), 
+        .is_delay(is_delay), 
         .asel(asel), 
         .bsel(bsel), 
         .alusel(alusel), 
@@ -374,11 +396,14 @@ module cpu
     ); 
 
     always @(*) begin 
-      if (is_lw || is_sw) begin 
+      if (is_lw || is_sw || (is_delay && inst[31:20] > 1)) begin 
         pc_write_master = 0; 
       end else if (grid_state == 0) begin 
         if (cpu_state == cpu_state_idle || cpu_state == cpu_state_trap) begin 
           pc_write_master = pc_write; 
+        end else if (cpu_state == cpu_state_delay) begin 
+          // the pc moves past the delay in its last cycle, like a nop would
+          pc_write_master = (delay_cnt == 1); 
         end else begin 
           pc_write_master = 1; 
         end
@@ -389,15 +414,28 @@ module cpu
       end 
     end
     
+    // A follower leaves its imem off in the execution section and decodes the
+    // leader's fetch, the preload section (pc[11]) is still private
+    assign lockstep_fetch = lockstep_follow && !pc[11]; 
+    assign inst = lockstep_fetch ? lockstep_inst : fetched_inst; 
+
     // assign pc = next_pc ; 
     fetch_inst fi ( 
+      .clk(clk),
+      .rst(rst),
       .pc(pc), 
       .imem_dout(imem_doutb),
       // .pc_hwl_end_zero_flag(pc_hwl_end_zero_flag),
       .pc_hwl_end_zero_flag('0),
+      .imem_ena(imem_ena && !lockstep_fetch),
+      .imem_write(|imem_wea),
+      .loop_start(lb_loop_start),
+      .loop_len(lb_loop_len),
+      .loop_active(lb_loop_active),
       // Outputs
       .imem_addr(imem_addrb),
-      .inst(inst)
+      .lb_hit(lb_hit),
+      .inst(fetched_inst)
     );
     
     imm_generator immgen (
@@ -477,6 +515,7 @@ module cpu
       .clk(clk),
       .rs1(rs1_in),
       .rs2(rs2_in),
+      .acc(rd3),
       .vec_op_en(vec_op_en),
       .alu_sel(alusel),
       // Outputs
@@ -505,6 +544,8 @@ module cpu
     // inst_x[6:0] == 7'b0100100 psrf.store
     assign is_lw_x = inst_x[6:0] == 7'b0000011 || inst_x[6:0] == 7'b0000100;
     assign is_sw_x = inst_x[6:0] == 7'b0100011 || inst_x[6:0] == 7'b0100100;
+    assign is_ld2 = inst[6:0] == 7'b0000100 && inst[14:12] == 3'b011;
+    assign is_ld2_x = inst_x[6:0] == 7'b0000100 && inst_x[14:12] == 3'b011;
     assign is_mul = (alusel == 4'd11);
     assign is_addsub = (alusel == 4'd0 || alusel == 4'd1);
     
@@ -536,10 +577,11 @@ module cpu
     logic is_zero_x; 
 
     // inst_x[14:12] == 3'b0 -> load-byte, store-byte
+    // inst_x[14:12] == 3'b011 -> psrf.ld2, rd and rd+1 from an 8-byte aligned pair
     // zero-detection perform when load instruction is executed
     // with func3 == 3'b110, the zero-detection is performed. 
     // The conventional load instruction is with func3 == 3'b111. 
-    assign is_psrf_lw_x = ((inst_x[14:12] == 3'b111 || inst_x[14:12] == 3'b0) && is_lw_x) ? 1:0;
+    assign is_psrf_lw_x = ((inst_x[14:12] == 3'b111 || inst_x[14:12] == 3'b0 || inst_x[14:12] == 3'b011) && is_lw_x) ? 1:0;
     assign is_psrf_sw_x = ((inst_x[14:12] == 3'b100 || inst_x[14:12] == 3'b0) && is_sw_x) ? 1:0; 
     assign is_psrf_zd_lw_x = ((inst_x[14:12] == 3'b110) && is_lw_x) ? 1:0; 
     // is_prsf_zd_lw is written in agu.sv.
@@ -627,6 +669,12 @@ module cpu
       end 
     end
 
+    // The pair goes out as one request, pair_req returns a grant once both
+    // words are read, and rd+1 is written with rd
+    assign load_store_pair_req = load_store_data_req && !load_store_req && 
+                                 (cpu_state == cpu_state_fetch ? is_ld2 : is_ld2_x);
+    assign we2 = (is_ld2_x && cpu_state == cpu_state_mem) ? load_store_grant_i_reg : 0; 
+
     always @(*) begin
       if (cpu_state == cpu_state_fetch) begin
         imem_ena = 1;
@@ -651,6 +699,7 @@ module cpu
       if (rst) begin
         cpu_state <= cpu_state_idle;
         pc_write <= '0; 
+        delay_cnt <= '0; 
       end else begin
         mem_op_in_state <= '0; 
         case (cpu_state) 
@@ -678,6 +727,11 @@ module cpu
                 end else if (inst_trap) begin
                   cpu_state <= cpu_state_trap; 
                   pc_write <= '0; 
+                end else if (is_delay && inst[31:20] > 1) begin
+                  // delay N takes N cycles, the first one is this fetch
+                  cpu_state <= cpu_state_delay; 
+                  delay_cnt <= inst[31:20] - 1; 
+                  pc_write <= '0; 
                 end else begin
                   cpu_state <= cpu_state_fetch; // cpu_state
                   pc_write <= '1; 
@@ -721,6 +775,18 @@ module cpu
             pc_write <= '0;
           end
 
+          // Count only the cycles the grid is not stalled, as the nops this
+          // replaces would, so the stagger between PEs is kept
+          cpu_state_delay: begin 
+            if (grid_state == 0) begin 
+              delay_cnt <= delay_cnt - 1; 
+              if (delay_cnt == 1) begin 
+                cpu_state <= cpu_state_fetch; 
+                pc_write <= '1; 
+              end
+            end
+          end
+
         endcase
       end
 
@@ -911,7 +977,10 @@ module cpu
       .pc_end_zero_flag(pc_hwl_end_zero_flag),
       .i_mat(i_mat),
       .j_mat(j_mat),
-      .k_mat(k_mat)
+      .k_mat(k_mat),
+      .lb_loop_start(lb_loop_start),
+      .lb_loop_len(lb_loop_len),
+      .lb_loop_active(lb_loop_active)
     );
     generate
       if (agu_ena) begin
@@ -999,9 +1068,30 @@ module cpu
   assign dbg_ic = ic; 
   assign dbg_ic_trap = ic_trap; 
 
+  // granted psrf.ld2 pairs
+  logic [31:0] ld2_count = '0; 
+  always @(posedge clk) begin 
+    if (load_store_pair_req && load_store_grant_i) begin 
+      ld2_count <= ld2_count + 1; 
+    end
+  end
+  assign dbg_ld2 = ld2_count; 
+
+  // instructions served by the loop buffer, counted once when the pc moves
+  // past them, not in the stalled cycles that fetch them again
+  logic [31:0] lb_hit_count = '0; 
+  always @(posedge clk) begin 
+    if (lb_hit && pc_write_master) begin 
+      lb_hit_count <= lb_hit_count + 1; 
+    end
+  end
+  assign dbg_lb_hit = lb_hit_count; 
+
 `else 
   assign which_bank = 0;  
   assign dbg_mem_conflict = '0;
+  assign dbg_ld2 = '0;
+  assign dbg_lb_hit = '0;
 `endif
 
 
@@ -22,6 +22,12 @@
 // - 
 // Additional Comments:                                                       
 //   - This module is used to fetch the instruction from the instruction memory.
+//   - A loop buffer of LB_DEPTH words holds the body of the innermost
+//     hardware loop when it fits. The first pass through the body fills it
+//     from imem, later passes (and later entries into the same loop) are
+//     served from it while imem stays disabled (`lb_hit`). Entries are
+//     tagged by the loop's start and length, a new loop refills them and
+//     any imem write drops them.
 //
 // This source is distributed WITHOUT ANY EXPRESS OR IMPLIED WARRANTY, 
 // INCLUDING OF MERCHANTABILITY, SATISFACTORY QUALITY AND FITNESS FOR A 
@@ -29,11 +35,20 @@
 // -----------------------------------------------------------------------------
 
 `timescale 1ns / 1ps
-module fetch_inst (
+module fetch_inst #(
+    parameter LB_DEPTH = 16
+) (
+    input clk, rst,
     input [31:0] pc, 
     input [31:0] imem_dout,
     input logic pc_hwl_end_zero_flag,
+    input logic imem_ena,          // fetch cycle
+    input logic imem_write,        // instruction memory is written
+    input logic [8:0] loop_start,  // innermost hardware loop, first word
+    input logic [5:0] loop_len,    // last word is loop_start + loop_len
+    input logic loop_active,
     output reg [13:0] imem_addr, 
+    output logic lb_hit,           // fetch served by the loop buffer
     output [31:0] inst
   );
     
@@ -41,8 +56,33 @@ module fetch_inst (
       imem_addr = pc[15:2]; // Set imem_addrb
     end
 
+    localparam LB_W = $clog2(LB_DEPTH);
+
+    logic [31:0] lb_mem [LB_DEPTH-1:0];
+    logic [LB_DEPTH-1:0] lb_valid;
+    logic [8:0] lb_start;
+    logic [5:0] lb_len;
+    logic [13:0] lb_offset;
+    logic lb_in_body, lb_same_loop;
+
+    assign lb_offset = pc[15:2] - {5'b0, loop_start};
+    assign lb_in_body = loop_active && loop_len < LB_DEPTH && 
+                        pc[15:2] >= {5'b0, loop_start} && lb_offset <= {8'b0, loop_len};
+    assign lb_same_loop = (lb_start == loop_start) && (lb_len == loop_len);
+    assign lb_hit = imem_ena && lb_in_body && lb_same_loop && lb_valid[lb_offset[LB_W-1:0]];
+
+    always @(posedge clk) begin
+      if (rst || imem_write) begin
+        lb_valid <= '0;
+      end else if (imem_ena && lb_in_body && !lb_hit) begin
+        lb_valid <= (lb_same_loop ? lb_valid : '0) | (LB_DEPTH'(1) << lb_offset[LB_W-1:0]);
+        lb_start <= loop_start;
+        lb_len <= loop_len;
+        lb_mem[lb_offset[LB_W-1:0]] <= imem_dout;
+      end
+    end
 
     // assign inst = (instsel) ? bios_dout : imem_dout;
-    assign inst = (pc_hwl_end_zero_flag==1) ? 32'h00000013 : imem_dout;
+    assign inst = (pc_hwl_end_zero_flag==1) ? 32'h00000013 : 
+                  (lb_hit) ? lb_mem[lb_offset[LB_W-1:0]] : imem_dout;
 endmodule
-
@@ -85,7 +85,10 @@ module hwl #(
   output logic [31:0] pc_hwloop,
   output logic [1:0] pcsel_upper, 
   output logic pc_end_zero_flag,
-  output logic [11:0] i_mat,j_mat,k_mat
+  output logic [11:0] i_mat,j_mat,k_mat,
+  output logic [8:0] lb_loop_start,   // innermost loop, for the fetch loop buffer
+  output logic [5:0] lb_loop_len,
+  output logic lb_loop_active
 );
 
   parameter RESET_PC = 32'h1000_0000;
@@ -176,6 +179,9 @@ module hwl #(
   assign still_hw_loop = (loop_lv > 0) ? 1:0; 
   assign loop_start = hwLrf_mem[loop_lv][31:23]; 
   assign loop_end = {'0, hwLrf_mem[loop_lv][22:17]} + {'0, loop_start}; 
+  assign lb_loop_start = hwLrf_mem[loop_lv][31:23];
+  assign lb_loop_len = hwLrf_mem[loop_lv][22:17];
+  assign lb_loop_active = still_hw_loop;
   assign loop_count = hwLrf_mem[loop_lv][11:0]; 
 
 
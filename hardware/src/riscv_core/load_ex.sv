@@ -100,7 +100,7 @@ module load_ex(
         end 
         else if (opc == 7'h04 || opc_x == 7'h04) begin // psrf.lw 
             if (cpu_state == cpu_state_fetch) begin
-                if (func3[2:0] == 3'b111 || func3[2:0] == 3'b110) begin // Load word
+                if (func3[2:0] == 3'b111 || func3[2:0] == 3'b110 || func3[2:0] == 3'b011) begin // Load word, psrf.ld2 low word
                     out = in;
                 end                 
                 else begin
@@ -138,7 +138,7 @@ module load_ex(
                 //     end
                 // end
             end else begin 
-                if (func3_x[2:0] == 3'b111 || func3_x[2:0] == 3'b110) begin // Load word
+                if (func3_x[2:0] == 3'b111 || func3_x[2:0] == 3'b110 || func3_x[2:0] == 3'b011) begin // Load word, psrf.ld2 low word
                     out = in;
                 end 
                 else begin
@@ -56,6 +56,9 @@
 `define OPC_ARI_RTYPE   7'b0110011
 `define OPC_ARI_ITYPE   7'b0010011
 
+// Multi-cycle stall, imm[11:0] cycles from one instruction word
+`define OPC_DELAY       7'b0001011
+
 // ***** 5-bit Opcodes *****
 `define OPC_LUI_5       5'b01101
 `define OPC_AUIPC_5     5'b00101
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// This source describes Open Hardware and is licensed under the CERN-OHL-S v2.
+// You may obtain a copy of the License at:
+//     https://ohwr.org/cern_ohl_s_v2.txt
+// -----------------------------------------------------------------------------
+// Copyright © 2011-2026 Université Bretagne Sud
+// 4 Rue Jean Zay, 56100 Lorient, France.
+//
+// Project Name:   KIRA
+// Design Name:    pair_req
+// Module Name:    pair_req
+// File Name:      pair_req.sv
+// Create Date:    27/02/2026
+// Engineer:       Chanon Khongprasongsiri
+// Language:       SystemVerilog
+//
+// This source describes Open Hardware and is licensed under the
+// CERN-OHL-W v2 or later (https://ohwr.org/cern_ohl_w_v2.txt).
+//
+// Additional contributions by:
+// -
+// -
+// Additional Comments:
+//   - This module joins the two XBAR master lanes of a PE into one psrf.ld2
+//     request.
+//   - The low lane carries every request of the core at `dmem_addr`. For a
+//     pair (`pair_i`), the high lane reads `dmem_addr + 4`, which an 8-byte
+//     aligned pair places in the next bank of the interleaved TCDM.
+//   - Both lanes go through the same arbitration as any master. A lane that
+//     is granted stops requesting and keeps its word, the other one retries.
+//     The core sees one grant in the cycle the pair completes, and both words
+//     in the cycle after, like the single word of a load.
+//   - Without `pair_i` the low lane passes straight through.
+//
+// This source is distributed WITHOUT ANY EXPRESS OR IMPLIED WARRANTY,
+// INCLUDING OF MERCHANTABILITY, SATISFACTORY QUALITY AND FITNESS FOR A
+// PARTICULAR PURPOSE. Please see the CERN-OHL-W v2 for applicable conditions.
+// -----------------------------------------------------------------------------
+
+module pair_req (
+    input  logic        clk,
+    input  logic        rst,
+
+    // core side
+    input  logic        data_req_i,
+    input  logic        pair_i,
+    input  logic [31:0] addr_i,
+    output logic        gnt_o,
+    output logic        r_valid_o,
+    output logic [31:0] rdata_o,
+    output logic [31:0] rdata_hi_o,
+
+    // xbar side, the low lane uses addr_i
+    output logic        req_lo_o,
+    output logic        req_hi_o,
+    output logic [31:0] addr_hi_o,
+    input  logic        gnt_lo_i,
+    input  logic        gnt_hi_i,
+    input  logic [31:0] rdata_lo_i,
+    input  logic [31:0] rdata_hi_i
+);
+
+    logic done_lo, done_hi;          // lane granted in an earlier cycle of this request
+    logic gnt_lo_q, gnt_hi_q;        // lane granted last cycle, its word is on rdata now
+    logic buf_lo_q;                  // the completed pair takes the low word from buf_lo
+    logic [31:0] buf_lo, buf_hi;
+
+    assign req_lo_o  = data_req_i & ~done_lo;
+    assign req_hi_o  = data_req_i & pair_i & ~done_hi;
+    assign addr_hi_o = addr_i + 32'd4;
+
+    assign gnt_o = data_req_i & (done_lo | gnt_lo_i) & (~pair_i | done_hi | gnt_hi_i);
+
+    always @(posedge clk) begin
+        if (rst) begin
+            done_lo   <= '0;
+            done_hi   <= '0;
+            gnt_lo_q  <= '0;
+            gnt_hi_q  <= '0;
+            buf_lo_q  <= '0;
+            r_valid_o <= '0;
+        end else begin
+            gnt_lo_q  <= req_lo_o & gnt_lo_i;
+            gnt_hi_q  <= req_hi_o & gnt_hi_i;
+            r_valid_o <= gnt_o;
+            if (gnt_o) begin
+                done_lo  <= '0;
+                done_hi  <= '0;
+                buf_lo_q <= done_lo;
+            end else begin
+                if (req_lo_o & gnt_lo_i) done_lo <= 1'b1;
+                if (req_hi_o & gnt_hi_i) done_hi <= 1'b1;
+            end
+        end
+    end
+
+    always @(posedge clk) begin
+        if (gnt_lo_q) buf_lo <= rdata_lo_i;
+        if (gnt_hi_q) buf_hi <= rdata_hi_i;
+    end
+
+    assign rdata_o    = buf_lo_q ? buf_lo : rdata_lo_i;
+    assign rdata_hi_o = gnt_hi_q ? rdata_hi_i : buf_hi;
+
+endmodule
@@ -45,17 +45,22 @@
 module reg_file (
     input clk,
     input we, 
-    input [4:0] ra1, ra2, wa,
+    input [4:0] ra1, ra2, ra3, wa,
     input [31:0] wd, 
-    output [31:0] rd1, rd2
+    input we2, // second write port, rd+1 of psrf.ld2
+    input [4:0] wa2,
+    input [31:0] wd2, 
+    output [31:0] rd1, rd2, rd3
 );
     /*
     Mapping to schema:
     we = RegWEn, the control signal which determines whether DataD would be written at this clock tick.
     ra1, ra2 = AddrA, AddrB
     rd1, rd2 = rs1, rs2
+    ra3, rd3 = rd of mac/mac.fxp, the accumulator read back
     wa = AddrD, the address of the write back = rd
     wd = WB or DataD, the value being written back to
+    we2, wa2, wd2 = the second word of psrf.ld2, written in the same cycle as rd
     */
     parameter DEPTH = 32;
     reg [31:0] mem [0:DEPTH-1]; // 28 registers for FPT synthesis
@@ -73,6 +78,9 @@ module reg_file (
         if(we && wa != 0) begin
             mem[wa] <= wd;
         end
+        if(we2 && wa2 != 0) begin
+            mem[wa2] <= wd2;
+        end
         // if(web && wb != 0) begin
         //     mem[wb] <= wd_b;
         // end
@@ -80,4 +88,5 @@ module reg_file (
     
     assign rd1 = mem[ra1];
     assign rd2 = mem[ra2];
+    assign rd3 = mem[ra3];
 endmodule
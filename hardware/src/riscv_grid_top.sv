@@ -38,7 +38,9 @@
 //           - Instruction memory: `imem_dina`, `imem_wea`, `imem_addra`.
 //           - Data memory: `host_dmem_addr`, `host_dmem_din`, `host_dmem_out`, etc.
 //           - Load/store control: `host_load_store_data_req`, `host_load_store_req`.
+//           - Burst access to one row of all banks: `host_burst_row`, `host_burst_din`, `host_burst_dout`.
 //       * Handles tile selection and memory interface for host-driven operations.
+//       * Two XBAR masters per PE, joined by `pair_req` for psrf.ld2.
 // ==============================================================================
 
 
@@ -68,6 +70,12 @@ module riscv_grid_top # (
     input logic [3:0]    imem_wea, 
     input logic [9+LOG2_NUM_PE:0]   imem_addra,
 
+    // lockstep table, one PE per write: lockstep_pe follows lockstep_leader,
+    // naming the PE itself as leader clears its entry
+    input logic                     lockstep_we,
+    input logic [LOG2_NUM_PE-1:0]   lockstep_pe,
+    input logic [LOG2_NUM_PE-1:0]   lockstep_leader,
+
     // dmem interface 
     // write_data <- host_load_store_data_req = 1
     // write_data <- host_load_store_req = 1
@@ -83,13 +91,25 @@ module riscv_grid_top # (
     output logic 	    host_data_req_valid_i,
     output logic [31:0] host_dmem_out,
 
+    // burst interface, one word per bank in one cycle: bank k holds the word
+    // at address (host_burst_row * NB_LS + k) * 4. Only while the grid is
+    // idle, it takes the banks from the XBAR. Read data comes one cycle later.
+    input logic                    host_burst_req,
+    input logic                    host_burst_we,
+    input logic [NB_LS-1:0]        host_burst_lane_ena,
+    input logic [26:0]             host_burst_row,
+    input logic [NB_LS-1:0][31:0]  host_burst_din,
+    output logic [NB_LS-1:0][31:0] host_burst_dout,
+
 `ifndef SYNTHESIS
     output logic [7:0]  dbg_nc, dbg_nr,
     output logic [7:0]  dbg_mc_temporal_out,
     output logic [(N_R*N_C)-1:0] dbg_finish,
     output logic [(N_R*N_C)-1:0][31:0] dbg_mem_conflict,
     output logic [(N_R*N_C)-1:0][31:0] dbg_ic, 
-    output logic [(N_R*N_C)-1:0][31:0] dbg_ic_trap
+    output logic [(N_R*N_C)-1:0][31:0] dbg_ic_trap,
+    output logic [(N_R*N_C)-1:0][31:0] dbg_ld2,
+    output logic [(N_R*N_C)-1:0][31:0] dbg_lb_hit
 `else 
     output logic [7:0]  dbg_nc, dbg_nr
 `endif
@@ -104,6 +124,8 @@ module riscv_grid_top # (
     logic [(N_R*N_C)-1:0][31:0] dbg_mem_conflict;
     logic [(N_R*N_C)-1:0][31:0] dbg_ic;
     logic [(N_R*N_C)-1:0][31:0] dbg_ic_trap;
+    logic [(N_R*N_C)-1:0][31:0] dbg_ld2;
+    logic [(N_R*N_C)-1:0][31:0] dbg_lb_hit;
 `endif
 
     assign dbg_nc = N_C; 
@@ -127,6 +149,8 @@ module riscv_grid_top # (
     logic [(N_R*N_C)-1:0]        data_req_valid_i;
     logic [(N_R*N_C)-1:0]        load_store_req;
     logic [(N_R*N_C)-1:0]        load_store_data_req;
+    logic [(N_R*N_C)-1:0]        load_store_pair_req; // psrf.ld2
+    logic [(N_R*N_C)-1:0][31:0]  dmem_dout_hi; // second word of psrf.ld2
 
     logic [(N_R*N_C)-1:0][31:0]   imem_din;
     logic [(N_R*N_C)-1:0][3:0]    imem_write_en;
@@ -161,6 +185,17 @@ module riscv_grid_top # (
         end
     end
 
+    // The table is kept across rst, like imem, so every phase of a program
+    // runs with it
+    logic [(N_R*N_C)-1:0] lockstep_follow = '0;
+    logic [(N_R*N_C)-1:0][LOG2_NUM_PE-1:0] lockstep_leader_pe = '0;
+    always @(posedge clk) begin
+        if (lockstep_we) begin
+            lockstep_follow[lockstep_pe] <= (lockstep_leader != lockstep_pe);
+            lockstep_leader_pe[lockstep_pe] <= lockstep_leader;
+        end
+    end
+
     logic [N_R*N_C-1:0] rst_pe;
     logic local_mem_temp_we; 
     assign local_mem_temp_we = host_load_store_req & host_load_store_data_req; 
@@ -182,6 +217,7 @@ module riscv_grid_top # (
 
 
     logic [NB_LS-1:0][31:0] dmem_dout_mux_o; 
+    logic [NB_LS-1:0][31:0] dmem_dout_hi_mux_o; 
     logic [(N_R*N_C)-1:0]  load_store_grant_i_mux_o; 
     logic [(N_R*N_C)-1:0]  data_req_valid_i_mux_o; 
 
@@ -214,6 +250,9 @@ module riscv_grid_top # (
         .lmem_wea(lmem_wea),
         .lmem_addra(lmem_addra),
 
+        .lockstep_follow(lockstep_follow),
+        .lockstep_leader(lockstep_leader_pe),
+
         // output to mem 
         .dmem_addr(dmem_addr), 
         .dmem_din(dmem_din), // data to mem
@@ -221,9 +260,11 @@ module riscv_grid_top # (
         .dmem_en(dmem_en),
         .load_store_req(load_store_req), 
         .load_store_data_req(load_store_data_req),
+        .load_store_pair_req(load_store_pair_req),
 
         // input from mem 
         .dmem_dout(dmem_dout_mux_o), // data from mem
+        .dmem_dout_hi(dmem_dout_hi_mux_o), // second word of psrf.ld2
         .load_store_grant_i(load_store_grant_i_mux_o), 
         .data_req_valid_i(data_req_valid_i_mux_o), 
 
@@ -231,7 +272,9 @@ module riscv_grid_top # (
         .dbg_finish(dbg_finish),
         .dbg_mem_conflict(dbg_mem_conflict),
         .dbg_ic(dbg_ic),
-        .dbg_ic_trap(dbg_ic_trap)
+        .dbg_ic_trap(dbg_ic_trap),
+        .dbg_ld2(dbg_ld2),
+        .dbg_lb_hit(dbg_lb_hit)
     );
 
     logic [NB_LS-1:0][31:0] zero_pe_dmem_addr;
@@ -250,8 +293,8 @@ module riscv_grid_top # (
     logic [NB_LS-1:0] mm_dmem_dout_valid; 
     logic [NB_LS-1:0][31:0] mm_dmem_din, mm_dmem_dout; 
     logic [NB_LS-1:0] mm_dmem_en; 
-    logic [NB_LS-1:0][NB_LS-1:0] data_id_i;
-    logic [NB_LS-1:0][NB_LS-1:0] data_id; 
+    logic [NB_LS-1:0][2*NB_LS-1:0] data_id_i; // PE lanes, high then low
+    logic [NB_LS-1:0][2*NB_LS-1:0] data_id; 
     logic [NB_LS-1:0] host_data_id;
     logic [NB_LS-1:0] host_data_id_i;
     logic [NB_LS-1:0] mm_dmem_we; 
@@ -274,6 +317,40 @@ module riscv_grid_top # (
         end
     endgenerate
     assign host_dmem_addr_xbar = {'0, host_dmem_addr};
+
+    // Each PE has two XBAR masters, the low lane for every request and the
+    // high lane for the second word of psrf.ld2. pair_req joins their grants
+    // into the one grant the core waits for.
+    logic [NB_LS-1:0]       xbar_req_lo, xbar_req_hi; 
+    logic [NB_LS-1:0]       xbar_gnt_lo, xbar_gnt_hi; 
+    logic [NB_LS-1:0]       xbar_r_valid_lo, xbar_r_valid_hi; 
+    logic [NB_LS-1:0][31:0] xbar_rdata_lo, xbar_rdata_hi; 
+    logic [NB_LS-1:0][31:0] dmem_addr_hi; 
+    logic [NB_LS-1:0][33:0] dmem_addr_hi_xbar; 
+
+    generate
+        for (i_gen = 0; i_gen < NB_LS; i_gen = i_gen + 1) begin : gen_pair_req
+            pair_req pair_req_unit (
+                .clk(clk),
+                .rst(rst),
+                .data_req_i(load_store_data_req[i_gen]),
+                .pair_i(load_store_pair_req[i_gen]),
+                .addr_i(dmem_addr[i_gen]),
+                .gnt_o(load_store_grant_i[i_gen]),
+                .r_valid_o(data_req_valid_i[i_gen]),
+                .rdata_o(dmem_dout[i_gen]),
+                .rdata_hi_o(dmem_dout_hi[i_gen]),
+                .req_lo_o(xbar_req_lo[i_gen]),
+                .req_hi_o(xbar_req_hi[i_gen]),
+                .addr_hi_o(dmem_addr_hi[i_gen]),
+                .gnt_lo_i(xbar_gnt_lo[i_gen]),
+                .gnt_hi_i(xbar_gnt_hi[i_gen]),
+                .rdata_lo_i(xbar_rdata_lo[i_gen]),
+                .rdata_hi_i(xbar_rdata_hi[i_gen])
+            );
+            assign dmem_addr_hi_xbar[i_gen] = {'0, dmem_addr_hi[i_gen]};
+        end
+    endgenerate
     logic TCDM_arb_policy_i;
     assign TCDM_arb_policy_i = tcdm_arb_policy;
 
@@ -287,7 +364,7 @@ module riscv_grid_top # (
 
     XBAR_TCDM 
     #( 
-        .N_CH0(NB_LS + 1), 
+        .N_CH0(2*NB_LS + 1), // host, PE high lanes, PE low lanes
         .N_CH1(0),  
         .N_SLAVE(NB_LS), 
         .ADDR_WIDTH(33+1),
@@ -295,14 +372,14 @@ module riscv_grid_top # (
         .ADDR_MEM_WIDTH(27)
     ) xbar_tcdm_unit (
         // ---------------- MASTER CH0+CH1 SIDE  -------------------------- 
-        .data_req_i             ({host_load_store_data_req_xbar, load_store_data_req}), 
-        .data_add_i             ({host_dmem_addr_xbar, dmem_addr_xbar}),
-        .data_wen_i             ({host_load_store_req_xbar, load_store_req}),            // Data request type : 0--> Store, 1 --> Load
-        .data_wdata_i           ({host_dmem_din, dmem_din}),          // Data request Write data
+        .data_req_i             ({host_load_store_data_req_xbar, xbar_req_hi, xbar_req_lo}), 
+        .data_add_i             ({host_dmem_addr_xbar, dmem_addr_hi_xbar, dmem_addr_xbar}),
+        .data_wen_i             ({host_load_store_req_xbar, {NB_LS{1'b0}}, load_store_req}),            // Data request type : 0--> Store, 1 --> Load
+        .data_wdata_i           ({host_dmem_din, {NB_LS{32'b0}}, dmem_din}),          // Data request Write data
         .data_be_i              (('1)),             // Data request Byte enable
-        .data_gnt_o             ({host_load_store_grant_i, load_store_grant_i}),            // Grant Incoming Request
-        .data_r_valid_o         ({host_data_req_valid_i_tmp, data_req_valid_i}),        // Data Response Valid (For LOAD/STORE commands)
-        .data_r_rdata_o         ({host_dmem_out, dmem_dout}),        // Data Response DATA (For LOAD commands)
+        .data_gnt_o             ({host_load_store_grant_i, xbar_gnt_hi, xbar_gnt_lo}),            // Grant Incoming Request
+        .data_r_valid_o         ({host_data_req_valid_i_tmp, xbar_r_valid_hi, xbar_r_valid_lo}),        // Data Response Valid (For LOAD/STORE commands)
+        .data_r_rdata_o         ({host_dmem_out, xbar_rdata_hi, xbar_rdata_lo}),        // Data Response DATA (For LOAD commands)
         .data_req_o             (mm_dmem_en),            // Data request
 
         // ---------------- MM_SIDE (Interleaved) --------------------------
@@ -356,24 +433,47 @@ module riscv_grid_top # (
     always @(*) begin
         if (mode_select == 0) begin // shared mode
             dmem_dout_mux_o = dmem_dout; 
+            dmem_dout_hi_mux_o = dmem_dout_hi; 
             load_store_grant_i_mux_o = load_store_grant_i; 
             data_req_valid_i_mux_o = data_req_valid_i; 
         end else begin // bypass mode
             dmem_dout_mux_o = mm_dmem_dout; 
+            dmem_dout_hi_mux_o = '0; // psrf.ld2 needs the shared mode
             load_store_grant_i_mux_o =  load_store_data_req; 
             data_req_valid_i_mux_o = load_store_data_req_reg; 
         end
     end
 
+    // Mux for the host burst
+    logic [NB_LS-1:0][3:0] tcdm_we; 
+    logic [NB_LS-1:0][31:0] tcdm_din; 
+    logic [NB_LS-1:0][26:0] tcdm_addr; 
+
+    always @(*) begin
+        if (host_burst_req) begin
+            for (integer k = 0; k < NB_LS; k = k + 1) begin
+                tcdm_we[k] = {4{host_burst_we && host_burst_lane_ena[k]}};
+                tcdm_addr[k] = host_burst_row;
+            end
+            tcdm_din = host_burst_din;
+        end else begin
+            tcdm_we = mm_we_mux_o;
+            tcdm_addr = mm_dmem_addr_mux_o;
+            tcdm_din = mm_dmem_din_mux_o;
+        end
+    end
+
+    assign host_burst_dout = mm_dmem_dout;
+
     // TCDM memory interface
     tcdm #(
         .nslave(NB_LS)
     ) tcdm (
         .clk(clk),
         .dmem_en('1),
-        .dmem_we(mm_we_mux_o),
-        .dmem_addr(mm_dmem_addr_mux_o),
-        .dmem_din(mm_dmem_din_mux_o), // data in to mem 
+        .dmem_we(tcdm_we),
+        .dmem_addr(tcdm_addr),
+        .dmem_din(tcdm_din), // data in to mem 
         .dmem_dout(mm_dmem_dout) // data out from mem 
     );
 
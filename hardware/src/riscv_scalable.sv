@@ -49,16 +49,29 @@ module riscv_scalable #(
   input logic [3:0] imem_wea, 
   input logic [9+LOG2_NUM_PE:0] imem_addra,
 
+  // lockstep table, a leader and its followers sit in one cluster
+  input logic lockstep_we, 
+  input logic [LOG2_NUM_PE-1:0] lockstep_pe, 
+  input logic [LOG2_NUM_PE-1:0] lockstep_leader, 
+
   input logic           host_load_store_data_req,
   input logic 	        host_load_store_req,
   input logic  [31:0]   host_dmem_addr,
   input logic  [31:0]   host_dmem_din,
-  input logic  [CL-1:0] host_dmem_cluster_ena, // one-hot encoding
+  input logic  [CL-1:0] host_dmem_cluster_ena, // one bit per cluster, several bits multicast writes
 
   output logic        host_load_store_grant_i, 
   output logic 	      host_data_req_valid_i,
   output logic [31:0] host_dmem_out,
 
+  // burst interface of riscv_grid_top, to the clusters of host_dmem_cluster_ena
+  input logic                               host_burst_req,
+  input logic                               host_burst_we,
+  input logic [N_PE_PER_CLUSTER-1:0]        host_burst_lane_ena,
+  input logic [26:0]                        host_burst_row,
+  input logic [N_PE_PER_CLUSTER-1:0][31:0]  host_burst_din,
+  output logic [N_PE_PER_CLUSTER-1:0][31:0] host_burst_dout,
+
 `ifndef SYNTHESIS
   output logic [7:0]  dbg_nc, dbg_nr, dbg_cl,
   output logic [(N_R*N_C*CL)-1:0][31:0] dbg_mem_conflict,
@@ -109,105 +122,68 @@ always @(*) begin
 end
 
 
+logic [CL-1:0] lockstep_we_cluster; 
+always @(*) begin
+  for (int i=0; i<CL; i++) begin
+    lockstep_we_cluster[i] = lockstep_we && ((lockstep_pe >> $clog2(N_PE_PER_CLUSTER)) == i);
+  end
+end
+
+
 // TCDM Write 
+// host_dmem_cluster_ena may select several clusters, a write then goes to the
+// same address in every selected cluster (multicast).
 logic [CL-1:0] host_load_store_data_req_cluster;
 logic [CL-1:0] host_load_store_req_cluster;
 logic [31:0] host_dmem_addr_cluster;
 logic [31:0] host_dmem_din_cluster;
 always @(*) begin
-  if (host_dmem_cluster_ena[0] == 1) begin
-    host_load_store_data_req_cluster[0] = host_load_store_data_req;
-    host_load_store_req_cluster[0] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[1] == 1) begin
-    host_load_store_data_req_cluster[1] = host_load_store_data_req;
-    host_load_store_req_cluster[1] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[2] == 1) begin
-    host_load_store_data_req_cluster[2] = host_load_store_data_req;
-    host_load_store_req_cluster[2] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[3] == 1) begin
-    host_load_store_data_req_cluster[3] = host_load_store_data_req;
-    host_load_store_req_cluster[3] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[4] == 1) begin
-    host_load_store_data_req_cluster[4] = host_load_store_data_req;
-    host_load_store_req_cluster[4] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[5] == 1) begin
-    host_load_store_data_req_cluster[5] = host_load_store_data_req;
-    host_load_store_req_cluster[5] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[6] == 1) begin
-    host_load_store_data_req_cluster[6] = host_load_store_data_req;
-    host_load_store_req_cluster[6] = host_load_store_req;
-    host_dmem_addr_cluster = host_dmem_addr;
-    host_dmem_din_cluster = host_dmem_din;
-  end else if (host_dmem_cluster_ena[7] == 1) begin
-    host_load_store_data_req_cluster[7] = host_load_store_data_req;
-    host_load_store_req_cluster[7] = host_load_store_req;
+  for (int i=0; i<CL; i++) begin
+    host_load_store_data_req_cluster[i] = host_load_store_data_req && host_dmem_cluster_ena[i];
+    host_load_store_req_cluster[i] = host_load_store_req && host_dmem_cluster_ena[i];
+  end
+  if (host_dmem_cluster_ena != '0) begin
     host_dmem_addr_cluster = host_dmem_addr;
     host_dmem_din_cluster = host_dmem_din;
-
   end else begin  
-    host_load_store_data_req_cluster = '0;
-    host_load_store_req_cluster = '0;
     host_dmem_addr_cluster = '0;
     host_dmem_din_cluster = '0;
   end 
 end
 
 // TCDM Read 
+// The grant needs every selected cluster, the data comes from the lowest one.
 logic host_load_store_grant_i_cluster [CL-1:0];
 logic host_data_req_valid_i_cluster [CL-1:0];
 logic [31:0] host_dmem_out_cluster [CL-1:0];  
 always @(*) begin
-  if (host_dmem_cluster_ena[0] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[0];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[0];
-    host_dmem_out = host_dmem_out_cluster[0];
-  end else if (host_dmem_cluster_ena[1] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[1];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[1];
-    host_dmem_out = host_dmem_out_cluster[1];
-  end else if (host_dmem_cluster_ena[2] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[2];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[2];
-    host_dmem_out = host_dmem_out_cluster[2];
-  end else if (host_dmem_cluster_ena[3] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[3];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[3];
-    host_dmem_out = host_dmem_out_cluster[3];
-  end else if (host_dmem_cluster_ena[4] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[4];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[4];
-    host_dmem_out = host_dmem_out_cluster[4];
-  end else if (host_dmem_cluster_ena[5] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[5];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[5];
-    host_dmem_out = host_dmem_out_cluster[5];
-  end else if (host_dmem_cluster_ena[6] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[6];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[6];
-    host_dmem_out = host_dmem_out_cluster[6];
-  end else if (host_dmem_cluster_ena[7] == 1) begin
-    host_load_store_grant_i = host_load_store_grant_i_cluster[7];
-    host_data_req_valid_i = host_data_req_valid_i_cluster[7];
-    host_dmem_out = host_dmem_out_cluster[7];
-  end else begin
-    host_load_store_grant_i = '0; 
-    host_data_req_valid_i = '0; 
-    host_dmem_out = '0;   
+  host_load_store_grant_i = (host_dmem_cluster_ena != '0);
+  host_data_req_valid_i = '0; 
+  host_dmem_out = '0;   
+  for (int i=CL-1; i>=0; i--) begin
+    if (host_dmem_cluster_ena[i] == 1) begin
+      host_load_store_grant_i = host_load_store_grant_i && host_load_store_grant_i_cluster[i];
+      host_data_req_valid_i = host_data_req_valid_i_cluster[i];
+      host_dmem_out = host_dmem_out_cluster[i];
+    end
   end  
 end
 
+// TCDM Burst 
+// Like a host write, a burst write goes to every selected cluster and a read
+// comes from the lowest one.
+logic [CL-1:0] host_burst_req_cluster;
+logic [N_PE_PER_CLUSTER-1:0][31:0] host_burst_dout_cluster [CL-1:0];
+always @(*) begin
+  host_burst_dout = '0;
+  for (int i=CL-1; i>=0; i--) begin
+    host_burst_req_cluster[i] = host_burst_req && host_dmem_cluster_ena[i];
+    if (host_dmem_cluster_ena[i] == 1) begin
+      host_burst_dout = host_burst_dout_cluster[i];
+    end
+  end
+end
+
 logic [CL-1:0] finish_cluster;
 logic temp_finish;
 
@@ -279,6 +255,10 @@ generate
       .imem_wea(imem_wea_cluster[i]), 
       .imem_addra(imem_addra_cluster[i]), 
 
+      .lockstep_we(lockstep_we_cluster[i]), 
+      .lockstep_pe(lockstep_pe[$clog2(N_PE_PER_CLUSTER)-1:0]), 
+      .lockstep_leader(lockstep_leader[$clog2(N_PE_PER_CLUSTER)-1:0]), 
+
       .host_load_store_data_req(host_load_store_data_req_cluster[i]), 
       .host_load_store_req(host_load_store_req_cluster[i]),   
       .host_dmem_addr(host_dmem_addr_cluster),      
@@ -288,12 +268,21 @@ generate
       .host_data_req_valid_i(host_data_req_valid_i_cluster[i]), 
       .host_dmem_out(host_dmem_out_cluster[i]), 
 
+      .host_burst_req(host_burst_req_cluster[i]), 
+      .host_burst_we(host_burst_we), 
+      .host_burst_lane_ena(host_burst_lane_ena), 
+      .host_burst_row(host_burst_row), 
+      .host_burst_din(host_burst_din), 
+      .host_burst_dout(host_burst_dout_cluster[i]), 
+
 
 `ifndef SYNTHESIS
       .dbg_mc_temporal_out(dbg_mc_temporal_temp[i]),
       .dbg_finish(dbg_finish_temp[i]),
       .dbg_ic(dbg_ic_temp[i]),
       .dbg_ic_trap(dbg_ic_trap_temp[i]),
+      .dbg_ld2(),
+      .dbg_lb_hit(),
       .dbg_nc(dbg_nc), 
       .dbg_nr(dbg_nr),
       .dbg_mem_conflict(dbg_mem_conflict_temp[i])
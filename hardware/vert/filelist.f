@@ -32,3 +32,4 @@
 ../src/riscv_core/control_logic.sv 
 ../src/riscv_core/alu.sv 
 ../src/riscv_core/reg_file.sv 
+../src/riscv_core/pair_req.sv 
@@ -8,6 +8,7 @@
 # ./run_simulation.sh -f output_gemm_64x64_4x4 -g 8 -r 4 -c 4 -m riscv_grid_top -ot gemm
 # ./run_simulation.sh -f output_gemm_64x64_8x4 -g 16 -r 8 -c 4 -m riscv_grid_top -ot gemm
 # ./run_simulation.sh -f output_gemm_64x64_8x8 -g 32 -r 8 -c 8 -m riscv_grid_top -ot gemm
+# ./run_simulation.sh -f output_gemm_tiled -g 8 -r 4 -c 4 -m riscv_grid_top -ot gemm_tiled
 
 # ./run_simulation.sh -f output_gemm_64x64_8x4 -cl 2 -g 8 -m riscv_scalable -ot gemm
 # ./run_simulation.sh -f output_gemm_64x64_8x8 -cl 4 -g 8 -m riscv_scalable -ot gemm
@@ -32,13 +32,22 @@
 // Arguments :
 //   argv[1] - Folder name or path to software/output/<folder>/combined_memory.mem
 //   argv[2] - Grid division factor (`grid_div`)
-//   argv[3] - Operation type string (e.g. "conv", "gemm", "2mm", "relu", etc.)
+//   argv[3] - Operation type string (e.g. "conv", "gemm", "gemm_tiled", "2mm", "relu", etc.)
 //   argv[4] - TCDM arbitration policy (0 = round-robin, 1 = priority-min)
 //
 // Notes     :
 //   - This file is intended to be used with Verilator-generated models.
 //   - Waveform dumping is conditionally enabled to keep VCD size manageable.
 //   - Report files are written under `./rpt`, `./rpt_tc`, and `./rpt_fc`.
+//   - Tiled operation types read `tile_schedule.txt` from the software output
+//     folder and stream the next tile through a host DMA model while the PEs
+//     compute on the current buffer.
+//   - If the software output folder holds `overlay_memory.mem`, the execution
+//     sections are swapped segment by segment between execution phases.
+//   - A `template_memory.mem` in the output folder takes precedence over
+//     `combined_memory.mem` and is expanded per PE while loading.
+//   - A binary `grid_image.kgi` takes precedence over both. It is mapped
+//     with mmap and also holds the overlay segments.
 // ============================================================================
 
 #include <verilated.h>
@@ -53,7 +62,13 @@
 #include <algorithm> // For std::remove
 #include <regex>
 #include <vector>
+#include <map>
 #include <array>
+#include <sys/mman.h> // For mmap of the grid image
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../../software/kira_image.h"
 #include "Vriscv_grid_top.h"  // The Verilated model header
 
 
@@ -69,6 +84,10 @@ vluint64_t load_inst_time = 0;
 vluint64_t load_data_time = 0; 
 vluint64_t load_data_read_time = 0; 
 vluint64_t preload_time = 0; 
+vluint64_t dma_hidden_time = 0;   // DMA words moved while the PEs compute
+vluint64_t dma_exposed_time = 0;  // DMA words moved while the PEs wait
+vluint64_t dma_stall_time = 0;    // DMA cycles without a TCDM grant
+vluint64_t overlay_load_time = 0; // imem overlay swaps between phases
 
 struct SimCon {
     Vriscv_grid_top *dut;         // Pointer to the DUT (Device Under Test)
@@ -143,6 +162,53 @@ void toggleClock(SimCon &cont) {
 }
 
 
+// Burst access to the TCDM: one word in each bank per cycle. Word w sits in
+// bank w % banks at row w / banks, so a row holds consecutive words. Only use
+// it while the grid is idle, the burst takes the banks from the XBAR.
+void TCDM_burst_write(SimCon &cont, uint32_t baseWord, const std::vector<uint32_t> &words) {
+    const uint32_t banks = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    const uint32_t endWord = baseWord + words.size();
+    for (uint32_t row = baseWord / banks; row * banks < endWord; ++row) {
+        uint32_t lanes = 0;
+        for (uint32_t k = 0; k < banks; ++k) {
+            uint32_t w = row * banks + k;
+            bool inRange = w >= baseWord && w < endWord;
+            cont.dut->host_burst_din[k] = inRange ? words[w - baseWord] : 0;
+            if (inRange) lanes |= 1u << k;
+        }
+        cont.dut->host_burst_req = 1;
+        cont.dut->host_burst_we = 1;
+        cont.dut->host_burst_lane_ena = lanes;
+        cont.dut->host_burst_row = row;
+        toggleClock(cont);
+        load_data_time++;
+    }
+    cont.dut->host_burst_req = 0;
+    cont.dut->host_burst_we = 0;
+    cont.dut->host_burst_lane_ena = 0;
+}
+
+std::vector<uint32_t> TCDM_burst_read(SimCon &cont, uint32_t baseWord, uint32_t count) {
+    const uint32_t banks = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    const uint32_t endWord = baseWord + count;
+    std::vector<uint32_t> words;
+    words.reserve(count);
+    for (uint32_t row = baseWord / banks; row * banks < endWord; ++row) {
+        cont.dut->host_burst_req = 1;
+        cont.dut->host_burst_we = 0;
+        cont.dut->host_burst_row = row;
+        // The banks put the row on host_burst_dout after the clock edge
+        toggleClock(cont);
+        load_data_read_time++;
+        for (uint32_t k = 0; k < banks; ++k) {
+            uint32_t w = row * banks + k;
+            if (w >= baseWord && w < endWord) words.push_back(cont.dut->host_burst_dout[k]);
+        }
+    }
+    cont.dut->host_burst_req = 0;
+    return words;
+}
+
 void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile, 
                 int length, bool writeAsBytes = false, int num_pe = 16) {
     // Open the input file
@@ -189,41 +255,17 @@ void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile,
         inFile.close();
         i = 0;
         
-        // Pack bytes into 32-bit words and write them
-        while (i < bytes.size()) {
-            uint32_t wordData = 0;
-            int bytesInWord = 0;
-            
-            // Pack up to 4 bytes into a single 32-bit word (little-endian)
-            for (int b = 0; b < 4 && (i + b) < bytes.size(); b++) {
-                wordData |= (static_cast<uint32_t>(bytes[i + b]) & 0xFF) << (8 * b);
-                bytesInWord++;
-            }
-            
-            // Write the packed word to memory
-            cont.dut->host_load_store_data_req = 1;
-            cont.dut->host_load_store_req = 1;
-            cont.dut->host_dmem_addr = (baseAddr + (i / 4)) * 4; // Align to word boundary
-            cont.dut->host_dmem_din = wordData;
-            
-            // Debug output with address in both hex and decimal
-            uint32_t addr = cont.dut->host_dmem_addr;
-            // std::cout << "[debug:BYTE_WRITE] Address=0x" << std::hex << addr
-            //           << " (" << std::dec << addr << ")"
-            //           << " Data=0x" << std::hex << wordData << std::dec << " (";
-            for (int b = 0; b < bytesInWord; b++) {
-                std::cout << (b > 0 ? ", " : "") << static_cast<int>(bytes[i + b]);
-            }
-            std::cout << ")" << std::endl;
-            
-            // Toggle clock
-            toggleClock(cont);
-            load_data_time++;
-            i += bytesInWord;
+        // Pack bytes into 32-bit words (little-endian) and write them a row at a time
+        std::vector<uint32_t> words((bytes.size() + 3) / 4, 0);
+        for (size_t b = 0; b < bytes.size(); b++) {
+            words[b / 4] |= (static_cast<uint32_t>(bytes[b]) & 0xFF) << (8 * (b % 4));
         }
+        TCDM_burst_write(cont, baseAddr, words);
+        i = bytes.size();
     } else {
         // Original word-based write
         if (baseAddr < 524288/4 - 1) { // normal write to TCDM 
+            std::vector<uint32_t> words;
             while (i < length && std::getline(inFile, line)) {
                 // Skip empty lines or comment lines
                 if (line.empty() || (line.size() >= 2 && line.substr(0, 2) == "//")) {
@@ -239,23 +281,10 @@ void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile,
                     break;
                 }
 
-                // Set the signals for memory write
-                cont.dut->host_load_store_data_req = 1;
-                cont.dut->host_load_store_req = 1;
-                cont.dut->host_dmem_addr = (baseAddr + i) * 4;
-                cont.dut->host_dmem_din = data;
-                
-                // Debug output with address in both hex and decimal
-                uint32_t addr = cont.dut->host_dmem_addr;
-                std::cout << "[debug:WORD_WRITE] Address=0x" << std::hex << addr
-                        << " (" << std::dec << addr << ")"
-                        << " Data=" << data << std::endl;
-                
-                // Toggle clock
-                toggleClock(cont);
-                load_data_time++;
+                words.push_back(data);
                 i++;
             }
+            TCDM_burst_write(cont, baseAddr, words);
         } else {
             // write to local mem
             while (i < length && std::getline(inFile, line)) {
@@ -332,32 +361,17 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
     std::vector<int32_t> results;
     results.reserve(readAsBytes ? length * 4 : length);  // Pre-allocate
 
-    // For each iteration, we read one 32-bit word from memory
+    // Read the words a row at a time, then log them one by one
+    std::vector<uint32_t> words = TCDM_burst_read(cont, baseAddr, length);
     for (int i = 0; i < length; ++i) {
-        // Prepare the address (word-aligned if we do "word" reads).
-        // If your memory is strictly word-addressed, the address might be (baseAddr + i).
-        // But traditionally, with a byte-addressed bus, you do (baseAddr + i*4) for each word.
-        uint32_t currentAddress = (baseAddr + i) * 4;
-
-        // Drive signals to request a 32-bit read at `currentAddress`.
-        cont.dut->host_load_store_data_req = 1;
-        cont.dut->host_load_store_req      = 0;  // 0 for load, 1 for store if you have that convention
-        cont.dut->host_dmem_addr          = currentAddress;
-        cont.dut->host_dmem_din           = 0;   // Not used for loads
-
-        // Toggle clock to latch address/req signals
-        toggleClock(cont);
-        load_data_read_time++; 
-        // The DUT should place valid data on host_dmem_out
-        // Convert the 32-bit output to a signed integer
-        int32_t wordVal = static_cast<int32_t>(cont.dut->host_dmem_out);
+        int32_t wordVal = static_cast<int32_t>(words[i]);
 
         if (!readAsBytes) {
             // WORD MODE:  push back the entire 32-bit word
             results.push_back(wordVal);
             outFile << wordVal << "\n";  // log the word
             // Debug print (optional)
-            uint32_t addr = cont.dut->host_dmem_addr;
+            uint32_t addr = (baseAddr + i) * 4;
             std::cout << "[debug:WORD] Address=0x" << std::hex << addr
                       << " (" << std::dec << addr << ")"
                       << " Data=" << std::dec << wordVal
@@ -381,7 +395,7 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
 
                 // Log to file and output as signed value
                 outFile << byteVal << "\n";
-                uint32_t addr = cont.dut->host_dmem_addr;
+                uint32_t addr = (baseAddr + i) * 4;
                 std::cout << "[debug:BYTE] Address=0x" << std::hex << addr
                           << " (" << std::dec << addr << ")"
                           << " ByteIndex=" << std::dec << b
@@ -395,7 +409,203 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
     return results;
 }
 
+// Re-encode the LUI/ADDI pair loading a base register. The constant is split
+// like dfg_processor does, the ADDI immediate is sign-extended by the core.
+void encodeBaseLoad(uint32_t reg, int32_t value, uint32_t &lui, uint32_t &addi) {
+    uint32_t lower12 = value & 0xFFF;
+    uint32_t upper20 = ((value >> 12) + ((lower12 & 0x800) ? 1 : 0)) & 0xFFFFF;
+    lui  = (upper20 << 12) | (reg << 7) | 0x37;
+    addi = (lower12 << 20) | (reg << 15) | (reg << 7) | 0x13;
+}
+
+void writeInstruction(SimCon &cont, uint32_t address, uint32_t data, int &instructionCount) {
+    // Assign values to 'dut' and call 'toggleClock'
+    cont.dut->imem_addra = address;
+    cont.dut->imem_dina = data;
+    
+    instructionCount++;
+
+    // For debugging
+    std::cout << "Loading instruction " << instructionCount << " - Address: 0x" << std::hex << address 
+              << " (bit 10: " << ((address & 0x400) ? "1" : "0") 
+              << ", PE: " << ((address >> 10) & 0xF) << ")"
+              << " Data: 0x" << data << std::dec << std::endl;
+
+    toggleClock(cont);
+    load_inst_time++; 
+}
+
+// Read-only mapping of grid_image.kgi. The section, placement and lockstep
+// tables and the word pool are used in place, nothing is parsed or copied.
+class GridImageFile {
+public:
+    explicit GridImageFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(GridImageHeader)) {
+            size = st.st_size;
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const uint8_t*>(mapped);
+            }
+        }
+        close(fd);  // The mapping stays valid
+        if (data == nullptr) return;
+
+        const GridImageHeader& h = header();
+        uint64_t expected = sizeof(GridImageHeader) + (uint64_t)h.num_sections * sizeof(GridSection) + 
+                            (uint64_t)h.num_placements * sizeof(GridPlacement) + 
+                            (uint64_t)h.num_lockstep * sizeof(GridLockstep) + (uint64_t)h.num_words * 4;
+        if (h.magic != kGridImageMagic || h.version != kGridImageVersion || expected > size) {
+            munmap(const_cast<uint8_t*>(data), size);
+            data = nullptr;
+        }
+    }
+    ~GridImageFile() {
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+    }
+    GridImageFile(const GridImageFile&) = delete;
+    GridImageFile& operator=(const GridImageFile&) = delete;
+
+    bool valid() const { return data != nullptr; }
+    const GridImageHeader& header() const { return *reinterpret_cast<const GridImageHeader*>(data); }
+    const GridSection* sections() const { 
+        return reinterpret_cast<const GridSection*>(data + sizeof(GridImageHeader)); 
+    }
+    const GridPlacement* placements() const { 
+        return reinterpret_cast<const GridPlacement*>(sections() + header().num_sections); 
+    }
+    const GridLockstep* lockstep() const { 
+        return reinterpret_cast<const GridLockstep*>(placements() + header().num_placements); 
+    }
+    const uint32_t* words() const { 
+        return reinterpret_cast<const uint32_t*>(lockstep() + header().num_lockstep); 
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+bool isGridImage(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".kgi") == 0;
+}
+
+// A lockstep follower needs its leader in the same grid instance of `block`
+// PEs, the one fetching for it
+bool lockstepPaired(const GridLockstep& entry, uint32_t block) {
+    return entry.pe / block == entry.leader / block;
+}
+
+// Visit every (imem address, word) the image writes before the given overlay
+// segment runs, in the order of combined_memory.mem and overlay_memory.mem.
+// A lockstep follower whose leader sits in another grid instance of `block`
+// PEs gets a copy of the leader's execution sections.
+template <typename Visit>
+void forEachGridWord(const GridImageFile& image, uint32_t segment, uint32_t block, Visit visit) {
+    const GridImageHeader& header = image.header();
+    std::multimap<uint32_t, uint32_t> copies;  // leader -> unpaired follower
+    for (uint32_t l = 0; l < header.num_lockstep; l++) {
+        const GridLockstep& entry = image.lockstep()[l];
+        if (!lockstepPaired(entry, block)) {
+            copies.emplace(entry.leader, entry.pe);
+        }
+    }
+    for (uint32_t p = 0; p < header.num_placements; p++) {
+        const GridPlacement& placement = image.placements()[p];
+        if (placement.segment != segment) continue;
+        if (placement.section >= header.num_sections) {
+            std::cerr << "Grid image placement " << p << " uses unknown section " << placement.section << std::endl;
+            continue;
+        }
+        const GridSection& section = image.sections()[placement.section];
+        if ((uint64_t)section.first_word + section.num_words > header.num_words) {
+            std::cerr << "Grid image section " << placement.section << " exceeds the word pool" << std::endl;
+            continue;
+        }
+        const uint32_t* words = image.words() + section.first_word;
+        auto place = [&](uint32_t pe) {
+            for (uint32_t w = 0; w < section.num_words; w++) {
+                visit((((pe & 0xFF) << 10) | (placement.address + w)) & 0xFFFF, words[w]);
+            }
+        };
+        place(placement.pe);
+        if (placement.address != kPreloadBase) {
+            auto [first, last] = copies.equal_range(placement.pe);
+            for (auto it = first; it != last; ++it) {
+                place(it->second);
+            }
+        }
+    }
+}
+
+// PEs currently following a leader, cleared before the next program loads
+std::vector<uint32_t> lockstepFollowers;
+
+void writeLockstep(SimCon &cont, uint32_t pe, uint32_t leader) {
+    cont.dut->lockstep_we = 1;
+    cont.dut->lockstep_pe = pe;
+    cont.dut->lockstep_leader = leader;
+    toggleClock(cont);
+    cont.dut->lockstep_we = 0;
+    load_inst_time++;
+}
+
+// Program the lockstep table, followers of the previous program are dropped
+void loadLockstepTable(SimCon &cont, const GridLockstep* entries, uint32_t count, uint32_t block) {
+    for (uint32_t pe : lockstepFollowers) {
+        writeLockstep(cont, pe, pe);
+    }
+    lockstepFollowers.clear();
+    for (uint32_t l = 0; l < count; l++) {
+        if (lockstepPaired(entries[l], block)) {
+            writeLockstep(cont, entries[l].pe, entries[l].leader);
+            lockstepFollowers.push_back(entries[l].pe);
+        }
+    }
+    if (count > 0) {
+        std::cout << "Lockstep: " << lockstepFollowers.size() << " of " << count 
+                  << " followers fetch from their leader" << std::endl;
+    }
+}
+
+// Load the base image (overlay segment 0) of grid_image.kgi
+void loadGridImage(SimCon &cont, const std::string& inputFile) {
+    std::cout << ">> inputFile: " << inputFile << std::endl;
+    GridImageFile image(inputFile);
+    if (!image.valid()) {
+        std::cerr << "Error opening grid image: " << inputFile << std::endl;
+        return;
+    }
+
+    uint32_t block = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    cont.dut->imem_wea = 0xF;
+    int instructionCount = 0;
+    forEachGridWord(image, 0, block, [&](uint32_t address, uint32_t data) {
+        writeInstruction(cont, address, data, instructionCount);
+    });
+    cont.dut->imem_wea = 0x0;
+    toggleClock(cont);
+    loadLockstepTable(cont, image.lockstep(), image.header().num_lockstep, block);
+
+    std::cout << "Instruction loading complete. Loaded " << instructionCount << " instructions." << std::endl;
+}
+
+// Loads combined_memory.mem or template_memory.mem, grid_image.kgi goes to
+// loadGridImage. A template image holds one program per template with the PE
+// field cleared, a "slots" line naming the base registers and one
+// "patch PE TEMPLATE CONSTANT..." line per PE. Slot i is the LUI/ADDI pair at
+// preload words 2i and 2i+1 of the template.
 void loadInstructions(SimCon &cont, const std::string& inputFile) {
+    if (isGridImage(inputFile)) {
+        loadGridImage(cont, inputFile);
+        return;
+    }
+    loadLockstepTable(cont, nullptr, 0, 1);
+
     std::ifstream inFile(inputFile);
     std::cout << ">> inputFile: " << inputFile << std::endl;
     if (!inFile.is_open()) {
@@ -408,6 +618,9 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
     
     std::string line;
     int instructionCount = 0;
+    std::vector<uint32_t> slots;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> templates;
+    int currentTemplate = -1;
     
     while (std::getline(inFile, line)) {
         // Skip empty lines
@@ -416,6 +629,51 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
         // Skip comment lines (starting with '//')
         if (line.substr(0, 2) == "//") continue;
 
+        std::istringstream directive(line);
+        std::string keyword;
+        directive >> keyword;
+        if (keyword == "slots") {
+            std::string reg;
+            while (directive >> reg) {
+                slots.push_back(std::stoul(reg.substr(1)));
+            }
+            continue;
+        }
+        if (keyword == "template") {
+            directive >> currentTemplate;
+            if ((int)templates.size() <= currentTemplate) {
+                templates.resize(currentTemplate + 1);
+            }
+            continue;
+        }
+        if (keyword == "patch") {
+            int pe, templateId;
+            directive >> pe >> templateId;
+            std::vector<int32_t> constants;
+            int32_t constant;
+            while (directive >> constant) {
+                constants.push_back(constant);
+            }
+            if (templateId < 0 || templateId >= (int)templates.size()) {
+                std::cerr << "Patch of PE " << pe << " uses unknown template " << templateId << std::endl;
+                continue;
+            }
+
+            // Expand the template at the PE address, base constants go into
+            // the slot words of the preload section
+            for (const auto& [offset, word] : templates[templateId]) {
+                uint32_t data = word;
+                uint32_t slot = (offset & ~0x200u) / 2;
+                if ((offset & 0x200) && slot < constants.size() && slot < slots.size()) {
+                    uint32_t lui, addi;
+                    encodeBaseLoad(slots[slot], constants[slot], lui, addi);
+                    data = (offset & 1) ? addi : lui;
+                }
+                writeInstruction(cont, (offset | (pe << 10)) & 0xFFFF, data, instructionCount);
+            }
+            continue;
+        }
+
         // The format is "@HHHHHHHH HHHHHHHH" where the first part is the address
         // and the second part is the instruction data
         if (line[0] != '@') {
@@ -434,20 +692,11 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
             // Convert hex data to integer
             uint32_t data = std::stoul(hexData, nullptr, 16);
 
-            // Assign values to 'dut' and call 'toggleClock'
-            cont.dut->imem_addra = address;
-            cont.dut->imem_dina = data;
-            
-            instructionCount++;
-
-            // For debugging
-            std::cout << "Loading instruction " << instructionCount << " - Address: 0x" << std::hex << address 
-                      << " (bit 10: " << ((address & 0x400) ? "1" : "0") 
-                      << ", PE: " << ((address >> 10) & 0xF) << ")"
-                      << " Data: 0x" << data << std::dec << std::endl;
-
-            toggleClock(cont);
-            load_inst_time++; 
+            if (currentTemplate >= 0) {
+                templates[currentTemplate].push_back({address, data});
+            } else {
+                writeInstruction(cont, address, data, instructionCount);
+            }
         } else {
             std::cerr << "Failed to parse line: " << line << std::endl;
         }
@@ -460,11 +709,220 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
     std::cout << "Instruction loading complete. Loaded " << instructionCount << " instructions." << std::endl;
 }
 
+// Prefer the binary grid image of an output folder, then the template image,
+// then the combined image
+std::string programImagePath(const std::string& outputFolder) {
+    std::string gridPath = outputFolder + "/grid_image.kgi";
+    if (std::ifstream(gridPath).good()) {
+        return gridPath;
+    }
+    std::string templatePath = outputFolder + "/template_memory.mem";
+    if (std::ifstream(templatePath).good()) {
+        return templatePath;
+    }
+    return outputFolder + "/combined_memory.mem";
+}
+
+// Tile schedule emitted by dfg_processor for double-buffered execution
+struct TileSchedule {
+    int num_tiles = 1;
+    uint32_t buffer_stride = 0;   // bytes between ping and pong buffer
+    int tile_words = 0;
+    std::vector<uint32_t> buffers; // ping byte address of each double buffer
+};
+
+bool loadTileSchedule(const std::string &scheduleFile, TileSchedule &schedule) {
+    std::ifstream inFile(scheduleFile);
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Failed to open tile schedule " << scheduleFile << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(inFile, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+        if (key == "num_tiles") {
+            iss >> schedule.num_tiles;
+        } else if (key == "buffer_stride") {
+            iss >> schedule.buffer_stride;
+        } else if (key == "tile_words") {
+            iss >> schedule.tile_words;
+        } else if (key == "buffer") {
+            std::string reg;
+            uint32_t addr;
+            iss >> reg >> addr;
+            schedule.buffers.push_back(addr);
+        }
+    }
+    std::cout << ">> tile schedule: " << schedule.num_tiles << " tiles of " 
+              << schedule.tile_words << " words" << std::endl;
+    return true;
+}
+
+std::vector<int32_t> readDataFile(const std::string &dataFile, int length) {
+    std::ifstream inFile(dataFile);
+    std::vector<int32_t> data;
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Failed to open file " << dataFile << " for reading" << std::endl;
+        return data;
+    }
+
+    std::string line;
+    while ((int)data.size() < length && std::getline(inFile, line)) {
+        if (line.empty() || (line.size() >= 2 && line.substr(0, 2) == "//")) {
+            continue;
+        }
+        data.push_back(std::stoi(line));
+    }
+    return data;
+}
+
+// Host DMA model: a queue of word writes drained through the host TCDM port,
+// one word per cycle whenever the XBar grants the host request.
+struct HostDMA {
+    std::vector<uint32_t> addr;   // word addresses
+    std::vector<int32_t> data;
+    size_t head = 0;
+
+    bool busy() const { return head < addr.size(); }
+};
+
+void DMA_enqueue(HostDMA &dma, uint32_t baseAddr, const std::vector<int32_t> &src, 
+                 size_t first, size_t count) {
+    for (size_t i = 0; i < count && first + i < src.size(); i++) {
+        dma.addr.push_back(baseAddr + i);
+        dma.data.push_back(src[first + i]);
+    }
+}
+
+// Advance one clock cycle, issuing the next queued DMA write if any.
+// Returns true when a word was accepted by the TCDM.
+bool DMA_cycle(SimCon &cont, HostDMA &dma) {
+    if (!dma.busy()) {
+        cont.dut->host_load_store_data_req = 0;
+        cont.dut->host_load_store_req = 0;
+        toggleClock(cont);
+        return false;
+    }
+
+    cont.dut->host_load_store_data_req = 1;
+    cont.dut->host_load_store_req = 1;
+    cont.dut->host_dmem_addr = dma.addr[dma.head] * 4;
+    cont.dut->host_dmem_din = dma.data[dma.head];
+    cont.dut->eval();
+    bool granted = cont.dut->host_load_store_grant_i;
+
+    toggleClock(cont);
+    if (granted) {
+        dma.head++;
+    } else {
+        dma_stall_time++;
+    }
+
+    if (!dma.busy()) {
+        cont.dut->host_load_store_data_req = 0;
+        cont.dut->host_load_store_req = 0;
+    }
+    return granted;
+}
+
+// Drain the DMA queue while the PEs are idle, the transfer is fully exposed
+void DMA_drain(SimCon &cont, HostDMA &dma) {
+    while (dma.busy()) {
+        if (DMA_cycle(cont, dma)) {
+            dma_exposed_time++;
+        }
+    }
+    toggleClock(cont);
+}
+
+// Queue tile `tile` of every double buffer into buffer (tile % 2)
+void DMA_enqueueTile(HostDMA &dma, const TileSchedule &schedule, 
+                     const std::vector<std::vector<int32_t>> &tileData, int tile) {
+    if (tile >= schedule.num_tiles) return;
+    for (size_t b = 0; b < schedule.buffers.size() && b < tileData.size(); b++) {
+        uint32_t byteAddr = schedule.buffers[b] + (tile % 2) * schedule.buffer_stride;
+        DMA_enqueue(dma, byteAddr / 4, tileData[b], 
+                    (size_t)tile * schedule.tile_words, schedule.tile_words);
+    }
+}
+
+// Parse overlay_memory.mem into per-segment (address, data) lists. Segment 0
+// lives in combined_memory.mem, so index 0 stays empty. A missing file means
+// the program fits the instruction memory.
+std::vector<std::vector<std::pair<uint32_t, uint32_t>>> loadOverlayFile(const std::string& inputFile) {
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> segments;
+    std::ifstream inFile(inputFile);
+    if (!inFile.is_open()) {
+        return segments;
+    }
+
+    std::string line;
+    int segment = 0;
+    while (std::getline(inFile, line)) {
+        if (line.empty()) continue;
+        if (line.substr(0, 10) == "// Segment") {
+            segment = std::stoi(line.substr(10));
+            if ((int)segments.size() <= segment) {
+                segments.resize(segment + 1);
+            }
+            continue;
+        }
+        if (line[0] != '@' || segment == 0) continue;
+
+        std::istringstream iss(line.substr(1));
+        std::string hexAddress, hexData;
+        if (iss >> hexAddress >> hexData) {
+            segments[segment].push_back({std::stoul(hexAddress, nullptr, 16) & 0xFFFF, 
+                                         std::stoul(hexData, nullptr, 16)});
+        }
+    }
+    std::cout << ">> overlay segments: " << segments.size() << std::endl;
+    return segments;
+}
+
+// Overlay segments of grid_image.kgi in the layout of loadOverlayFile, for a
+// grid of `block` PEs
+std::vector<std::vector<std::pair<uint32_t, uint32_t>>> loadGridOverlays(const std::string& inputFile, uint32_t block) {
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> segments;
+    GridImageFile image(inputFile);
+    if (!image.valid() || image.header().num_segments <= 1) {
+        return segments;
+    }
+    segments.resize(image.header().num_segments);
+    for (uint32_t segment = 1; segment < segments.size(); segment++) {
+        forEachGridWord(image, segment, block, [&](uint32_t address, uint32_t data) {
+            segments[segment].push_back({address, data});
+        });
+    }
+    std::cout << ">> overlay segments: " << segments.size() << std::endl;
+    return segments;
+}
+
+// Swap one overlay segment into the execution sections of the PEs
+void loadOverlaySegment(SimCon &cont, const std::vector<std::pair<uint32_t, uint32_t>>& entries) {
+    cont.dut->imem_wea = 0xF;
+    for (const auto& [address, data] : entries) {
+        cont.dut->imem_addra = address;
+        cont.dut->imem_dina = data;
+        toggleClock(cont);
+        overlay_load_time++;
+    }
+    cont.dut->imem_wea = 0x0;
+    toggleClock(cont);
+}
+
 void generateReport(const std::string& folderName, vluint64_t sim_time, vluint64_t measure_time, 
                     bool resultsMatch, int grid_div, int N_R, int N_C, const uint32_t* dbg_mem_conflict,
                     vluint64_t load_inst_time, vluint64_t load_data_time, vluint64_t load_data_read_time, 
                     vluint64_t preload_time, int arb_policy, 
-                    const uint32_t* dbg_ic, const uint32_t* dbg_ic_trap) {
+                    const uint32_t* dbg_ic, const uint32_t* dbg_ic_trap, const uint32_t* dbg_ld2,
+                    const uint32_t* dbg_lb_hit,
+                    int num_tiles, vluint64_t dma_hidden_time, vluint64_t dma_exposed_time,
+                    vluint64_t dma_stall_time, size_t overlay_segments, vluint64_t overlay_load_time) {
     // Create rpt directory if it doesn't exist
     std::string rptDir = "./rpt";
     if (system(("mkdir -p " + rptDir).c_str()) != 0) {
@@ -495,10 +953,30 @@ void generateReport(const std::string& folderName, vluint64_t sim_time, vluint64
     reportFile << "Total simulation time: " << (sim_time/2) * CLOCK_PERIOD_NS << " ns\n";
     reportFile << "Execution Cycle: " << measure_time << " cycles\n";
     reportFile << "Load Instruction: " << load_inst_time << " cycles\n";
+    if (!lockstepFollowers.empty()) {
+        reportFile << "Lockstep followers: " << lockstepFollowers.size() << " PEs fetch from a leader\n";
+    }
     reportFile << "Load Data: " << load_data_time << " cycles\n";
     reportFile << "Read Data: " << load_data_read_time << " cycles\n";
     reportFile << "Preload: " << preload_time << " cycles\n\n";
 
+    if (overlay_segments > 1) {
+        reportFile << "Instruction Overlays:\n";
+        reportFile << "Overlay Segments: " << overlay_segments << "\n";
+        reportFile << "Overlay Load: " << overlay_load_time << " cycles\n\n";
+    }
+
+    if (num_tiles > 1) {
+        vluint64_t dma_total = dma_hidden_time + dma_exposed_time;
+        double overlap = dma_total ? (100.0 * dma_hidden_time) / dma_total : 0.0;
+        reportFile << "Tiled Execution:\n";
+        reportFile << "Tiles: " << num_tiles << "\n";
+        reportFile << "DMA Hidden: " << dma_hidden_time << " cycles\n";
+        reportFile << "DMA Exposed: " << dma_exposed_time << " cycles\n";
+        reportFile << "DMA Stall: " << dma_stall_time << " cycles\n";
+        reportFile << "Overlap Efficiency: " << overlap << " %\n\n";
+    }
+
 
     reportFile << "Memory Conflict:\n";
     int max_mem_conflict = 0;
@@ -519,6 +997,25 @@ void generateReport(const std::string& folderName, vluint64_t sim_time, vluint64
     for (int i = 0; i < N_R * N_C; i++) {
         reportFile << "PE " << i << ": " << dbg_ic_trap[i] << "\n";
     }
+
+    // Paired-word loads, only reported for programs that use them
+    uint64_t ld2_total = 0;
+    for (int i = 0; i < N_R * N_C; i++) {
+        ld2_total += dbg_ld2[i];
+    }
+    if (ld2_total > 0) {
+        reportFile << "\npsrf.ld2 pairs per PE:\n";
+        for (int i = 0; i < N_R * N_C; i++) {
+            reportFile << "PE " << i << ": " << dbg_ld2[i] << "\n";
+        }
+    }
+
+    // Instruction fetches served by the hardware-loop buffer instead of imem
+    reportFile << "\nLoop buffer hits per PE:\n";
+    for (int i = 0; i < N_R * N_C; i++) {
+        double hit_rate = dbg_ic[i] ? 100.0 * dbg_lb_hit[i] / dbg_ic[i] : 0.0;
+        reportFile << "PE " << i << ": " << dbg_lb_hit[i] << " (" << hit_rate << " % of instructions)\n";
+    }
     
     reportFile << "Verification Results:\n";
     reportFile << "Results match golden output: " << (resultsMatch ? "Yes" : "No") << "\n";
@@ -578,10 +1075,10 @@ int main(int argc, char **argv) {
         std::cout << "Suffix: " << suffix << std::endl;
     }
 
-    std::string memoryPath = "../../software/output/" + folderName + "/combined_memory.mem";
+    std::string memoryPath = programImagePath("../../software/output/" + folderName);
     if (operationType == "2mm") {
         std::cout << ">> 2mm_1 get memory path" << std::endl;
-        memoryPath_state2 = "../../software/output/" + base_name + "_2/combined_memory.mem";
+        memoryPath_state2 = programImagePath("../../software/output/" + base_name + "_2");
     }
     std::cout << ">> memoryPath_state2: " << memoryPath_state2 << std::endl;
 
@@ -596,6 +1093,11 @@ int main(int argc, char **argv) {
     std::vector<uint32_t> data_golden;
     bool readAsBytes = false; 
 
+    // Double-buffered tiling state, only used by the tiled operation types
+    TileSchedule tileSchedule;
+    HostDMA hostDMA;
+    std::vector<std::vector<int32_t>> tileData;
+
     // Enable waveform dump
     Verilated::traceEverOn(true);
     VerilatedVcdC *trace = nullptr;
@@ -621,10 +1123,14 @@ int main(int argc, char **argv) {
     dut->imem_dina = 0;
     dut->imem_wea = 0;
     dut->imem_addra = 0;
+    dut->lockstep_we = 0;
     dut->host_load_store_data_req = 0;
     dut->host_load_store_req = 0;
     dut->host_dmem_addr = 0;
     dut->host_dmem_din = 0;
+    dut->host_burst_req = 0;
+    dut->host_burst_we = 0;
+    dut->host_burst_lane_ena = 0;
     dut->grid_div = grid_div;
     dut->tcdm_arb_policy = arb_policy;
     dut->mode_select = 0; // 0 --> shared mode, 1 --> bypass mode
@@ -652,6 +1158,16 @@ int main(int argc, char **argv) {
     } else if (operationType == "gemm" || operationType == "gemmadd64x64") {
         TCDM_write(simcont, 200/4, "../../software/kernel/gemm/ncubed/input_A.data", 4096, false, 16);
         TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false, 16);
+    } else if (operationType == "gemm_tiled") {
+        // B stays resident, A is streamed tile by tile into the ping/pong buffers
+        TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false, 16);
+        if (!loadTileSchedule("../../software/output/" + folderName + "/tile_schedule.txt", tileSchedule)) {
+            return 1;
+        }
+        tileData.push_back(readDataFile("../../software/kernel/gemm/ncubed/input_A.data", 
+                                        tileSchedule.num_tiles * tileSchedule.tile_words));
+        DMA_enqueueTile(hostDMA, tileSchedule, tileData, 0);
+        DMA_drain(simcont, hostDMA);
     } else if (operationType == "gemm32x32" || operationType == "gemmadd32x32") {
         //TCDM_write(simcont, 200/4, "../../software/kernel/gemm_32x32/ncubed/input_A.data", 1024, false);
         //TCDM_write(simcont, 20000/4, "../../software/kernel/gemm_32x32/ncubed/input_B.data", 1024, false);
@@ -692,6 +1208,9 @@ int main(int argc, char **argv) {
     toggleClock(simcont);
 
     loadInstructions(simcont, memoryPath);
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> overlaySegments = isGridImage(memoryPath) ?
+        loadGridOverlays(memoryPath, dut->dbg_nr * dut->dbg_nc) :
+        loadOverlayFile("../../software/output/" + folderName + "/overlay_memory.mem");
 
 
     toggleClock(simcont);
@@ -736,9 +1255,14 @@ int main(int argc, char **argv) {
     temporal_conflicts.reserve(5000000); // Pre-allocate space for efficiency
     finish_conflicts.reserve(5000000);
 
+    // Stream the next tile while the PEs compute on the first one
+    DMA_enqueueTile(hostDMA, tileSchedule, tileData, 1);
+
     int jjj = 0 ;
     while (!dut->finish && sim_time < SIM_TIME_LIMIT) {
-        toggleClock(simcont);
+        if (DMA_cycle(simcont, hostDMA)) {
+            dma_hidden_time++;
+        }
         period_debug++;
         measure_time++; 
         
@@ -767,6 +1291,63 @@ int main(int argc, char **argv) {
     toggleClock(simcont);
     dut->rst = 0;
 
+    // Remaining imem overlay segments. Each phase swaps the next segment into
+    // the execution sections and restarts the PEs; registers, PSRF/CoRF and
+    // TCDM contents carry over from the previous phase.
+    for (size_t segment = 1; segment < overlaySegments.size(); segment++) {
+        loadOverlaySegment(simcont, overlaySegments[segment]);
+
+        dut->inst_en = 1;
+        toggleClock(simcont);
+        measure_time++;
+        temporal_conflicts.push_back(dut->dbg_mc_temporal_out);
+        finish_conflicts.push_back(dut->dbg_finish);
+
+        std::cout << ">> start overlay segment " << segment << std::endl; 
+        while (!dut->finish && sim_time < SIM_TIME_LIMIT) {
+            toggleClock(simcont);
+            measure_time++; 
+
+            temporal_conflicts.push_back(dut->dbg_mc_temporal_out);
+            finish_conflicts.push_back(dut->dbg_finish);
+        }
+
+        dut->inst_en = 0;
+        dut->rst = 1;
+        toggleClock(simcont);
+        dut->rst = 0;
+    }
+
+    // Remaining tiles of a double-buffered kernel. The base registers keep the
+    // values set by the buffer swap point across the reset, only the PC and
+    // loop state restart. Whatever the previous tile did not hide is exposed.
+    for (int tile = 1; tile < tileSchedule.num_tiles; tile++) {
+        DMA_drain(simcont, hostDMA);
+        DMA_enqueueTile(hostDMA, tileSchedule, tileData, tile + 1);
+
+        dut->inst_en = 1;
+        toggleClock(simcont);
+        measure_time++;
+        temporal_conflicts.push_back(dut->dbg_mc_temporal_out);
+        finish_conflicts.push_back(dut->dbg_finish);
+
+        std::cout << ">> start tile " << tile << std::endl; 
+        while (!dut->finish && sim_time < SIM_TIME_LIMIT) {
+            if (DMA_cycle(simcont, hostDMA)) {
+                dma_hidden_time++;
+            }
+            measure_time++; 
+
+            temporal_conflicts.push_back(dut->dbg_mc_temporal_out);
+            finish_conflicts.push_back(dut->dbg_finish);
+        }
+
+        dut->inst_en = 0;
+        dut->rst = 1;
+        toggleClock(simcont);
+        dut->rst = 0;
+    }
+
     // Perform second state of 2mm
     // Data is already stored in TCDM.
     // Everything is the same as the first state.
@@ -885,7 +1466,7 @@ int main(int argc, char **argv) {
                 << " bytes (technically stored in int32_t) from 0x" << std::hex << baseAddress 
                 << ". They are also logged in " << outFileBytes << std::dec << std::endl;
 
-    } else if (operationType == "gemm" || operationType == "gemmadd64x64") {   
+    } else if (operationType == "gemm" || operationType == "gemmadd64x64" || operationType == "gemm_tiled") {   
         baseAddress = (40004)/4;    // The starting address from which to read
         length = 4096;         // N
         readAsBytes = false; 
@@ -999,7 +1580,7 @@ int main(int argc, char **argv) {
     if (operationType == "conv") {
         std::string goldenFile = "../../software/kernel/conv_int8/output.txt";
         resultsMatch = compareResults(byteData, goldenFile);
-    } else if (operationType == "gemm" || operationType == "gemm_dup" ) {
+    } else if (operationType == "gemm" || operationType == "gemm_dup" || operationType == "gemm_tiled") {
         std::string goldenFile = "../../software/kernel/gemm/ncubed/output_raw.data";
         resultsMatch = compareResults(byteData, goldenFile);
     } else if (operationType == "gemm32x32") {
@@ -1046,7 +1627,9 @@ int main(int argc, char **argv) {
     }
     int cluster_value = 0; 
     generateReport(folderName, sim_time, measure_time, resultsMatch, grid_div, dut->dbg_nr, dut->dbg_nc, dut->dbg_mem_conflict, 
-        load_inst_time, load_data_time, load_data_read_time, preload_time, arb_policy, dut->dbg_ic, dut->dbg_ic_trap);
+        load_inst_time, load_data_time, load_data_read_time, preload_time, arb_policy, dut->dbg_ic, dut->dbg_ic_trap, dut->dbg_ld2, dut->dbg_lb_hit,
+        tileSchedule.num_tiles, dma_hidden_time, dma_exposed_time, dma_stall_time,
+        overlaySegments.empty() ? 1 : overlaySegments.size(), overlay_load_time);
 
     delete dut;
     std::cout << "Simulation finished at time: " << (sim_time/2) * CLOCK_PERIOD_NS << " ns" << std::endl;
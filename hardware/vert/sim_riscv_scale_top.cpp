@@ -38,6 +38,10 @@
 //   - This harness targets the scalable `Vriscv_scalable` top-level with clusters.
 //   - Temporal and finish conflict traces are written under `./rpt_tc` and `./rpt_fc`.
 //   - Summary reports for each configuration are written under `./rpt`.
+//   - A `template_memory.mem` in the output folder takes precedence over
+//     `combined_memory.mem` and is expanded per PE while loading.
+//   - A binary `grid_image.kgi` takes precedence over both and is mapped
+//     with mmap.
 // ============================================================================
 
 #include <verilated.h>
@@ -51,7 +55,13 @@
 #include <string>    // For std::string
 #include <algorithm> // For std::remove
 #include <vector>
+#include <map>
 #include <regex>
+#include <sys/mman.h> // For mmap of the grid image
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../../software/kira_image.h"
 #include "Vriscv_scalable.h"
 
 #define CLOCK_PERIOD_NS 10
@@ -64,6 +74,7 @@ int cluster_value;
 
 vluint64_t load_inst_time = 0; 
 vluint64_t load_data_time = 0; 
+vluint64_t load_data_unicast_time = 0; // load data time with one cluster per write
 vluint64_t load_data_read_time = 0; 
 vluint64_t preload_time = 0; 
 
@@ -142,6 +153,53 @@ void toggleClock(SimCon &cont) {
     cont.sim_time++;
 }
 
+// Burst access to the TCDM: one word in each bank per cycle. Word w sits in
+// bank w % banks at row w / banks, so a row holds consecutive words. Only use
+// it while the grid is idle, the burst takes the banks from the XBAR.
+void TCDM_burst_write(SimCon &cont, uint32_t baseWord, const std::vector<uint32_t> &words) {
+    const uint32_t banks = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    const uint32_t endWord = baseWord + words.size();
+    for (uint32_t row = baseWord / banks; row * banks < endWord; ++row) {
+        uint32_t lanes = 0;
+        for (uint32_t k = 0; k < banks; ++k) {
+            uint32_t w = row * banks + k;
+            bool inRange = w >= baseWord && w < endWord;
+            cont.dut->host_burst_din[k] = inRange ? words[w - baseWord] : 0;
+            if (inRange) lanes |= 1u << k;
+        }
+        cont.dut->host_burst_req = 1;
+        cont.dut->host_burst_we = 1;
+        cont.dut->host_burst_lane_ena = lanes;
+        cont.dut->host_burst_row = row;
+        toggleClock(cont);
+        load_data_time++;
+    }
+    cont.dut->host_burst_req = 0;
+    cont.dut->host_burst_we = 0;
+    cont.dut->host_burst_lane_ena = 0;
+}
+
+std::vector<uint32_t> TCDM_burst_read(SimCon &cont, uint32_t baseWord, uint32_t count) {
+    const uint32_t banks = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    const uint32_t endWord = baseWord + count;
+    std::vector<uint32_t> words;
+    words.reserve(count);
+    for (uint32_t row = baseWord / banks; row * banks < endWord; ++row) {
+        cont.dut->host_burst_req = 1;
+        cont.dut->host_burst_we = 0;
+        cont.dut->host_burst_row = row;
+        // The banks put the row on host_burst_dout after the clock edge
+        toggleClock(cont);
+        load_data_read_time++;
+        for (uint32_t k = 0; k < banks; ++k) {
+            uint32_t w = row * banks + k;
+            if (w >= baseWord && w < endWord) words.push_back(cont.dut->host_burst_dout[k]);
+        }
+    }
+    cont.dut->host_burst_req = 0;
+    return words;
+}
+
 void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile, 
                 int length, bool writeAsBytes = false, int num_pe = 32, int startLine = 0) {
     // Open the input file
@@ -199,43 +257,18 @@ void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile,
         inFile.close();
         i = 0;
         
-        // Pack bytes into 32-bit words and write them
-        std::cout << "Base Address: " << baseAddr << std::endl;
-        while (i < bytes.size()) {
-            uint32_t wordData = 0;
-            int bytesInWord = 0;
-            
-            // Pack up to 4 bytes into a single 32-bit word (little-endian)
-            for (int b = 0; b < 4 && (i + b) < bytes.size(); b++) {
-                wordData |= (static_cast<uint32_t>(bytes[i + b]) & 0xFF) << (8 * b);
-                bytesInWord++;
-            }
-            
-            // Write the packed word to memory
-            cont.dut->host_load_store_data_req = 1;
-            cont.dut->host_load_store_req = 1;
-            cont.dut->host_dmem_addr = (baseAddr + (i / 4)) * 4; // Align to word boundary
-            cont.dut->host_dmem_din = wordData;
-            
-            // Debug output with address in both hex and decimal
-            uint32_t addr = cont.dut->host_dmem_addr;
-            std::cout << "[debug:BYTE_WRITE] Address=0x" << std::hex << addr
-                      << " (" << std::dec << addr << ")"
-                      << " Data=0x" << std::hex << wordData << std::dec << " (";
-            for (int b = 0; b < bytesInWord; b++) {
-                std::cout << (b > 0 ? ", " : "") << static_cast<int>(bytes[i + b]);
-            }
-            std::cout << ")" << std::endl;
-            
-            // Toggle clock
-            toggleClock(cont);
-            load_data_time++;
-            i += bytesInWord;
+        // Pack bytes into 32-bit words (little-endian) and write them a row at a time
+        std::vector<uint32_t> words((bytes.size() + 3) / 4, 0);
+        for (size_t b = 0; b < bytes.size(); b++) {
+            words[b / 4] |= (static_cast<uint32_t>(bytes[b]) & 0xFF) << (8 * (b % 4));
         }
+        TCDM_burst_write(cont, baseAddr, words);
+        i = bytes.size();
     } else {
         // Original word-based write
         if (baseAddr < 524288/4 - 1) { // normal write to TCDM 
             std::cout << "Base Address: " << baseAddr << std::endl;
+            std::vector<uint32_t> words;
             while (i < length && std::getline(inFile, line)) {
                 // Skip empty lines or comment lines
                 if (line.empty() || (line.size() >= 2 && line.substr(0, 2) == "//")) {
@@ -251,23 +284,10 @@ void TCDM_write(SimCon &cont, uint32_t baseAddr, const std::string &dataFile,
                     break;
                 }
 
-                // Set the signals for memory write
-                cont.dut->host_load_store_data_req = 1;
-                cont.dut->host_load_store_req = 1;
-                cont.dut->host_dmem_addr = (baseAddr + i) * 4;
-                cont.dut->host_dmem_din = data;
-                
-                // Debug output with address in both hex and decimal
-                uint32_t addr = cont.dut->host_dmem_addr;
-                std::cout << "[debug:WORD_WRITE] Address=0x" << std::hex << addr
-                        << " (" << std::dec << addr << ")"
-                        << " Data=" << data << std::endl;
-                
-                // Toggle clock
-                toggleClock(cont);
-                load_data_time++;
+                words.push_back(data);
                 i++;
             }
+            TCDM_burst_write(cont, baseAddr, words);
         } else {
             // write to local mem
             while (i < length && std::getline(inFile, line)) {
@@ -350,31 +370,17 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
     std::vector<int32_t> results;
     results.reserve(readAsBytes ? length * 4 : length);  // Pre-allocate
 
-    // For each iteration, we read one 32-bit word from memory
+    // Read the words a row at a time, then log them one by one
+    std::vector<uint32_t> words = TCDM_burst_read(cont, baseAddr, length);
     for (int i = 0; i < length; ++i) {
-        uint32_t currentAddress = (baseAddr + i) * 4;
-
-        // Drive signals to request a 32-bit read at `currentAddress`.
-        cont.dut->host_load_store_data_req = 1;
-        cont.dut->host_load_store_req      = 0;  // 0 for load, 1 for store
-        cont.dut->host_dmem_addr          = currentAddress;
-        cont.dut->host_dmem_din           = 0;   // Not used for loads
-
-        // Toggle clock to latch address/req signals
-        toggleClock(cont);
-        load_data_read_time++;
-        // The DUT should place valid data on host_dmem_out
-        int32_t wordVal = static_cast<int32_t>(cont.dut->host_dmem_out);
-        if (cont.dut->host_load_store_grant_i == 0) {
-            std::cout << "host_load_store_grant_i: " << cont.dut->host_load_store_grant_i << std::endl;
-        }
+        int32_t wordVal = static_cast<int32_t>(words[i]);
 
         if (!readAsBytes) {
             // WORD MODE: push back the entire 32-bit word
             results.push_back(wordVal);
             outFile << wordVal << "\n";  // log the word
             // Debug print
-            uint32_t addr = cont.dut->host_dmem_addr;
+            uint32_t addr = (baseAddr + i) * 4;
             // std::cout << "[debug:WORD] Address=0x" << std::hex << addr
             //           << " (" << std::dec << addr << ")"
             //           << " Data=" << std::dec << wordVal
@@ -390,7 +396,7 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
 
                 // Log to file and output as signed value
                 outFile << byteVal << "\n";
-                uint32_t addr = cont.dut->host_dmem_addr;
+                uint32_t addr = (baseAddr + i) * 4;
                 // std::cout << "[debug:BYTE] Address=0x" << std::hex << addr
                 //           << " (" << std::dec << addr << ")"
                 //           << " ByteIndex=" << std::dec << b
@@ -404,9 +410,304 @@ std::vector<int32_t> TCDM_read(SimCon &cont, uint32_t baseAddr, const std::strin
     return results;
 }
 
+// One TCDM_write call of the data load.
+struct TCDMLoad {
+    uint32_t baseAddr;
+    std::string dataFile;
+    int length;
+    bool writeAsBytes;
+    int num_pe;
+    int startLine;
+
+    bool operator==(const TCDMLoad &other) const {
+        return baseAddr == other.baseAddr && dataFile == other.dataFile && length == other.length &&
+               writeAsBytes == other.writeAsBytes && num_pe == other.num_pe && startLine == other.startLine;
+    }
+};
+
+// The data each cluster needs for an operation. Returns false for an unknown
+// operation type.
+bool clusterLoads(const std::string &operationType, int i, std::vector<TCDMLoad> &loads) {
+    if (operationType == "conv") {
+        loads.push_back({700, "../../software/kernel/conv_int8/padded_input.txt", 36*36*3, true, 32, 0});
+        loads.push_back({21, "../../software/kernel/conv_int8/weights.txt", 5*5*3*32, true, 32, 0});
+    } else if (operationType == "gemm" || operationType == "gemmadd64x64" ) {
+        loads.push_back({200/4, "../../software/kernel/gemm/ncubed/input_A.data", 4096, false, 32, 0});
+        loads.push_back({20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false, 32, 0});
+    } else if (operationType == "madd_8x8") {
+        // each cluster adds its own 512 words of A and B
+        if (i < 8) {
+            loads.push_back({0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 512*i});
+            loads.push_back({16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 512*i});
+        }
+    } else if (operationType == "gemm_local" ) {
+        static const char *inputA[] = {"../../software/kernel/gemm/ncubed/input_A1.data", "../../software/kernel/gemm/ncubed/input_A2.data",
+                                       "../../software/kernel/gemm/ncubed/input_A3.data", "../../software/kernel/gemm/ncubed/input_A4.data"};
+        if (i < 4) {
+            loads.push_back({524288/4, inputA[i], 1024, false, 16, 0});
+            loads.push_back({20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false, 32, 0});
+        }
+    } else if (operationType == "2mm") {
+        loads.push_back({200  /4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_1.data", 4096, false, 32, 0});
+        loads.push_back({20000/4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_2.data", 4096, false, 32, 0});
+        loads.push_back({40000/4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_3.data", 4096, false, 32, 0});
+    } else if (operationType == "others") {
+        // do nothing 
+    } else if (operationType == "relu") {
+        loads.push_back({15000/4, "../../software/kernel/conv_int8/output.txt", RELU_SIZE, false, 32, 0});
+    } else if (operationType == "gemm32x32" || operationType == "gemmadd32x32") {
+        loads.push_back({200/4, "../../software/kernel/gemm_32x32/ncubed/input_A.data", 1024, false, 32, 0});
+        loads.push_back({20000/4, "../../software/kernel/gemm_32x32/ncubed/input_B.data", 1024, false, 32, 0});
+    } else if (operationType == "gemm128x128") {
+        loads.push_back({200/4, "../../software/kernel/gemm_128x128/ncubed/input_A.data", 16384, false, 32, 0});
+        loads.push_back({80000/4, "../../software/kernel/gemm_128x128/ncubed/input_B.data", 16384, false, 32, 0});
+    } else if (operationType == "resnet_conv1") {
+        loads.push_back({45000/4, "../../software/kernel/image_pad/padded_output.txt", 38*38*3, false, 32, 0}); // input 
+        loads.push_back({84/4,    "../../software/kernel/data/resnet18_prunned_weights50/conv1.weight_raw_fxp.txt", 64*3*49, false, 32, 0}); // filter
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Write the data of every cluster. A load that several clusters need is
+// written once, with all of their bits set in host_dmem_cluster_ena; the rest
+// goes to one cluster at a time. The loads of a cluster must not overlap, as
+// a multicast write may reorder them. load_data_unicast_time counts what the
+// same loads take with one cluster per write.
+bool loadClusterData(SimCon &cont, const std::string &operationType, int clusters) {
+    std::vector<std::vector<TCDMLoad>> loads(clusters);
+    for (int i = 0; i < clusters; ++i) {
+        if (!clusterLoads(operationType, i, loads[i])) return false;
+    }
+
+    auto needs = [&](int cluster, const TCDMLoad &load) {
+        return std::find(loads[cluster].begin(), loads[cluster].end(), load) != loads[cluster].end();
+    };
+    for (int i = 0; i < clusters; ++i) {
+        for (const TCDMLoad &load : loads[i]) {
+            bool written = false;
+            for (int j = 0; j < i && !written; ++j) written = needs(j, load);
+            if (written) continue;
+
+            uint32_t mask = 0;
+            int selected = 0;
+            for (int j = i; j < clusters; ++j) {
+                if (needs(j, load)) {
+                    mask |= 1u << j;
+                    selected++;
+                }
+            }
+            cont.dut->host_dmem_cluster_ena = mask;
+            vluint64_t before = load_data_time;
+            TCDM_write(cont, load.baseAddr, load.dataFile, load.length, load.writeAsBytes, load.num_pe, load.startLine);
+            load_data_unicast_time += (load_data_time - before) * selected;
+            toggleClock(cont);
+            cont.dut->host_dmem_cluster_ena = 0;
+            toggleClock(cont);
+        }
+    }
+    return true;
+}
+
+// Re-encode the LUI/ADDI pair loading a base register. The constant is split
+// like dfg_processor does, the ADDI immediate is sign-extended by the core.
+void encodeBaseLoad(uint32_t reg, int32_t value, uint32_t &lui, uint32_t &addi) {
+    uint32_t lower12 = value & 0xFFF;
+    uint32_t upper20 = ((value >> 12) + ((lower12 & 0x800) ? 1 : 0)) & 0xFFFFF;
+    lui  = (upper20 << 12) | (reg << 7) | 0x37;
+    addi = (lower12 << 20) | (reg << 15) | (reg << 7) | 0x13;
+}
+
+void writeInstruction(SimCon &cont, uint32_t address, uint32_t data, int &instructionCount) {
+    // Assign values to 'dut' and call 'toggleClock'
+    cont.dut->imem_addra = address;
+    cont.dut->imem_dina = data;
+    
+    instructionCount++;
+
+    // For debugging
+    std::cout << "Loading instruction " << instructionCount << " - Address: 0x" << std::hex << address 
+              << " (bit 10: " << ((address & 0x400) ? "1" : "0") 
+              << ", PE: " << ((address >> 10) & 0xF) << ")"
+              << " Data: 0x" << data << std::dec << std::endl;
+
+    toggleClock(cont);
+    load_inst_time++; 
+}
+
+// Read-only mapping of grid_image.kgi. The section, placement and lockstep
+// tables and the word pool are used in place, nothing is parsed or copied.
+class GridImageFile {
+public:
+    explicit GridImageFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(GridImageHeader)) {
+            size = st.st_size;
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const uint8_t*>(mapped);
+            }
+        }
+        close(fd);  // The mapping stays valid
+        if (data == nullptr) return;
+
+        const GridImageHeader& h = header();
+        uint64_t expected = sizeof(GridImageHeader) + (uint64_t)h.num_sections * sizeof(GridSection) + 
+                            (uint64_t)h.num_placements * sizeof(GridPlacement) + 
+                            (uint64_t)h.num_lockstep * sizeof(GridLockstep) + (uint64_t)h.num_words * 4;
+        if (h.magic != kGridImageMagic || h.version != kGridImageVersion || expected > size) {
+            munmap(const_cast<uint8_t*>(data), size);
+            data = nullptr;
+        }
+    }
+    ~GridImageFile() {
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+    }
+    GridImageFile(const GridImageFile&) = delete;
+    GridImageFile& operator=(const GridImageFile&) = delete;
+
+    bool valid() const { return data != nullptr; }
+    const GridImageHeader& header() const { return *reinterpret_cast<const GridImageHeader*>(data); }
+    const GridSection* sections() const { 
+        return reinterpret_cast<const GridSection*>(data + sizeof(GridImageHeader)); 
+    }
+    const GridPlacement* placements() const { 
+        return reinterpret_cast<const GridPlacement*>(sections() + header().num_sections); 
+    }
+    const GridLockstep* lockstep() const { 
+        return reinterpret_cast<const GridLockstep*>(placements() + header().num_placements); 
+    }
+    const uint32_t* words() const { 
+        return reinterpret_cast<const uint32_t*>(lockstep() + header().num_lockstep); 
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+bool isGridImage(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".kgi") == 0;
+}
+
+// A lockstep follower needs its leader in the same grid instance of `block`
+// PEs, the one fetching for it
+bool lockstepPaired(const GridLockstep& entry, uint32_t block) {
+    return entry.pe / block == entry.leader / block;
+}
+
+// Visit every (imem address, word) the image writes before the given overlay
+// segment runs, in the order of combined_memory.mem and overlay_memory.mem.
+// A lockstep follower whose leader sits in another grid instance of `block`
+// PEs gets a copy of the leader's execution sections.
+template <typename Visit>
+void forEachGridWord(const GridImageFile& image, uint32_t segment, uint32_t block, Visit visit) {
+    const GridImageHeader& header = image.header();
+    std::multimap<uint32_t, uint32_t> copies;  // leader -> unpaired follower
+    for (uint32_t l = 0; l < header.num_lockstep; l++) {
+        const GridLockstep& entry = image.lockstep()[l];
+        if (!lockstepPaired(entry, block)) {
+            copies.emplace(entry.leader, entry.pe);
+        }
+    }
+    for (uint32_t p = 0; p < header.num_placements; p++) {
+        const GridPlacement& placement = image.placements()[p];
+        if (placement.segment != segment) continue;
+        if (placement.section >= header.num_sections) {
+            std::cerr << "Grid image placement " << p << " uses unknown section " << placement.section << std::endl;
+            continue;
+        }
+        const GridSection& section = image.sections()[placement.section];
+        if ((uint64_t)section.first_word + section.num_words > header.num_words) {
+            std::cerr << "Grid image section " << placement.section << " exceeds the word pool" << std::endl;
+            continue;
+        }
+        const uint32_t* words = image.words() + section.first_word;
+        auto place = [&](uint32_t pe) {
+            for (uint32_t w = 0; w < section.num_words; w++) {
+                visit((((pe & 0xFF) << 10) | (placement.address + w)) & 0xFFFF, words[w]);
+            }
+        };
+        place(placement.pe);
+        if (placement.address != kPreloadBase) {
+            auto [first, last] = copies.equal_range(placement.pe);
+            for (auto it = first; it != last; ++it) {
+                place(it->second);
+            }
+        }
+    }
+}
+
+// PEs currently following a leader, cleared before the next program loads
+std::vector<uint32_t> lockstepFollowers;
+
+void writeLockstep(SimCon &cont, uint32_t pe, uint32_t leader) {
+    cont.dut->lockstep_we = 1;
+    cont.dut->lockstep_pe = pe;
+    cont.dut->lockstep_leader = leader;
+    toggleClock(cont);
+    cont.dut->lockstep_we = 0;
+    load_inst_time++;
+}
+
+// Program the lockstep table, followers of the previous program are dropped
+void loadLockstepTable(SimCon &cont, const GridLockstep* entries, uint32_t count, uint32_t block) {
+    for (uint32_t pe : lockstepFollowers) {
+        writeLockstep(cont, pe, pe);
+    }
+    lockstepFollowers.clear();
+    for (uint32_t l = 0; l < count; l++) {
+        if (lockstepPaired(entries[l], block)) {
+            writeLockstep(cont, entries[l].pe, entries[l].leader);
+            lockstepFollowers.push_back(entries[l].pe);
+        }
+    }
+    if (count > 0) {
+        std::cout << "Lockstep: " << lockstepFollowers.size() << " of " << count 
+                  << " followers fetch from their leader" << std::endl;
+    }
+}
+
+// Load the base image (overlay segment 0) of grid_image.kgi
+void loadGridImage(SimCon &cont, const std::string& inputFile) {
+    std::cout << ">> inputFile: " << inputFile << std::endl;
+    GridImageFile image(inputFile);
+    if (!image.valid()) {
+        std::cerr << "Error opening grid image: " << inputFile << std::endl;
+        return;
+    }
+
+    uint32_t block = cont.dut->dbg_nr * cont.dut->dbg_nc;
+    cont.dut->imem_wea = 0xF;
+    int instructionCount = 0;
+    forEachGridWord(image, 0, block, [&](uint32_t address, uint32_t data) {
+        writeInstruction(cont, address, data, instructionCount);
+    });
+    cont.dut->imem_wea = 0x0;
+    toggleClock(cont);
+    loadLockstepTable(cont, image.lockstep(), image.header().num_lockstep, block);
+
+    std::cout << "Instruction loading complete. Loaded " << instructionCount << " instructions." << std::endl;
+}
+
+// Loads combined_memory.mem or template_memory.mem, grid_image.kgi goes to
+// loadGridImage. A template image holds one program per template with the PE
+// field cleared, a "slots" line naming the base registers and one
+// "patch PE TEMPLATE CONSTANT..." line per PE. Slot i is the LUI/ADDI pair at
+// preload words 2i and 2i+1 of the template.
 void loadInstructions(SimCon &cont, const std::string& inputFile) {
-    std::ifstream inFile(inputFile);
+    if (isGridImage(inputFile)) {
+        loadGridImage(cont, inputFile);
+        return;
+    }
+    loadLockstepTable(cont, nullptr, 0, 1);
 
+    std::ifstream inFile(inputFile);
     if (!inFile.is_open()) {
         std::cerr << "Error opening input file: " << inputFile << std::endl;
         return;
@@ -417,6 +718,9 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
     
     std::string line;
     int instructionCount = 0;
+    std::vector<uint32_t> slots;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> templates;
+    int currentTemplate = -1;
     
     while (std::getline(inFile, line)) {
         // Skip empty lines
@@ -425,6 +729,51 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
         // Skip comment lines (starting with '//')
         if (line.substr(0, 2) == "//") continue;
 
+        std::istringstream directive(line);
+        std::string keyword;
+        directive >> keyword;
+        if (keyword == "slots") {
+            std::string reg;
+            while (directive >> reg) {
+                slots.push_back(std::stoul(reg.substr(1)));
+            }
+            continue;
+        }
+        if (keyword == "template") {
+            directive >> currentTemplate;
+            if ((int)templates.size() <= currentTemplate) {
+                templates.resize(currentTemplate + 1);
+            }
+            continue;
+        }
+        if (keyword == "patch") {
+            int pe, templateId;
+            directive >> pe >> templateId;
+            std::vector<int32_t> constants;
+            int32_t constant;
+            while (directive >> constant) {
+                constants.push_back(constant);
+            }
+            if (templateId < 0 || templateId >= (int)templates.size()) {
+                std::cerr << "Patch of PE " << pe << " uses unknown template " << templateId << std::endl;
+                continue;
+            }
+
+            // Expand the template at the PE address, base constants go into
+            // the slot words of the preload section
+            for (const auto& [offset, word] : templates[templateId]) {
+                uint32_t data = word;
+                uint32_t slot = (offset & ~0x200u) / 2;
+                if ((offset & 0x200) && slot < constants.size() && slot < slots.size()) {
+                    uint32_t lui, addi;
+                    encodeBaseLoad(slots[slot], constants[slot], lui, addi);
+                    data = (offset & 1) ? addi : lui;
+                }
+                writeInstruction(cont, (offset | (pe << 10)) & 0xFFFF, data, instructionCount);
+            }
+            continue;
+        }
+
         // The format is "@HHHHHHHH HHHHHHHH" where the first part is the address
         // and the second part is the instruction data
         if (line[0] != '@') {
@@ -443,20 +792,11 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
             // Convert hex data to integer
             uint32_t data = std::stoul(hexData, nullptr, 16);
 
-            // Assign values to 'dut' and call 'toggleClock'
-            cont.dut->imem_addra = address;
-            cont.dut->imem_dina = data;
-            
-            instructionCount++;
-
-            // For debugging
-            std::cout << "Loading instruction " << instructionCount << " - Address: 0x" << std::hex << address 
-                      << " (bit 10: " << ((address & 0x400) ? "1" : "0") 
-                      << ", PE: " << ((address >> 10) & 0xF) << ")"
-                      << " Data: 0x" << data << std::dec << std::endl;
-
-            toggleClock(cont);
-            load_inst_time++;
+            if (currentTemplate >= 0) {
+                templates[currentTemplate].push_back({address, data});
+            } else {
+                writeInstruction(cont, address, data, instructionCount);
+            }
         } else {
             std::cerr << "Failed to parse line: " << line << std::endl;
         }
@@ -469,6 +809,20 @@ void loadInstructions(SimCon &cont, const std::string& inputFile) {
     std::cout << "Instruction loading complete. Loaded " << instructionCount << " instructions." << std::endl;
 }
 
+// Prefer the binary grid image of an output folder, then the template image,
+// then the combined image
+std::string programImagePath(const std::string& outputFolder) {
+    std::string gridPath = outputFolder + "/grid_image.kgi";
+    if (std::ifstream(gridPath).good()) {
+        return gridPath;
+    }
+    std::string templatePath = outputFolder + "/template_memory.mem";
+    if (std::ifstream(templatePath).good()) {
+        return templatePath;
+    }
+    return outputFolder + "/combined_memory.mem";
+}
+
 void generateReport(const std::string& folderName, vluint64_t sim_time, vluint64_t measure_time, 
                     bool resultsMatch, int grid_div, int N_R, int N_C, int cluster_value, const uint32_t* dbg_mem_conflict,
                     vluint64_t load_inst_time, vluint64_t load_data_time, vluint64_t load_data_read_time, vluint64_t preload_time, int arb_policy, 
@@ -505,7 +859,11 @@ void generateReport(const std::string& folderName, vluint64_t sim_time, vluint64
     reportFile << "Total simulation time: " << (sim_time/2) * CLOCK_PERIOD_NS << " ns\n";
     reportFile << "Execution Cycle: " << measure_time << " cycles\n";
     reportFile << "Load instruction time: " << load_inst_time << " cycles\n";
+    if (!lockstepFollowers.empty()) {
+        reportFile << "Lockstep followers: " << lockstepFollowers.size() << " PEs fetch from a leader\n";
+    }
     reportFile << "Load data time: " << load_data_time << " cycles\n";
+    reportFile << "Load data time without multicast: " << load_data_unicast_time << " cycles\n";
     reportFile << "Load data read time: " << load_data_read_time << " cycles\n";
     reportFile << "Preload time: " << preload_time << " cycles\n\n";
     
@@ -587,10 +945,10 @@ int main(int argc, char **argv) {
         std::cout << "Suffix: " << suffix << std::endl;
     }
 
-    std::string memoryPath = "../../software/output/" + folderName + "/combined_memory.mem";
+    std::string memoryPath = programImagePath("../../software/output/" + folderName);
     if (operationType == "2mm") {
         std::cout << ">> 2mm_1 get memory path" << std::endl;
-        memoryPath_state2 = "../../software/output/" + base_name + "_2/combined_memory.mem";
+        memoryPath_state2 = programImagePath("../../software/output/" + base_name + "_2");
     }
     std::cout << ">> memoryPath_state2: " << memoryPath_state2 << std::endl;
 
@@ -628,11 +986,15 @@ int main(int argc, char **argv) {
     dut->imem_dina = 0;
     dut->imem_wea = 0;
     dut->imem_addra = 0;
+    dut->lockstep_we = 0;
     dut->mode_select = 0;
     dut->host_load_store_data_req = 0;
     dut->host_load_store_req = 0;
     dut->host_dmem_addr = 0;
     dut->host_dmem_din = 0;
+    dut->host_burst_req = 0;
+    dut->host_burst_we = 0;
+    dut->host_burst_lane_ena = 0;
     dut->grid_div = grid_div;   
     dut->tcdm_arb_policy = arb_policy;
     int N_R = dut->dbg_nr;
@@ -654,90 +1016,9 @@ int main(int argc, char **argv) {
         toggleClock(simcont);
     }
 
-    int cluster_ena_values[] = {1, 2, 4, 8, 16, 32, 64, 128};
-    for (int i = 0; i < cluster_value; ++i) {
-        dut->host_dmem_cluster_ena = cluster_ena_values[i];
-        if (operationType == "conv") {
-            TCDM_write(simcont, 700, "../../software/kernel/conv_int8/padded_input.txt", 36*36*3, true);
-            TCDM_write(simcont, 21, "../../software/kernel/conv_int8/weights.txt", 5*5*3*32, true);
-        } else if (operationType == "gemm" || operationType == "gemmadd64x64" ) {
-            TCDM_write(simcont, 200/4, "../../software/kernel/gemm/ncubed/input_A.data", 4096, false, 32, 0);
-            TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false, 32, 0);
-        } else if (operationType == "madd_8x8") {
-            if (i == 0) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 0);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 0);
-            } else if (i == 1) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 512);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 512);
-            } else if (i == 2) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 1024);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 1024);
-            } else if (i == 3) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 1536);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 1536);
-            } else if (i == 4) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 2048);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 2048);
-            } else if (i == 5) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 2560);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 2560);
-            } else if (i == 6) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 3072);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 3072);
-            } else if (i == 7) {
-                TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 3584);
-                TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 512, false, 32, 3584);
-            }
-            // TCDM_write(simcont, 0/4, "../../software/kernel/gemm/ncubed/input_A.data", 512, false, 32, 512);
-            // TCDM_write(simcont, 16384/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false);
-
-        } else if (operationType == "gemm_local" ) {
-            if (i == 0) {   
-                TCDM_write(simcont, 524288/4, "../../software/kernel/gemm/ncubed/input_A1.data", 1024, false, 16);
-                TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false);
-            } else if (i == 1) {
-                TCDM_write(simcont, 524288/4, "../../software/kernel/gemm/ncubed/input_A2.data", 1024, false, 16);
-                TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false);
-            } else if (i == 2) {
-                TCDM_write(simcont, 524288/4, "../../software/kernel/gemm/ncubed/input_A3.data", 1024, false, 16);
-                TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false);
-            } else if (i == 3) {
-                TCDM_write(simcont, 524288/4, "../../software/kernel/gemm/ncubed/input_A4.data", 1024, false, 16);
-                TCDM_write(simcont, 20000/4, "../../software/kernel/gemm/ncubed/input_B.data", 4096, false);
-            } 
-        } else if (operationType == "2mm") {
-            TCDM_write(simcont, 200  /4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_1.data", 4096, false);
-            TCDM_write(simcont, 20000/4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_2.data", 4096, false);
-            TCDM_write(simcont, 40000/4, "../../software/kernel/2mm/ncubed/input_fxp_matrix_3.data", 4096, false);
-        } else if (operationType == "others") {
-            // do nothing 
-            std::cout << ">> others perform" << std::endl;
-        } else if (operationType == "relu") {
-            TCDM_write(simcont, 15000/4, "../../software/kernel/conv_int8/output.txt", RELU_SIZE, false);
-        } else if (operationType == "gemm32x32" || operationType == "gemmadd32x32") {
-            TCDM_write(simcont, 200/4, "../../software/kernel/gemm_32x32/ncubed/input_A.data", 1024, false, 32, 0);
-            TCDM_write(simcont, 20000/4, "../../software/kernel/gemm_32x32/ncubed/input_B.data", 1024, false, 32, 0);
-            // TCDM_write(simcont, 15000/4, "../../software/kernel/gemm_128x128/ncubed/input_B.data", 16384, false); 
-            // TCDM_write(simcont, 31384/4, "../../software/kernel/gemm_128x128/ncubed/input_B.data", 16384, false); 
-        } else if (operationType == "gemm128x128") {
-            printf(">> gemm128x128 perform\n");
-            // if (i==0) {
-            //     TCDM_write(simcont, 200/4,   "../../software/kernel/gemm_128x128/ncubed/input_A.data", 16384/8, false, 32, 0);
-            //     TCDM_write(simcont, 80000/4, "../../software/kernel/gemm_128x128/ncubed/input_B.data", 16384, false, 32, 0); 
-            // }
-            TCDM_write(simcont, 200/4, "../../software/kernel/gemm_128x128/ncubed/input_A.data", 16384, false, 32, 0);
-            TCDM_write(simcont, 80000/4, "../../software/kernel/gemm_128x128/ncubed/input_B.data", 16384, false, 32, 0); 
-        } else if (operationType == "resnet_conv1") {
-            TCDM_write(simcont, 45000/4, "../../software/kernel/image_pad/padded_output.txt", 38*38*3, false); // input 
-            TCDM_write(simcont, 84/4,    "../../software/kernel/data/resnet18_prunned_weights50/conv1.weight_raw_fxp.txt", 64*3*49, false); // filter
-        } else {
-            std::cerr << "Error: Invalid operation type. Must be either 'conv' or 'gemm'" << std::endl;
-            return 1;
-        }
-        toggleClock(simcont);
-        dut->host_dmem_cluster_ena = 0;
-        toggleClock(simcont);
+    if (!loadClusterData(simcont, operationType, cluster_value)) {
+        std::cerr << "Error: Invalid operation type. Must be either 'conv' or 'gemm'" << std::endl;
+        return 1;
     }
     dut->host_dmem_cluster_ena = 0;
 
@@ -0,0 +1,82 @@
+// Assembler throughput benchmark: assembles the programs of a file list in
+// memory a number of times and reports instructions per second. The console
+// listing and file output are left out, so the number reflects parsing and
+// encoding only. The list can be stretched to more PEs by reusing its
+// programs, and the PEs are spread over a thread pool like in the assembler.
+#include "risc_v_assembler.h"
+#include "thread_pool.h"
+#include <chrono>
+
+// Discards the per-program console output of the assembler
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file_list> [iterations] [num_threads] [num_programs]" << std::endl;
+        std::cerr << "  file_list: File containing a list of assembly files, one per line" << std::endl;
+        std::cerr << "  iterations: Number of times every program is assembled (default: 100)" << std::endl;
+        std::cerr << "  num_threads: Workers assembling the programs (default: hardware threads)" << std::endl;
+        std::cerr << "  num_programs: PE programs per iteration, the list is reused (default: list size)" << std::endl;
+        return 1;
+    }
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 100;
+    unsigned num_threads = (argc >= 4) ? std::stoul(argv[3]) : defaultThreadCount();
+
+    std::ifstream file_list(argv[1]);
+    if (!file_list) {
+        std::cerr << "Error: Cannot open file list: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<std::string> sources;
+    std::string assembly_file;
+    while (std::getline(file_list, assembly_file)) {
+        if (assembly_file.empty() || assembly_file[0] == '#') continue;
+        std::ifstream file(assembly_file);
+        if (!file) {
+            std::cerr << "Error: Cannot open input file: " << assembly_file << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        sources.push_back(buffer.str());
+    }
+    if (sources.empty()) {
+        std::cerr << "Error: No assembly files in " << argv[1] << std::endl;
+        return 1;
+    }
+    size_t num_programs = (argc >= 5) ? std::stoul(argv[4]) : sources.size();
+
+    NullBuffer null_buffer;
+    std::ostream null_log(&null_buffer);
+    RISC_V_Assembler assembler;
+    assembler.listing = false;
+    std::vector<size_t> counts(num_programs, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        parallelFor(num_programs, num_threads, [&](size_t pe) {
+            std::istringstream source(sources[pe % sources.size()]);
+            std::vector<std::string> memory_entries;
+            std::map<int, std::vector<std::string>> overlay_entries;
+            assembler.assembleSource(source, pe, nullptr, nullptr, &memory_entries, &overlay_entries, nullptr, null_log);
+            counts[pe] += memory_entries.size();
+            for (const auto& [segment, entries] : overlay_entries) {
+                counts[pe] += entries.size();
+            }
+        });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t instructions = 0;
+    for (size_t count : counts) {
+        instructions += count;
+    }
+
+    std::cout << "Programs:     " << num_programs << " x " << iterations << " iterations on " 
+              << num_threads << " threads" << std::endl;
+    std::cout << "Instructions: " << instructions << std::endl;
+    std::cout << "Time:         " << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms" << std::endl;
+    std::cout << "Throughput:   " << std::setprecision(0) << instructions / seconds << " instructions/s" << std::endl;
+    return 0;
+}
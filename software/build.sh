@@ -23,6 +23,8 @@ YAML_FILE=${1:-"dfg_config.yaml"}
 OUTPUT_DIR=${2:-"build"}
 FILELIST="${OUTPUT_DIR}/assembly_files.txt"
 COMBINED_MEM="${OUTPUT_DIR}/combined_memory.mem"
+OVERLAY_MEM="${OUTPUT_DIR}/overlay_memory.mem"
+GRID_IMAGE="${OUTPUT_DIR}/grid_image.kgi"
 VISUALIZATION="${OUTPUT_DIR}/dfg_visualization.png"
 
 # Source files
@@ -58,17 +60,17 @@ info "- Output Directory: $OUTPUT_DIR"
 check_python_dependencies
 
 # Step 1: Compile the tools if needed
-if [ ! -f "$DFG_PROCESSOR_BIN" ] || [ "$DFG_PROCESSOR_SOURCE" -nt "$DFG_PROCESSOR_BIN" ]; then
+if [ ! -f "$DFG_PROCESSOR_BIN" ] || [ "$DFG_PROCESSOR_SOURCE" -nt "$DFG_PROCESSOR_BIN" ] || [ "dfg_processor.h" -nt "$DFG_PROCESSOR_BIN" ]; then
     info "Compiling DFG Processor..."
-    g++ -O3 -o "$DFG_PROCESSOR_BIN" "$DFG_PROCESSOR_SOURCE" -lyaml-cpp || error "Failed to compile DFG Processor"
+    g++ -O3 -pthread -o "$DFG_PROCESSOR_BIN" "$DFG_PROCESSOR_SOURCE" -lyaml-cpp || error "Failed to compile DFG Processor"
     success "DFG Processor compiled successfully"
 else
     info "DFG Processor is up to date"
 fi
 
-if [ ! -f "$ASSEMBLER_BIN" ] || [ "$ASSEMBLER_SOURCE" -nt "$ASSEMBLER_BIN" ]; then
+if [ ! -f "$ASSEMBLER_BIN" ] || [ "$ASSEMBLER_SOURCE" -nt "$ASSEMBLER_BIN" ] || [ "risc_v_assembler.h" -nt "$ASSEMBLER_BIN" ] || [ "kira_object.h" -nt "$ASSEMBLER_BIN" ]; then
     info "Compiling RISC-V Assembler..."
-    g++ -O3 -o "$ASSEMBLER_BIN" "$ASSEMBLER_SOURCE" || error "Failed to compile RISC-V Assembler"
+    g++ -O3 -pthread -o "$ASSEMBLER_BIN" "$ASSEMBLER_SOURCE" || error "Failed to compile RISC-V Assembler"
     success "RISC-V Assembler compiled successfully"
 else
     info "RISC-V Assembler is up to date"
@@ -105,6 +107,13 @@ if [ -f "$COMBINED_MEM" ]; then
 else
     warn "Combined memory file not found: $COMBINED_MEM"
 fi
+if [ -f "$OVERLAY_MEM" ]; then
+    OVERLAY_SEGMENTS=$(grep "^// Total Segments:" "$OVERLAY_MEM" | awk '{print $4}')
+    info "Program split into $OVERLAY_SEGMENTS imem overlay segments: $OVERLAY_MEM"
+fi
+if [ -f "$GRID_IMAGE" ]; then
+    info "Binary grid image: $GRID_IMAGE"
+fi
 
 # Summary
 echo 
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Regression check for outlined loop body code.
+
+Compiles dfg_yaml/dfg_outlined.yaml, a gemm whose inner body is too long for
+a hardware loop, and runs the execution section of every PE on a behavioural
+model of the generated assembly. A PE has to stop at an all-zero word
+(`halt`, or the end of its program), and every element of C has to be stored
+exactly once: the config sets hoist_invariants, so the C store runs behind
+the inner loop, and code that runs past the end of the program into the
+outlined routines would return into the loop tail and store C again.
+
+Usage: python3 check_outlined.py [kira_compile]
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+MAX_STEPS = 1_000_000   # the gemm takes under 40000 per PE
+
+
+def parse_program(path):
+    """Instructions and label positions of one pe<N>_assembly.s."""
+    program, labels = [], {}
+    with open(path) as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if not line or line.startswith('.'):
+                continue
+            if line.endswith(':'):
+                labels[line[:-1]] = len(program)
+                continue
+            op, _, rest = line.partition(' ')
+            args = [a.strip() for a in rest.split(',')] if rest else []
+            program.append((op, args))
+    return program, labels
+
+
+def run_pe(path):
+    """Run one PE until it stops. Returns the store count per address."""
+    program, labels = parse_program(path)
+    x = [0] * 32
+    tag, coef, offs = [0] * 32, [0] * 32, [0] * 16
+    index = {}       # hwl tag -> current iteration
+    loops = []       # [start, end, tag, iterations, iteration]
+    stores = {}
+    pc, steps = 0, 0
+
+    def reg(name):
+        return int(name[1:])
+
+    def psrf_address(imm, base, with_offset):
+        var = imm & 63
+        address = x[base]
+        for k in range(var * 6, var * 6 + 6):
+            if tag[k]:
+                address += coef[k] * index.get(tag[k], 0)
+        return address + (offs[(imm >> 6) & 15] if with_offset else 0)
+
+    while pc < len(program):
+        op, a = program[pc]
+        steps += 1
+        if steps > MAX_STEPS:
+            raise RuntimeError(f"no all-zero word reached after {MAX_STEPS} instructions")
+        next_pc = pc + 1
+        if op == 'halt':
+            break
+        elif op in ('ret', 'nop', 'delay', 'mul', 'mac', 'mac.fxp', 'dot4'):
+            pass     # data values don't matter here, only the control flow and stores
+        elif op == 'add' or op == 'sub':
+            x[reg(a[0])] = x[reg(a[1])] + (x[reg(a[2])] if op == 'add' else -x[reg(a[2])])
+        elif op == 'addi':
+            x[reg(a[0])] = x[reg(a[1])] + int(a[2])
+        elif op == 'lui':
+            x[reg(a[0])] = int(a[1]) << 12
+        elif op == 'jal':
+            x[reg(a[0])] = pc + 1
+            next_pc = labels[a[1]]
+        elif op == 'jalr':
+            next_pc = x[reg(a[1])] + (int(a[2]) if len(a) > 2 else 0)
+        elif op == 'ppsrf.addi':
+            tag[reg(a[0])] |= int(a[2])
+        elif op == 'corf.addi':
+            coef[reg(a[0])] |= int(a[2])
+        elif op == 'corf.lui':
+            coef[reg(a[0])] = int(a[1]) << 12
+        elif op == 'offs.addi':
+            offs[reg(a[0])] |= int(a[2])
+        elif op == 'hwlrf':
+            _, start, end, hwl_tag, iterations = a
+            index[int(hwl_tag)] = 0
+            loops.append([labels[start], labels[end], int(hwl_tag), int(iterations), 0])
+        elif op in ('psrf.lw', 'psrf.ld2', 'psrf.sw'):
+            m = re.match(r'(-?\d+)\(x(\d+)\)', a[1])
+            address = psrf_address(int(m.group(1)), int(m.group(2)), op != 'psrf.sw')
+            if op == 'psrf.sw':
+                stores[address] = stores.get(address, 0) + 1
+        else:
+            raise RuntimeError(f"instruction {op} is not modelled")
+        x[0] = 0
+
+        # The end label names the last instruction of a loop body
+        while loops and loops[-1][1] == pc:
+            loop = loops[-1]
+            if loop[4] < loop[3] - 1:
+                loop[4] += 1
+                index[loop[2]] = loop[4]
+                next_pc = loop[0]
+                break
+            loops.pop()
+        pc = next_pc
+    return stores
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    compiler = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, 'kira_compile')
+    if not os.path.exists(compiler):
+        subprocess.run(['g++', '-O3', '-pthread', '-o', compiler, os.path.join(here, 'kira_compile.cpp'),
+                        '-lyaml-cpp'], check=True)
+
+    with tempfile.TemporaryDirectory() as out:
+        subprocess.run([compiler, os.path.join(here, 'dfg_yaml', 'dfg_outlined.yaml'), out, '--emit-asm'],
+                       check=True, stdout=subprocess.DEVNULL)
+        programs = sorted(f for f in os.listdir(out) if re.fullmatch(r'pe\d+_assembly\.s', f))
+        failed = 0
+        for name in programs:
+            with open(os.path.join(out, name)) as f:
+                if 'jal x26, outline' not in f.read():
+                    print(f"{name}: FAIL, no outlined code to check")
+                    failed += 1
+                    continue
+            try:
+                stores = run_pe(os.path.join(out, name))
+            except RuntimeError as e:
+                print(f"{name}: FAIL, {e}")
+                failed += 1
+                continue
+            again = sorted(a for a, count in stores.items() if count > 1)
+            if again:
+                print(f"{name}: FAIL, {len(again)} C words stored more than once, first at {again[0]}")
+                failed += 1
+            else:
+                print(f"{name}: ok, halts after storing {len(stores)} C words once")
+    if not programs:
+        print("FAIL: no programs generated")
+        return 1
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
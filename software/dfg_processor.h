@@ -0,0 +1,3393 @@
+#ifndef DFG_PROCESSOR_H
+#define DFG_PROCESSOR_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <yaml-cpp/yaml.h>
+#include <optional>
+#include <cmath>
+#include <bitset>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+#include "thread_pool.h"
+
+struct HardwareLoop {
+    int loop_id;
+    int pc_start;
+    int pc_stop;
+    int hwl_index;
+    int iterations;
+};
+
+struct Instruction {
+    std::string operation;
+    std::string ra1;
+    std::string ra2;
+    std::string rd;      // Add destination register field
+    std::string base_address;  // Changed to string for register-based addressing
+    std::string format;
+    std::map<std::string, int> coefficients;  // Now using c0-c5
+    std::optional<int> var;                   // Used for register offset calculation
+    std::map<std::string, int> psrf_var;      // Now using v0-v5 with integer values
+    std::optional<HardwareLoop> hwl;  // New field for hardware loop info
+    int imm = 0;              // Immediate value for I-type instructions
+    std::string target;       // Added for JAL target
+    int address = 0;          // Added for JAL target address
+    int offset = 0;           // Added for memory offset
+    std::string label;        // JAL to outlined loop body code, by assembler label
+};
+
+// ---------------------------------------------------------------------------
+// Typed IR. Every YAML instruction is lowered once in loadConfig into an IROp;
+// code generation and later passes work on the IR and only go back to the
+// Instruction record (through IROp::src) for HWL fields, PSRF coefficients and
+// call targets.
+// ---------------------------------------------------------------------------
+enum class Opcode : uint8_t {
+    HWL,
+    LW, LH, LB, LBU, LHU, SW, SH, SB,
+    PSRF_LW, PSRF_LB, PSRF_ZD_LW, PSRF_LD2, PSRF_SW, PSRF_SB,
+    ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI, JALR,
+    ADD, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND, MUL, MAC, MAC_FXP, DOT4,
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    LUI, AUIPC, JAL,
+    RET, NOP,
+    UNKNOWN
+};
+
+enum class OpClass : uint8_t {
+    Hwl,      // hwlrf.lui + hwlrf.addi pair
+    PsrfMem,  // psrf.lw rd, var(base)
+    Mem,      // lw rd, offset(base)
+    IType,    // addi rd, rs1, imm
+    RType,    // add rd, rs1, rs2
+    BType,    // beq rs1, rs2, imm
+    UType,    // lui rd, imm
+    JType,    // jal rd, imm
+    Special,  // ret / nop
+    Unknown
+};
+
+// Operand usage flags
+enum : uint8_t {
+    OP_WRITES_RD = 1 << 0,
+    OP_READS_RS1 = 1 << 1,
+    OP_READS_RS2 = 1 << 2,
+    OP_LOAD      = 1 << 3,
+    OP_STORE     = 1 << 4,
+    OP_READS_RD  = 1 << 5,  // mac/mac.fxp/dot4 accumulate into rd
+};
+
+struct OpcodeInfo {
+    Opcode op;
+    const char* mnemonic;
+    OpClass cls;
+    uint8_t flags;
+};
+
+static constexpr OpcodeInfo kOpcodeTable[] = {
+    {Opcode::HWL,        "hwl",        OpClass::Hwl,     0},
+    {Opcode::LW,         "lw",         OpClass::Mem,     OP_WRITES_RD | OP_LOAD},
+    {Opcode::LH,         "lh",         OpClass::Mem,     OP_WRITES_RD | OP_LOAD},
+    {Opcode::LB,         "lb",         OpClass::Mem,     OP_WRITES_RD | OP_LOAD},
+    {Opcode::LBU,        "lbu",        OpClass::Mem,     OP_WRITES_RD | OP_LOAD},
+    {Opcode::LHU,        "lhu",        OpClass::Mem,     OP_WRITES_RD | OP_LOAD},
+    {Opcode::SW,         "sw",         OpClass::Mem,     OP_READS_RS2 | OP_STORE},
+    {Opcode::SH,         "sh",         OpClass::Mem,     OP_READS_RS2 | OP_STORE},
+    {Opcode::SB,         "sb",         OpClass::Mem,     OP_READS_RS2 | OP_STORE},
+    {Opcode::PSRF_LW,    "psrf.lw",    OpClass::PsrfMem, OP_WRITES_RD | OP_LOAD},
+    {Opcode::PSRF_LB,    "psrf.lb",    OpClass::PsrfMem, OP_WRITES_RD | OP_LOAD},
+    {Opcode::PSRF_ZD_LW, "psrf.zd.lw", OpClass::PsrfMem, OP_WRITES_RD | OP_LOAD},
+    {Opcode::PSRF_LD2,   "psrf.ld2",   OpClass::PsrfMem, OP_WRITES_RD | OP_LOAD},  // Also writes rd + 1
+    {Opcode::PSRF_SW,    "psrf.sw",    OpClass::PsrfMem, OP_READS_RS2 | OP_STORE},
+    {Opcode::PSRF_SB,    "psrf.sb",    OpClass::PsrfMem, OP_READS_RS2 | OP_STORE},
+    {Opcode::ADDI,       "addi",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::SLTI,       "slti",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::SLTIU,      "sltiu",      OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::XORI,       "xori",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::ORI,        "ori",        OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::ANDI,       "andi",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::SLLI,       "slli",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::SRLI,       "srli",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::SRAI,       "srai",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::JALR,       "jalr",       OpClass::IType,   OP_WRITES_RD | OP_READS_RS1},
+    {Opcode::ADD,        "add",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SUB,        "sub",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SLL,        "sll",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SLT,        "slt",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SLTU,       "sltu",       OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::XOR,        "xor",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SRL,        "srl",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::SRA,        "sra",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::OR,         "or",         OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::AND,        "and",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::MUL,        "mul",        OpClass::RType,   OP_WRITES_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::MAC,        "mac",        OpClass::RType,   OP_WRITES_RD | OP_READS_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::MAC_FXP,    "mac.fxp",    OpClass::RType,   OP_WRITES_RD | OP_READS_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::DOT4,       "dot4",       OpClass::RType,   OP_WRITES_RD | OP_READS_RD | OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BEQ,        "beq",        OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BNE,        "bne",        OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BLT,        "blt",        OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BGE,        "bge",        OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BLTU,       "bltu",       OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::BGEU,       "bgeu",       OpClass::BType,   OP_READS_RS1 | OP_READS_RS2},
+    {Opcode::LUI,        "lui",        OpClass::UType,   OP_WRITES_RD},
+    {Opcode::AUIPC,      "auipc",      OpClass::UType,   OP_WRITES_RD},
+    {Opcode::JAL,        "jal",        OpClass::JType,   OP_WRITES_RD},
+    {Opcode::RET,        "ret",        OpClass::Special, 0},
+    {Opcode::NOP,        "nop",        OpClass::Special, 0},
+    {Opcode::UNKNOWN,    "unknown",    OpClass::Unknown, 0},
+};
+
+constexpr const OpcodeInfo& opInfo(Opcode op) {
+    return kOpcodeTable[static_cast<size_t>(op)];
+}
+
+constexpr bool checkOpcodeTable() {
+    for (size_t i = 0; i < sizeof(kOpcodeTable) / sizeof(kOpcodeTable[0]); i++) {
+        if (static_cast<size_t>(kOpcodeTable[i].op) != i) return false;
+    }
+    return true;
+}
+static_assert(checkOpcodeTable(), "kOpcodeTable must be ordered like Opcode");
+
+constexpr int8_t NO_REG = -1;
+
+// Virtual registers vr0..vr95 of the YAML sit behind the 32 physical ones in
+// the IR register fields until allocateRegisters replaces them
+constexpr int8_t kFirstVirtualReg = 32;
+constexpr int kMaxVirtualRegs = 128 - kFirstVirtualReg;
+
+// Field limits of the hwlrf immediate
+constexpr int kMaxHwlIterations = 0xFFF;  // 12-bit count
+constexpr int kMaxHwlLength = 0x3F;       // 6-bit pc_stop - pc_start
+constexpr int kMaxHwlLevel = 7;           // L1..L7
+constexpr int kMaxHwlTag = 0x1F;          // 5-bit hwl_index
+
+// Cycles one delay instruction stalls for, 12-bit unsigned immediate
+constexpr int kMaxDelayCycles = 0xFFF;
+
+// Packed operands of one lowered instruction
+struct IROp {
+    Opcode op = Opcode::UNKNOWN;
+    int8_t rd = NO_REG;
+    int8_t rs1 = NO_REG;
+    int8_t rs2 = NO_REG;
+    int8_t base = NO_REG;    // Base register of (psrf) memory accesses
+    int8_t var = NO_REG;     // PSRF var group
+    int8_t offs = 0;         // AGU offset register added to psrf loads
+    uint16_t src = 0;        // Index of the originating Instruction
+    int32_t imm = 0;         // Immediate, memory offset or call address
+};
+
+// Double-buffered tiling: the kernel runs once per tile while the host streams
+// the next tile into the other buffer. Registers in double_buffer toggle between
+// the ping (base) and pong (base + buffer_stride) buffers at every swap point,
+// registers in tile_advance move forward by a fixed byte stride per tile.
+struct TilingConfig {
+    bool enabled = false;
+    int num_tiles = 1;
+    int buffer_stride = 0;      // Byte distance between ping and pong buffer
+    int tile_words = 0;         // Words streamed per buffer and tile
+    std::string swap_register = "x27";     // Holds +/- buffer_stride
+    std::string advance_register = "x28";  // Scratch for large tile advances
+    std::vector<std::string> double_buffer;
+    std::map<std::string, int> tile_advance;
+};
+
+// One instruction-memory overlay: IR range [first, last) of the execution
+// section, starting at execution pc pc_base of the unsplit program
+struct OverlaySegment {
+    size_t first;
+    size_t last;
+    int pc_base;
+};
+
+// Labels naming the HWL bodies of one overlay segment
+struct LoopLabels {
+    std::map<size_t, std::vector<std::string>> before;            // IR index -> labels placed before it
+    std::map<size_t, std::pair<std::string, std::string>> loops;  // HWL IR index -> start/end label
+};
+
+// PSRF accesses of one PE whose addresses move alike, i.e. that only differ
+// in their base register. Each stream takes one var group or, if none is
+// left, is lowered to plain loads/stores with a software base pointer.
+struct AddressStream {
+    std::map<int, int> terms;      // hwl_index -> coefficient
+    std::vector<size_t> accesses;  // IR indices
+    double software_cost = 0;      // Base pointer updates executed without a var group
+    std::string needs_group;       // Why software addressing can't follow it, empty if it can
+    int var = NO_REG;
+};
+
+// Preload instructions of one or more programs, as generated without and
+// with the preload optimization
+struct PreloadStats {
+    size_t before = 0;
+    size_t after = 0;
+
+    PreloadStats& operator+=(const PreloadStats& other) {
+        before += other.before;
+        after += other.after;
+        return *this;
+    }
+};
+
+struct PEAssignment {
+    int pe_id;
+    std::vector<Instruction> instructions;
+    bool has_psrf_mem_type;  // Flag to indicate if PE needs preload section
+    bool has_mem_type;      // Flag to indicate if PE needs preload section
+    std::set<std::string> required_base_registers;  // Track which base registers are needed
+    bool has_hwl;  // New flag for hardware loop
+    std::vector<IROp> ir;  // Typed IR, one entry per instruction
+    std::vector<std::pair<std::string, std::vector<IROp>>> outlined;  // Label, code moved out of long loop bodies
+    std::map<int, int> psrf_offsets;  // AGU offset register -> bytes added to psrf loads
+    std::vector<std::pair<int8_t, int8_t>> register_pairs;  // Virtual registers meant for one psrf.ld2
+};
+
+class DFGProcessor {
+private:
+    std::vector<PEAssignment> pe_assignments;
+    std::map<std::string, int> mem_config;  // Memory configuration
+    std::map<std::string, int> mem_offsets; // Memory offsets for each register
+    std::map<std::string, int> function_addresses;  // Store function addresses
+    std::map<std::string, std::map<int, PEAssignment>> function_pe_assignments;  // Store function PE assignments
+    int total_pes;
+    int clusters_count;
+    int pes_per_cluster;
+    int minimum_pes_required;
+    int data_dup;
+    std::map<int, int> hwl_imm_values;  // Map to store hardware loop immediate values
+    std::string output_folder;
+    std::vector<int> delay_start;  // Array to store delay values for each PE
+    TilingConfig tiling;           // Double-buffered tiled execution
+    int imem_exec_words = 512;     // Execution words per PE imem region (bits [8:0])
+    bool optimize_preload = true;  // Drop redundant preload writes, load bases relative to each other
+    int load_latency = 2;          // Cycles from a load until its result can be used
+    std::string spill_register;    // mem_config register addressing the spill slots
+    int unroll_factor = 0;         // Innermost loop unrolling, 0 picks a factor, 1 is off
+    bool fuse_mac = true;          // Fuse mul/add pairs of innermost loops into mac.fxp
+    bool hoist_invariants = false; // Move loop-invariant accesses out of innermost loops
+    std::set<int8_t> packed_int8;  // Base registers of int8 arrays stored four values to a word
+    std::set<int8_t> paired_loads; // Base registers of 8-byte aligned arrays read with psrf.ld2
+    int spill_words = 0;           // Spill slots handed out to all programs so far
+
+    // Helper function to get cluster number from PE ID
+    int getClusterNumber(int pe_id) {
+        return pe_id / pes_per_cluster;
+    }
+
+    // Helper function to calculate base address for a specific cluster
+    int calculateClusterBaseAddress(const std::string& reg, int cluster_num, int data_dup, int pe_id) {
+        auto base_it = mem_config.find(reg);
+        int base_addr = base_it != mem_config.end() ? base_it->second : 0;
+        std::string offset_key = reg + "_offset";
+        
+        if (mem_offsets.count(offset_key) > 0 && mem_offsets.at(offset_key) != 0) {
+            if (data_dup == 2) {
+                if (pe_id > 15) {
+                    return base_addr + (mem_offsets.at(offset_key) * (cluster_num)) +  100000;
+                } else {
+                    return base_addr + (mem_offsets.at(offset_key) * cluster_num);
+                }
+            } else if (data_dup == 4) {
+                if (pe_id > 15 && pe_id < 31) {
+                    return base_addr + (mem_offsets.at(offset_key) * (cluster_num)) +  100000;
+                } else if (pe_id > 31 && pe_id < 47) {
+                    return base_addr + (mem_offsets.at(offset_key) * (cluster_num)) +  200000;
+                } else if (pe_id > 47 && pe_id < 63) {
+                    return base_addr + (mem_offsets.at(offset_key) * (cluster_num)) +  300000;
+                } else {
+                    return base_addr + (mem_offsets.at(offset_key) * cluster_num);
+                }
+            } else {
+                return base_addr + (mem_offsets.at(offset_key) * cluster_num);
+            }
+        }
+        return base_addr;   
+    }
+
+    // Helper function to generate LUI and ADDI for large immediates
+    std::pair<int, int> calculateLuiAddiValues(int value) {
+        // RISC-V ADDI range is -2048 to 2047 (12-bit signed immediate)
+        // RISC-V LUI loads the immediate value into the upper 20 bits (bits 31:12)
+        
+        // If the value fits within ADDI range, use 0 for LUI and the value for ADDI
+        if (value >= -2048 && value <= 2047) {
+            return {0, value};
+        }
+        
+        // Extract lower 12 bits preserving the sign
+        int lower12 = value & 0xFFF;
+        
+        // If the lower 12 bits represent a negative value (bit 11 is set)
+        // we need to adjust the upper bits
+        int upper20;
+        if (lower12 & 0x800) {
+            // Sign extension is happening, need to add 1 to upper bits
+            // and keep the lower bits as they are
+            upper20 = ((value >> 12) & 0xFFFFF) + 1;
+        } else {
+            // No sign extension, just use the upper 20 bits as is
+            upper20 = (value >> 12) & 0xFFFFF;
+        }
+        
+        return {upper20, lower12};
+    }
+
+    // Base registers loaded by every PE, in mem_config order
+    std::vector<std::string> baseRegisters() const {
+        std::vector<std::string> regs;
+        for (const auto& [reg, base_value] : mem_config) {
+            if (base_value >= 0) {
+                regs.push_back(reg);
+            }
+        }
+        return regs;
+    }
+
+    // With fixed_shape every base register takes exactly one LUI and one ADDI,
+    // so programs that only differ in their base constants assemble to the same
+    // layout and can share a template. Otherwise, with optimize_preload, a
+    // value that would take a LUI/ADDI pair is built with one ADDI from a
+    // register loaded before it when the two are less than 2 KiB apart.
+    std::string generateBaseAddressLoading(int pe_id, int data_dup, bool fixed_shape = false,
+                                           PreloadStats* stats = nullptr) {
+        std::string result = "    # Base address loading section for cluster " + 
+                            std::to_string(getClusterNumber(pe_id)) + "\n";
+        
+        int cluster_num = getClusterNumber(pe_id);
+        // Template slots are patched per PE, so no value may depend on another
+        bool relative = optimize_preload && !fixed_shape;
+        std::vector<std::pair<std::string, int>> loaded;  // Registers holding a known value
+        PreloadStats counts;
+
+        // Emit the loads of one register, returns the assembly lines
+        auto load = [&](const std::string& reg, int value, bool fixed, bool explain) {
+            auto [lui_val, addi_val] = calculateLuiAddiValues(value);
+            
+            // Convert addi_val to signed 12-bit value if it exceeds range
+            if (addi_val & 0x800) {
+                // Sign extend to print as negative number
+                addi_val = addi_val | 0xFFFFF000;
+            }
+            
+            int pair_size = (lui_val != 0 || fixed) ? 2 : (addi_val != 0 ? 1 : 0);
+            counts.before += pair_size;
+            std::string code;
+            if (pair_size == 2 && relative) {
+                for (const auto& [source, source_value] : loaded) {
+                    int delta = value - source_value;
+                    if (delta >= -2048 && delta <= 2047) {
+                        code += "    # Using addi " + std::to_string(delta) + " from " + source + 
+                                " (" + std::to_string(source_value) + ")\n";
+                        code += "    addi " + reg + ", " + source + ", " + std::to_string(delta) + "\n";
+                        counts.after += 1;
+                        loaded.push_back({reg, value});
+                        return code;
+                    }
+                }
+            }
+
+            // Add explanation of the LUI+ADDI sequence for large values
+            if (lui_val != 0 && explain) {
+                code += "    # Using lui " + std::to_string(lui_val) + " and addi " + std::to_string(addi_val) +
+                        " to create " + std::to_string((lui_val << 12) + addi_val) + "\n";
+            }
+            if (lui_val != 0 || fixed) {
+                code += "    lui " + reg + ", " + std::to_string(lui_val) + "\n";
+                counts.after++;
+            }
+            // ADDI of zero after LUI only keeps the pair shape
+            if (addi_val != 0 || (lui_val != 0 && !relative) || fixed) {
+                code += "    addi " + reg + ", " + reg + ", " + std::to_string(addi_val) + "\n";
+                counts.after++;
+            }
+            loaded.push_back({reg, value});
+            return code;
+        };
+
+        // For each required base register in memory config
+        for (const auto& [reg, base_value] : mem_config) {
+            if (base_value >= 0) {  // Only process positive values
+                int cluster_addr = calculateClusterBaseAddress(reg, cluster_num, data_dup, pe_id);
+                
+                std::stringstream ss;
+                ss << "    # Loading " << reg << " with address 0x" 
+                   << std::hex << std::uppercase << cluster_addr 
+                   << std::dec << " (" << cluster_addr << ")\n";
+                result += ss.str() + load(reg, cluster_addr, fixed_shape, true) + "\n";
+            }
+        }
+
+        // Load the buffer stride used by the swap points
+        if (tiling.enabled) {
+            result += "    # Loading " + tiling.swap_register + " with buffer stride " +
+                      std::to_string(tiling.buffer_stride) + "\n";
+            result += load(tiling.swap_register, tiling.buffer_stride, false, false) + "\n";
+        }
+
+        if (stats) {
+            *stats += counts;
+        }
+        return result;
+    }
+
+    // Helper function to generate the buffer swap point at the end of a tile.
+    // The swap register flips sign after every swap, so the double-buffered
+    // bases alternate between the ping and pong buffers across tiles.
+    std::string generateBufferSwapPoint() {
+        if (!tiling.enabled) return "";
+
+        std::string result = "    # ========== Buffer Swap Point ==========\n";
+        for (const auto& reg : tiling.double_buffer) {
+            result += "    add " + reg + ", " + reg + ", " + tiling.swap_register + "\n";
+        }
+        if (!tiling.double_buffer.empty()) {
+            result += "    sub " + tiling.swap_register + ", x0, " + tiling.swap_register + "\n";
+        }
+
+        for (const auto& [reg, stride] : tiling.tile_advance) {
+            if (stride >= -2048 && stride <= 2047) {
+                result += "    addi " + reg + ", " + reg + ", " + std::to_string(stride) + "\n";
+                continue;
+            }
+            auto [lui_val, addi_val] = calculateLuiAddiValues(stride);
+            if (addi_val & 0x800) {
+                addi_val = addi_val | 0xFFFFF000;
+            }
+            result += "    # Advancing " + reg + " by " + std::to_string(stride) + " bytes per tile\n";
+            result += "    lui " + tiling.advance_register + ", " + std::to_string(lui_val) + "\n";
+            result += "    addi " + tiling.advance_register + ", " + tiling.advance_register + ", " +
+                      std::to_string(addi_val) + "\n";
+            result += "    add " + reg + ", " + reg + ", " + tiling.advance_register + "\n";
+        }
+        return result;
+    }
+
+    // Helper function to count the instruction words of generated code,
+    // skipping the same comment/label lines as the assembler
+    int countInstructionWords(const std::string& code) {
+        int words = 0;
+        std::istringstream iss(code);
+        std::string line;
+        while (std::getline(iss, line)) {
+            size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#' || line[first] == '.' ||
+                line[first] == '_' || line.find(':') != std::string::npos) {
+                continue;
+            }
+            words++;
+        }
+        return words;
+    }
+
+    // Start delay of a PE in cycles, and the delay words that wait it out
+    int startDelay(int pe_id) const {
+        return (pe_id < static_cast<int>(delay_start.size())) ? delay_start[pe_id] : 0;
+    }
+
+    int delayWords(int pe_id) const {
+        return (startDelay(pe_id) + kMaxDelayCycles - 1) / kMaxDelayCycles;
+    }
+
+    // Helper function to get the number of words an IR instruction emits
+    int emittedWords(const IROp& ir) {
+        switch (opInfo(ir.op).cls) {
+            case OpClass::Hwl:
+                return 2;
+            case OpClass::Unknown:
+                return 0;
+            case OpClass::IType:
+                if (ir.op == Opcode::ADDI && (ir.imm > 2047 || ir.imm < -2048)) {
+                    return calculateLuiAddiValues(ir.imm).first != 0 ? 2 : 1;
+                }
+                return 1;
+            default:
+                return 1;
+        }
+    }
+
+    // Helper function to split the execution section into imem overlay segments.
+    // A segment may only end at an HWL nest edge, i.e. where no loop body (nor
+    // the hwlrf pair that sets it up) spans the cut. Each segment ends with a
+    // ret, the last one also carries tail_words of swap point/function code.
+    std::vector<OverlaySegment> splitOverlaySegments(const PEAssignment& assignment, int pe_id, 
+                                                     int tail_words) {
+        const auto& ir = assignment.ir;
+        size_t n = ir.size();
+        std::vector<int> pcs(n + 1, 0);
+        for (size_t i = 0; i < n; i++) {
+            pcs[i + 1] = pcs[i] + emittedWords(ir[i]);
+        }
+
+        auto isNestEdge = [&](size_t idx) {
+            for (size_t j = 0; j < idx; j++) {
+                if (ir[j].op != Opcode::HWL) continue;
+                const HardwareLoop& hwl = assignment.instructions[ir[j].src].hwl.value();
+                if (pcs[j] < pcs[idx] && pcs[idx] <= hwl.pc_stop) return false;
+            }
+            return true;
+        };
+
+        int delay = delayWords(pe_id);
+        std::vector<OverlaySegment> segments;
+        size_t first = 0;
+        size_t last_edge = 0;
+        for (size_t i = 1; i <= n; i++) {
+            int limit = imem_exec_words - 1 - (segments.empty() ? delay : 0);
+            int used = pcs[i] - pcs[first] + (i == n ? tail_words : 0);
+            if (used > limit) {
+                if (last_edge <= first) {
+                    throw std::runtime_error("PE " + std::to_string(pe_id) + ": code from exec pc " + 
+                        std::to_string(pcs[first]) + " needs more than " + std::to_string(limit) + 
+                        " words without an HWL nest edge to split an overlay segment at");
+                }
+                segments.push_back({first, last_edge, pcs[first]});
+                first = last_edge;
+                i = first;
+                continue;
+            }
+            if (i < n && isNestEdge(i)) {
+                last_edge = i;
+            }
+        }
+        segments.push_back({first, n, pcs[first]});
+
+        // Function calls jump to absolute addresses of the final image
+        for (size_t s = 0; s + 1 < segments.size(); s++) {
+            for (size_t i = segments[s].first; i < segments[s].last; i++) {
+                if (ir[i].op == Opcode::JAL) {
+                    throw std::runtime_error("PE " + std::to_string(pe_id) + 
+                        ": function calls and outlined loop body code must be in the last overlay segment");
+                }
+            }
+        }
+        return segments;
+    }
+
+    // Code that outlineLongBodies moved out of loop bodies, one routine per run
+    std::string generateOutlinedSections(const PEAssignment& assignment, int pe) {
+        std::string result;
+        if (assignment.outlined.empty()) return result;
+
+        // ret is a nop, the PE only stops at an all-zero word
+        result += "    halt  # Stop before the outlined code\n";
+        result += "\n    # ========== Outlined Loop Body Code ==========\n";
+        int hwl_count = 0;  // Outlined code has no loops
+        for (const auto& [label, code] : assignment.outlined) {
+            result += "\n" + label + ":\n";
+            for (const auto& ir : code) {
+                result += generateInstructionCode(assignment, ir, hwl_count, pe);
+            }
+            result += "    jalr x0, x26, 0  # Back into the loop body\n";
+        }
+        return result;
+    }
+
+    std::string generateFunctionSections(int pe, int& hwl_count) {
+        std::string result;
+        if (function_pe_assignments.empty()) return result;
+
+        result += "\n    # ========== Function Sections ==========\n";
+        for (const auto& func : function_pe_assignments) {
+            const std::string& func_name = func.first;
+            const auto& pe_assigns = func.second;
+            
+            if (pe_assigns.find(pe) != pe_assigns.end()) {
+                const PEAssignment& func_assignment = pe_assigns.at(pe);
+                
+                // Add function label
+                std::stringstream ss;
+                ss << "\n" << func_name << ":\n";
+                ss << "    # Function " << func_name << " (address: 0x" 
+                   << std::hex << function_addresses[func_name] << std::dec << ")\n";
+                result += ss.str();
+                
+                for (const auto& ir : func_assignment.ir) {
+                    result += generateInstructionCode(func_assignment, ir, hwl_count, pe);
+                }
+                
+                // Add return instruction if not already present
+                if (func_assignment.ir.empty() || 
+                    func_assignment.ir.back().op != Opcode::JALR) {
+                    result += "    jalr x0, x26, 0  # Return from function\n";
+                }
+            }
+        }
+        return result;
+    }
+
+    // With optimize_preload, writes that cannot change a register are left out:
+    // corf.addi ORs its immediate into the destination and ppsrf.addi sets the
+    // tag, so a var group loaded again with the same values, or a corf.addi of
+    // zero low bits after corf.lui, costs nothing. Neither instruction reads
+    // its source register, so CoRF values can't be built from a neighbour.
+    std::string generatePreloadSection(const PEAssignment& pe_assignment, PreloadStats* stats = nullptr) {
+        std::string preload;
+        bool has_psrf = false;
+        bool has_mem_type = false;
+        preload += "    # Preload section for PSRF variables and coefficients\n";
+
+        std::map<int, int> tags;                          // v register -> tag written
+        std::map<int, std::pair<bool, uint32_t>> corf;    // c register -> exact value, bits known set
+        PreloadStats counts;
+        
+        // Generate PSRF variable loads, once per instruction (pipelined
+        // loops repeat some in their prologue)
+        std::set<uint16_t> loaded;
+        for (const auto& ir : pe_assignment.ir) {
+            if (opInfo(ir.op).cls == OpClass::PsrfMem && loaded.insert(ir.src).second) {
+                const Instruction& instr = pe_assignment.instructions[ir.src];
+                has_psrf = true;
+                
+                // Get the var value for this instruction
+                int var_value = (ir.var != NO_REG) ? ir.var : 0;
+                
+                // Calculate register base for this var value
+                int reg_base = var_value * 6;  // var=0: 0-5, var=1: 6-11, var=2: 12-17
+                std::string group;
+                
+                for (const auto& [var_key, value] : instr.psrf_var) {
+                    if (value != 0) {  // Only generate for non-zero values
+                        // Extract the register number from the key (e.g., v0 -> 0)
+                        int base_reg = std::stoi(var_key.substr(1));
+                        // Calculate the actual register number based on var value
+                        int reg_num = reg_base + base_reg;
+                        
+                        counts.before++;
+                        auto tag = tags.find(reg_num);
+                        if (optimize_preload && tag != tags.end() && tag->second == (value & 0x1F)) {
+                            continue;
+                        }
+                        tags[reg_num] = value & 0x1F;
+                        counts.after++;
+          
+                        // Use the first register of the group as source
+                        group += "    ppsrf.addi v" + std::to_string(reg_num) + 
+                                ", v" + std::to_string(reg_base) + 
+                                ", " + std::to_string(value) + "\n";
+                    }
+                }
+                
+                // Generate coefficient loads with corf.addi
+                for (const auto& [coef_key, value] : instr.coefficients) {
+                    if (value != 0) {  // Only generate for non-zero values
+                        // Extract the register number from the key (e.g., c0 -> 0)
+                        int base_reg = std::stoi(coef_key.substr(1));
+                        // Calculate the actual register number based on var value
+                        int reg_num = reg_base + base_reg;
+                        auto& [exact, bits] = corf[reg_num];
+                        
+                        if (value > 4095) { 
+                            // corf.addi range is 0 to 4095. 
+                            // If negative, we need to sign extend the value
+                            // Use the first register of the group as source
+                            counts.before += 2;
+                            if (optimize_preload && exact && bits == uint32_t(value)) {
+                                continue;
+                            }
+                            exact = true;
+                            bits = uint32_t(value >> 12) << 12;
+                            counts.after++;
+                            group += "    corf.lui c" + std::to_string(reg_num) + 
+                                    ", " + std::to_string(value >> 12) + "\n";
+                        } else {
+                            counts.before++;
+                        }
+                        uint32_t low = uint32_t(value) & 0xFFF;
+                        if (optimize_preload && (low & ~bits) == 0) {
+                            continue;
+                        }
+                        bits |= low;
+                        counts.after++;
+                        // Use the first register of the group as source
+                        group += "    corf.addi c" + std::to_string(reg_num) + 
+                                  ", c" + std::to_string(reg_base) + 
+                                  ", " + std::to_string(value > 4095 ? (value & 0xFFF) : value) + "\n";
+                    }
+                }
+                
+                // Add a comment indicating which var group we're using
+                if (group.empty() && optimize_preload) {
+                    preload += "    # var=" + std::to_string(var_value) + " (registers " + 
+                              std::to_string(reg_base) + "-" + std::to_string(reg_base+5) + ") already loaded\n";
+                } else {
+                    preload += "    # Using var=" + std::to_string(var_value) + 
+                              " (registers " + std::to_string(reg_base) + "-" + 
+                              std::to_string(reg_base+5) + ")\n" + group;
+                }
+            } 
+            // else if (instr.format == "mem-type") {
+            //     has_mem_type = true;
+            //     preload += "    # Memory offset: " + std::to_string(instr.offset) + "\n";
+            //     preload += "    addi " + instr.ra1 + ", " + instr.base_address + ", " + std::to_string(instr.offset) + "\n";
+            // }   
+        }
+        
+        if (!pe_assignment.psrf_offsets.empty()) {
+            preload += "    # AGU offset registers\n";
+            for (const auto& [reg, value] : pe_assignment.psrf_offsets) {
+                preload += "    offs.addi o" + std::to_string(reg) + ", o" + std::to_string(reg) + 
+                           ", " + std::to_string(value) + "\n";
+                counts.before++;
+                counts.after++;
+            }
+        }
+        
+        if (!has_psrf && !has_mem_type) return "";
+        if (stats) {
+            *stats += counts;
+        }
+        
+        preload += "\n";
+        return preload;
+    }
+
+    // Name the body of every HWL in the segment, the assembler then derives
+    // pc_start and the body length from the label positions. A loop whose
+    // pc_start or pc_stop is not the first word of an instruction of the
+    // segment keeps the numeric immediate.
+    LoopLabels placeLoopLabels(const PEAssignment& assignment, const OverlaySegment& segment, int hwl_count) {
+        const auto& ir = assignment.ir;
+        std::map<int, size_t> word_to_ir;
+        int pc = segment.pc_base;
+        for (size_t i = segment.first; i < segment.last; i++) {
+            word_to_ir.emplace(pc, i);
+            pc += emittedWords(ir[i]);
+        }
+
+        LoopLabels labels;
+        for (size_t i = segment.first; i < segment.last; i++) {
+            if (ir[i].op != Opcode::HWL) continue;
+            hwl_count++;
+            const HardwareLoop& hwl = assignment.instructions[ir[i].src].hwl.value();
+            auto start = word_to_ir.find(hwl.pc_start);
+            auto stop = word_to_ir.find(hwl.pc_stop);
+            if (start == word_to_ir.end() || stop == word_to_ir.end() || hwl.pc_stop < hwl.pc_start) {
+                continue;
+            }
+            std::string name = "hwl" + std::to_string(hwl_count);
+            labels.before[start->second].push_back(name + "_start");
+            labels.before[stop->second].push_back(name + "_end");
+            labels.loops[i] = {name + "_start", name + "_end"};
+        }
+        return labels;
+    }
+
+    std::string generateHWLInstructions(const Instruction& instr, int hwl_count, int pe_id, int pc_base = 0,
+                                         const std::pair<std::string, std::string>* labels = nullptr) {
+        if (!instr.hwl.has_value()) return "";
+
+        // The assembler places labelled loops, delay words included
+        if (labels != nullptr) {
+            const HardwareLoop& hwl = instr.hwl.value();
+            std::string result;
+            result += "    # hwl " + std::to_string(hwl_count) + ": pc_start=" + std::to_string(hwl.pc_start) + 
+                      ", pc_stop=" + std::to_string(hwl.pc_stop) + "\n";
+            result += "    hwlrf L" + std::to_string(hwl.loop_id) + ", " + labels->first + ", " + 
+                      labels->second + ", " + std::to_string(hwl.hwl_index) + ", " + 
+                      std::to_string(hwl.iterations) + "\n";
+            return result;
+        }
+
+        // Loops inside an overlay segment are encoded relative to the segment start
+        HardwareLoop hwl = instr.hwl.value();
+        hwl.pc_start -= pc_base;
+        hwl.pc_stop -= pc_base;
+        
+        // Words of the delay instructions, only the first segment carries them
+        int delay = (pc_base == 0) ? delayWords(pe_id) : 0;
+        
+        // Adjust pc_start and pc_stop by adding the delay words
+        int adjusted_pc_start = hwl.pc_start + delay;
+        int adjusted_pc_stop = hwl.pc_stop - adjusted_pc_start;
+        
+        uint32_t imm = calculateHWLImmediate(hwl, delay);
+        auto [upper, lower] = splitHWLImmediate(imm);
+
+        std::string result = "";
+        
+        // Add comment showing the immediate value calculation with delay adjustment
+        result += "    # hwl_imm_" + std::to_string(hwl_count) + " = ";
+        result += "((" + std::to_string(adjusted_pc_start) + " << 23) + ";
+        result += "(" + std::to_string(adjusted_pc_stop) + " << 17) + ";
+        result += "(" + std::to_string(hwl.hwl_index) + " << 12) + ";
+        result += std::to_string(hwl.iterations) + "\n";
+        result += "    # Original pc_start=" + std::to_string(instr.hwl->pc_start) + 
+                 ", pc_stop=" + std::to_string(instr.hwl->pc_stop) + 
+                 ", delay=" + std::to_string(delay);
+        if (pc_base != 0) {
+            result += ", overlay base=" + std::to_string(pc_base);
+        }
+        result += "\n";
+
+        // Generate HWL instructions with adjusted immediate values
+        result += "    hwlrf.lui L" + std::to_string(hwl.loop_id) + ", " + std::to_string(upper) + "\n";
+        result += "    hwlrf.addi L" + std::to_string(hwl.loop_id) + ", L" + std::to_string(hwl.loop_id);
+        result += ", " + std::to_string(lower) + "\n";
+
+        return result;
+    }
+
+    // Helper function to map an operation name to its opcode. psrf.ld2 only
+    // comes from pairWordLoads: the IR passes don't see its write of rd + 1.
+    Opcode parseOpcode(const std::string& operation, const std::string& format) {
+        if (format == "hwl-type") return Opcode::HWL;
+
+        static const std::unordered_map<std::string, Opcode> lookup = [] {
+            std::unordered_map<std::string, Opcode> table;
+            for (const auto& info : kOpcodeTable) {
+                if (info.cls != OpClass::Hwl && info.cls != OpClass::Unknown && info.op != Opcode::PSRF_LD2) {
+                    table[info.mnemonic] = info.op;
+                }
+            }
+            return table;
+        }();
+
+        std::string op = operation;
+        std::transform(op.begin(), op.end(), op.begin(), ::tolower);
+        auto it = lookup.find(op);
+        return it == lookup.end() ? Opcode::UNKNOWN : it->second;
+    }
+
+    // Helper function to map a register name (x0-x31, vr0-vr95, "null") to its number
+    int8_t parseRegister(const std::string& reg) {
+        if (reg.empty() || reg == "null") return NO_REG;
+        if (reg.size() > 1 && reg[0] == 'x' &&
+            std::all_of(reg.begin() + 1, reg.end(), ::isdigit)) {
+            int num = std::stoi(reg.substr(1));
+            if (num < 32) return static_cast<int8_t>(num);
+        }
+        if (reg.size() > 2 && reg.compare(0, 2, "vr") == 0 && reg.size() < 6 &&
+            std::all_of(reg.begin() + 2, reg.end(), ::isdigit)) {
+            int num = std::stoi(reg.substr(2));
+            if (num < kMaxVirtualRegs) return static_cast<int8_t>(kFirstVirtualReg + num);
+        }
+        throw std::runtime_error("unknown register '" + reg + "'");
+    }
+
+    // Lower one YAML instruction into the typed IR
+    IROp lowerInstruction(const Instruction& instr, size_t index) {
+        IROp ir;
+        ir.src = static_cast<uint16_t>(index);
+        ir.op = parseOpcode(instr.operation, instr.format);
+        const OpcodeInfo& info = opInfo(ir.op);
+
+        switch (info.cls) {
+            case OpClass::PsrfMem:
+            case OpClass::Mem:
+                // psrf.* only exists as psrf-mem-type and vice versa
+                if ((info.cls == OpClass::PsrfMem) != (instr.format == "psrf-mem-type")) {
+                    ir.op = Opcode::UNKNOWN;
+                    break;
+                }
+                if (info.flags & OP_LOAD) {
+                    ir.rd = parseRegister(instr.ra1);
+                } else {
+                    ir.rs2 = parseRegister(instr.ra1);
+                }
+                ir.base = parseRegister(instr.base_address);
+                ir.var = instr.var.has_value() ? static_cast<int8_t>(instr.var.value()) : NO_REG;
+                ir.imm = instr.offset;
+                break;
+            case OpClass::IType:
+                ir.rd = parseRegister(instr.rd);
+                ir.rs1 = parseRegister(instr.ra1);
+                ir.imm = instr.imm;
+                break;
+            case OpClass::RType:
+                ir.rd = parseRegister(instr.rd);
+                ir.rs1 = parseRegister(instr.ra1);
+                ir.rs2 = parseRegister(instr.ra2);
+                break;
+            case OpClass::BType:
+                // Branches name their first source rd in the YAML
+                ir.rs1 = parseRegister(instr.rd);
+                ir.rs2 = parseRegister(instr.ra1);
+                ir.imm = instr.imm;
+                break;
+            case OpClass::UType:
+                // LUI/AUIPC name their destination ra1 in the YAML
+                ir.rd = parseRegister(instr.ra1);
+                ir.imm = instr.imm;
+                break;
+            case OpClass::JType:
+                ir.rd = parseRegister(instr.rd);
+                ir.imm = instr.target.empty() ? instr.imm : instr.address;
+                break;
+            default:
+                break;
+        }
+        return ir;
+    }
+
+    // Address terms of a PSRF access. A PSRF register only moves when its tag
+    // names a loop and its coefficient is not zero, terms of one tag add up.
+    std::map<int, int> addressTerms(const Instruction& instr) {
+        std::map<int, int> terms;
+        for (const auto& [var_key, tag] : instr.psrf_var) {
+            auto coef = instr.coefficients.find("c" + var_key.substr(1));
+            if (tag != 0 && coef != instr.coefficients.end() && coef->second != 0) {
+                terms[tag] += coef->second;
+            }
+        }
+        for (auto it = terms.begin(); it != terms.end();) {
+            it = (it->second == 0) ? terms.erase(it) : std::next(it);
+        }
+        return terms;
+    }
+
+    // Give every psrf access without a var (or var: auto) a PSRF/CoRF var
+    // group. Accesses with the same address terms share one group, groups
+    // named in the YAML stay as they are. When more streams remain than
+    // groups, the streams that software can't follow come first, then the
+    // ones whose base pointer updates would run most often. The other
+    // streams become lw/sw from their base register, which an addi moves
+    // by the stream stride after the last access of each innermost iteration.
+    void allocateVarGroups(PEAssignment& assignment) {
+        auto& ir = assignment.ir;
+        std::vector<AddressStream> streams;
+        std::map<int, size_t> named;  // var -> first instruction naming it
+        for (size_t i = 0; i < ir.size(); i++) {
+            if (opInfo(ir[i].op).cls != OpClass::PsrfMem) continue;
+            const Instruction& instr = assignment.instructions[ir[i].src];
+            if (instr.var.has_value()) {
+                named.emplace(instr.var.value(), ir[i].src);
+                continue;
+            }
+            std::map<int, int> terms = addressTerms(instr);
+            auto stream = std::find_if(streams.begin(), streams.end(),
+                                       [&](const AddressStream& s) { return s.terms == terms; });
+            if (stream == streams.end()) {
+                AddressStream fresh;
+                fresh.terms = terms;
+                stream = streams.insert(streams.end(), fresh);
+            }
+            stream->accesses.push_back(i);
+        }
+        if (streams.empty()) return;
+
+        std::vector<int> pcs(ir.size() + 1, 0);
+        for (size_t i = 0; i < ir.size(); i++) {
+            pcs[i + 1] = pcs[i] + emittedWords(ir[i]);
+        }
+        // Loops around an instruction, outermost first
+        auto enclosingLoops = [&](size_t idx) {
+            std::vector<const HardwareLoop*> loops;
+            for (size_t j = 0; j < ir.size(); j++) {
+                if (ir[j].op != Opcode::HWL) continue;
+                const HardwareLoop& hwl = assignment.instructions[ir[j].src].hwl.value();
+                if (hwl.pc_start <= pcs[idx] && pcs[idx] <= hwl.pc_stop) {
+                    loops.push_back(&hwl);
+                }
+            }
+            std::stable_sort(loops.begin(), loops.end(), [](const HardwareLoop* a, const HardwareLoop* b) {
+                return a->pc_stop - a->pc_start > b->pc_stop - b->pc_start;
+            });
+            return loops;
+        };
+        bool has_calls = std::any_of(ir.begin(), ir.end(), [](const IROp& op) { return op.op == Opcode::JAL; });
+
+        // Software stride of every stream and base register, set where it exists
+        std::map<std::pair<size_t, int8_t>, std::pair<size_t, int>> updates;  // -> last access, stride
+        for (size_t s = 0; s < streams.size(); s++) {
+            AddressStream& stream = streams[s];
+            std::map<int8_t, std::vector<size_t>> by_base;
+            for (size_t i : stream.accesses) {
+                by_base[ir[i].base].push_back(i);
+                if (ir[i].op == Opcode::PSRF_ZD_LW) {
+                    stream.needs_group = "psrf.zd.lw has no plain counterpart";
+                }
+            }
+            if (tiling.enabled) {
+                stream.needs_group = "tiled programs keep their base registers";
+            } else if (has_calls) {
+                stream.needs_group = "function calls use fixed addresses";
+            }
+
+            for (const auto& [base, accesses] : by_base) {
+                size_t last = accesses.back();
+                auto loops = enclosingLoops(last);
+                for (size_t i : accesses) {
+                    if (enclosingLoops(i) != loops) {
+                        stream.needs_group = "x" + std::to_string(base) + " is accessed from different loops";
+                    }
+                }
+                for (size_t k = 0; k < ir.size(); k++) {
+                    bool own = std::find(accesses.begin(), accesses.end(), k) != accesses.end();
+                    if (!own && (ir[k].rd == base || ir[k].rs1 == base || ir[k].rs2 == base || ir[k].base == base)) {
+                        stream.needs_group = "x" + std::to_string(base) + " is also used by other instructions";
+                    }
+                }
+
+                // The address must advance by one stride per innermost
+                // iteration: an outer coefficient equals the stride times
+                // the iterations of the loops inside it
+                std::map<int, int> terms = stream.terms;
+                int stride = 0;
+                if (!loops.empty() && terms.count(loops.back()->hwl_index)) {
+                    stride = terms[loops.back()->hwl_index];
+                }
+                long long step = stride;
+                double executions = 1;
+                for (auto loop = loops.rbegin(); loop != loops.rend(); ++loop) {
+                    auto term = terms.find((*loop)->hwl_index);
+                    if ((term == terms.end() ? 0 : term->second) != step) {
+                        stream.needs_group = "its address does not advance by a constant stride";
+                    }
+                    if (term != terms.end()) terms.erase(term);
+                    step *= (*loop)->iterations;
+                    executions *= (*loop)->iterations;
+                }
+                if (!terms.empty()) {
+                    stream.needs_group = "a coefficient belongs to a loop outside its nest";
+                } else if (stride < -2048 || stride > 2047) {
+                    stream.needs_group = "its stride does not fit an addi";
+                }
+                if (stride != 0) {
+                    stream.software_cost += executions;
+                    updates[{s, base}] = {last, stride};
+                }
+            }
+        }
+
+        // Streams that need a group first, then by the updates saved
+        std::set<int> used;
+        for (const auto& [var, src] : named) {
+            used.insert(var);
+            for (auto& stream : streams) {
+                if (stream.terms == addressTerms(assignment.instructions[src])) {
+                    stream.var = var;
+                }
+            }
+        }
+        std::vector<size_t> order;
+        for (size_t s = 0; s < streams.size(); s++) {
+            if (streams[s].var == NO_REG) order.push_back(s);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (streams[a].needs_group.empty() != streams[b].needs_group.empty()) {
+                return !streams[a].needs_group.empty();
+            }
+            return streams[a].software_cost > streams[b].software_cost;
+        });
+        for (size_t s : order) {
+            for (int var = 0; var < 3 && streams[s].var == NO_REG; var++) {
+                if (used.insert(var).second) {
+                    streams[s].var = var;
+                }
+            }
+            if (streams[s].var == NO_REG && !streams[s].needs_group.empty()) {
+                throw std::runtime_error("PE " + std::to_string(assignment.pe_id) + ": psrf access at exec pc " +
+                    std::to_string(pcs[streams[s].accesses.front()]) + " needs a PSRF var group, but all 3 are " +
+                    "taken and " + streams[s].needs_group);
+            }
+        }
+
+        std::vector<std::tuple<size_t, int8_t, int>> inserts;  // after IR index, base register, stride
+        for (size_t s = 0; s < streams.size(); s++) {
+            const AddressStream& stream = streams[s];
+            if (stream.var != NO_REG) {
+                std::cout << "PE " << assignment.pe_id << ": " << stream.accesses.size() 
+                          << " psrf accesses use var group " << stream.var << std::endl;
+            }
+            for (size_t i : stream.accesses) {
+                Instruction& instr = assignment.instructions[ir[i].src];
+                if (stream.var != NO_REG) {
+                    // Shared groups take the register layout of the first access
+                    auto first = named.find(stream.var);
+                    if (first != named.end()) {
+                        instr.psrf_var = assignment.instructions[first->second].psrf_var;
+                        instr.coefficients = assignment.instructions[first->second].coefficients;
+                    } else {
+                        instr.psrf_var.clear();
+                        instr.coefficients.clear();
+                        int k = 0;
+                        for (const auto& [tag, coef] : stream.terms) {
+                            instr.psrf_var["v" + std::to_string(k)] = tag;
+                            instr.coefficients["c" + std::to_string(k++)] = coef;
+                        }
+                    }
+                    instr.var = stream.var;
+                    ir[i].var = static_cast<int8_t>(stream.var);
+                    continue;
+                }
+                switch (ir[i].op) {
+                    case Opcode::PSRF_LW: ir[i].op = Opcode::LW; break;
+                    case Opcode::PSRF_LB: ir[i].op = Opcode::LB; break;
+                    case Opcode::PSRF_SW: ir[i].op = Opcode::SW; break;
+                    case Opcode::PSRF_SB: ir[i].op = Opcode::SB; break;
+                    default: break;
+                }
+                instr.operation = opInfo(ir[i].op).mnemonic;
+                instr.format = "mem-type";
+                ir[i].imm = 0;
+                assignment.has_mem_type = true;
+            }
+            if (stream.var == NO_REG) {
+                std::cout << "PE " << assignment.pe_id << ": " << stream.accesses.size() 
+                          << " psrf accesses use software addressing" << std::endl;
+                for (const auto& [key, update] : updates) {
+                    if (key.first == s) {
+                        inserts.emplace_back(update.first, key.second, update.second);
+                    }
+                }
+            }
+        }
+        assignment.has_psrf_mem_type = std::any_of(ir.begin(), ir.end(), [](const IROp& op) {
+            return opInfo(op.op).cls == OpClass::PsrfMem;
+        });
+
+        // Insert the base pointer updates back to front, every loop around or
+        // after an update grows by its word
+        std::sort(inserts.rbegin(), inserts.rend());
+        for (const auto& [after, base, stride] : inserts) {
+            Instruction update;
+            update.operation = "ADDI";
+            update.format = "i-type";
+            update.rd = update.ra1 = "x" + std::to_string(base);
+            update.ra2 = "null";
+            update.imm = stride;
+            insertInstruction(assignment, after + 1, update, true);
+            std::cout << "PE " << assignment.pe_id << ": x" << int(base) << " += " << stride 
+                      << " after exec pc " << pcs[after] << std::endl;
+        }
+    }
+
+    // Exec pc of every IR instruction, pcs[ir.size()] is the end of the section
+    std::vector<int> wordPcs(const std::vector<IROp>& ir) {
+        std::vector<int> pcs(ir.size() + 1, 0);
+        for (size_t i = 0; i < ir.size(); i++) {
+            pcs[i + 1] = pcs[i] + emittedWords(ir[i]);
+        }
+        return pcs;
+    }
+
+    // Insert an instruction in front of IR index at and move the loops behind
+    // it. With join_previous it joins the loops that end with the instruction
+    // before it, otherwise the loops that start with the instruction at.
+    void insertInstruction(PEAssignment& assignment, size_t at, const Instruction& instr, bool join_previous) {
+        std::vector<int> pcs = wordPcs(assignment.ir);
+        IROp op = lowerInstruction(instr, assignment.instructions.size());
+        int pc = pcs[at];
+        int words = emittedWords(op);
+        for (auto& other : assignment.instructions) {
+            if (!other.hwl.has_value()) continue;
+            HardwareLoop& hwl = other.hwl.value();
+            if (hwl.pc_start > pc || (hwl.pc_start == pc && join_previous)) {
+                hwl.pc_start += words;
+            }
+            if (hwl.pc_stop >= pc) {
+                hwl.pc_stop += words;
+            } else if (join_previous && at > 0 && hwl.pc_stop == pcs[at - 1]) {
+                hwl.pc_stop = pc;
+            }
+        }
+        assignment.ir.insert(assignment.ir.begin() + at, op);
+        assignment.instructions.push_back(instr);
+    }
+
+    // HWL records of the IR in program order
+    std::vector<HardwareLoop*> programLoops(PEAssignment& assignment) {
+        std::vector<HardwareLoop*> loops;
+        for (const auto& op : assignment.ir) {
+            if (op.op == Opcode::HWL) {
+                loops.push_back(&assignment.instructions[op.src].hwl.value());
+            }
+        }
+        return loops;
+    }
+
+    // Bring every loop of the program within the fields of the hwlrf
+    // immediate: counts above 12 bits get an extra nest level, and code is
+    // moved out of bodies longer than the 6-bit length. Throws when the nest
+    // can't be legalized.
+    void legalizeLoops(PEAssignment& assignment) {
+        splitLongLoops(assignment);
+        outlineLongBodies(assignment);
+        checkLoopFields(assignment, "PE " + std::to_string(assignment.pe_id));
+    }
+
+    // A count N above 4095 is split into b * (N / b), b the largest factor
+    // up to 4095. A new loop around the hwlrf of the original one runs
+    // N / b times and takes over its nest level, the original loop and the
+    // loops in it move one level down. Every psrf access with a term for the
+    // original loop gets a term for the new one, scaled by b.
+    void splitLongLoops(PEAssignment& assignment) {
+        auto& ir = assignment.ir;
+        std::string where = "PE " + std::to_string(assignment.pe_id);
+        for (size_t j = 0; j < ir.size(); j++) {
+            if (ir[j].op != Opcode::HWL) continue;
+            HardwareLoop original = assignment.instructions[ir[j].src].hwl.value();
+            int count = original.iterations;
+            if (count <= kMaxHwlIterations) continue;
+
+            int inner = kMaxHwlIterations;
+            while (inner > 1 && count % inner != 0) inner--;
+            if (inner == 1) {
+                throw std::runtime_error(where + ": loop L" + std::to_string(original.loop_id) + " runs " +
+                    std::to_string(count) + " iterations, the 12-bit count allows " + 
+                    std::to_string(kMaxHwlIterations) + ", and the count has no factor up to " +
+                    std::to_string(kMaxHwlIterations) + " to split it over two nest levels");
+            }
+
+            std::set<int> tags;
+            for (const auto& instr : assignment.instructions) {
+                if (instr.hwl.has_value()) tags.insert(instr.hwl->hwl_index);
+                for (const auto& [key, tag] : instr.psrf_var) tags.insert(tag);
+            }
+            int tag = 1;
+            while (tag <= kMaxHwlTag && tags.count(tag)) tag++;
+            if (tag > kMaxHwlTag) {
+                throw std::runtime_error(where + ": no free hwl_index to split loop L" + 
+                                         std::to_string(original.loop_id));
+            }
+
+            // The original loop and the loops set up in its body move down
+            std::vector<int> pcs = wordPcs(ir);
+            for (size_t k = j; k < ir.size(); k++) {
+                if (ir[k].op == Opcode::HWL && (k == j || (original.pc_start <= pcs[k] && pcs[k] <= original.pc_stop))) {
+                    HardwareLoop& hwl = assignment.instructions[ir[k].src].hwl.value();
+                    hwl.loop_id++;
+                    if (k == j) hwl.iterations = inner;
+                }
+            }
+            for (const auto& op : ir) {
+                if (opInfo(op.op).cls != OpClass::PsrfMem) continue;
+                Instruction& instr = assignment.instructions[op.src];
+                std::map<int, int> terms = addressTerms(instr);
+                if (terms.count(original.hwl_index) == 0) continue;
+                int slot = 0;
+                auto used = [&](int k) {
+                    auto coef = instr.coefficients.find("c" + std::to_string(k));
+                    return coef != instr.coefficients.end() && coef->second != 0;
+                };
+                while (slot < 6 && used(slot)) slot++;
+                if (slot == 6) {
+                    throw std::runtime_error(where + ": psrf access at exec pc " + std::to_string(pcs[&op - &ir[0]]) +
+                        " has no free PSRF register for the loop split from L" + std::to_string(original.loop_id));
+                }
+                instr.psrf_var["v" + std::to_string(slot)] = tag;
+                instr.coefficients["c" + std::to_string(slot)] = terms[original.hwl_index] * inner;
+            }
+
+            Instruction outer = assignment.instructions[ir[j].src];
+            outer.hwl->hwl_index = tag;
+            outer.hwl->iterations = count / inner;
+            outer.hwl->loop_id = original.loop_id;
+            insertInstruction(assignment, j, outer, false);
+            // The body of the new loop starts with the hwlrf of the original
+            HardwareLoop& split = assignment.instructions.back().hwl.value();
+            split.pc_start = pcs[j] + emittedWords(ir[j]);
+            split.pc_stop = assignment.instructions[ir[j + 1].src].hwl->pc_stop;
+            std::cout << where << ": loop L" << original.loop_id << " of " << count << " iterations split into " 
+                      << split.iterations << " x " << inner << " (hwl_index " << tag << ")" << std::endl;
+            // Visit the new loop next, its count may still be too large
+            j--;
+        }
+    }
+
+    // A body longer than the 6-bit length field gets a straight-line run of
+    // its instructions moved behind the program, called with jal x26 and
+    // returning with jalr x0, x26, 0. Of the runs long enough, the one that
+    // executes least often is moved.
+    void outlineLongBodies(PEAssignment& assignment) {
+        auto& ir = assignment.ir;
+        std::string where = "PE " + std::to_string(assignment.pe_id);
+        while (true) {
+            std::vector<int> pcs = wordPcs(ir);
+            std::vector<HardwareLoop*> loops = programLoops(assignment);
+            auto longest = std::max_element(loops.begin(), loops.end(), [](const HardwareLoop* a, const HardwareLoop* b) {
+                return a->pc_stop - a->pc_start < b->pc_stop - b->pc_start;
+            });
+            if (longest == loops.end() || (*longest)->pc_stop - (*longest)->pc_start <= kMaxHwlLength) return;
+            const HardwareLoop& hwl = **longest;
+            std::string body = where + ": the body of loop L" + std::to_string(hwl.loop_id) + " at exec pc " +
+                std::to_string(hwl.pc_start) + ".." + std::to_string(hwl.pc_stop) + " is longer than the " +
+                std::to_string(kMaxHwlLength + 1) + " words of the 6-bit length field";
+
+            for (const auto& op : ir) {
+                const Instruction& instr = assignment.instructions[op.src];
+                if (op.op == Opcode::JAL && instr.label.empty()) {
+                    throw std::runtime_error(body + ", and function calls use fixed addresses");
+                }
+                if ((op.rd == 26 || op.rs1 == 26 || op.rs2 == 26 || op.base == 26) && instr.label.empty()) {
+                    throw std::runtime_error(body + ", and x26 is in use to call moved code");
+                }
+            }
+
+            // Runs of straight-line code that stay inside the same loops
+            int needed = hwl.pc_stop - hwl.pc_start - kMaxHwlLength + 1;
+            size_t best_first = 0, best_last = 0;
+            double best_executions = 0;
+            for (size_t i = 0; i < ir.size(); i++) {
+                if (pcs[i] < hwl.pc_start || pcs[i] > hwl.pc_stop) continue;
+                size_t last = i;
+                while (last < ir.size() && pcs[last] - pcs[i] < needed && pcs[last] <= hwl.pc_stop) {
+                    bool straight = isStraightLine(ir[last]);
+                    bool edge = std::any_of(loops.begin(), loops.end(), [&](const HardwareLoop* loop) {
+                        return loop->pc_stop == pcs[last] || (loop->pc_start == pcs[last] && last > i);
+                    });
+                    if (!straight || edge) break;
+                    last++;
+                }
+                if (pcs[last] - pcs[i] < needed) continue;
+                double executions = 1;
+                for (const HardwareLoop* loop : loops) {
+                    if (loop->pc_start <= pcs[i] && pcs[i] <= loop->pc_stop) executions *= loop->iterations;
+                }
+                if (best_last == 0 || executions < best_executions) {
+                    best_first = i;
+                    best_last = last;
+                    best_executions = executions;
+                }
+            }
+            if (best_last == 0) {
+                throw std::runtime_error(body + ", and it has no straight-line run of " + 
+                                         std::to_string(needed) + " words to move out");
+            }
+
+            // The call takes the place of the run, everything behind it moves up
+            std::string label = "outline" + std::to_string(assignment.outlined.size() + 1);
+            int moved = pcs[best_last] - pcs[best_first];
+            for (HardwareLoop* loop : loops) {
+                if (loop->pc_start >= pcs[best_last]) loop->pc_start += 1 - moved;
+                if (loop->pc_stop >= pcs[best_last]) loop->pc_stop += 1 - moved;
+            }
+            assignment.outlined.emplace_back(label, std::vector<IROp>(ir.begin() + best_first, ir.begin() + best_last));
+            Instruction call;
+            call.operation = "JAL";
+            call.format = "j-type";
+            call.rd = "x26";
+            call.label = label;
+            ir.erase(ir.begin() + best_first, ir.begin() + best_last);
+            ir.insert(ir.begin() + best_first, lowerInstruction(call, assignment.instructions.size()));
+            assignment.instructions.push_back(call);
+            std::cout << where << ": moved " << moved << " words at exec pc " << pcs[best_first] 
+                      << " out of loop L" << hwl.loop_id << " to " << label << std::endl;
+        }
+    }
+
+    // Fields that don't fit the hwlrf immediate would be masked silently
+    void checkLoopFields(PEAssignment& assignment, const std::string& where) {
+        for (const HardwareLoop* hwl : programLoops(assignment)) {
+            std::string loop = where + ": loop L" + std::to_string(hwl->loop_id) + " at exec pc " +
+                               std::to_string(hwl->pc_start) + ".." + std::to_string(hwl->pc_stop);
+            if (hwl->loop_id < 1 || hwl->loop_id > kMaxHwlLevel) {
+                throw std::runtime_error(loop + " needs nest level " + std::to_string(hwl->loop_id) + 
+                                         ", the HWL unit has L1..L" + std::to_string(kMaxHwlLevel));
+            }
+            if (hwl->iterations < 0 || hwl->iterations > kMaxHwlIterations) {
+                throw std::runtime_error(loop + " runs " + std::to_string(hwl->iterations) + 
+                                         " iterations, the 12-bit count allows " + std::to_string(kMaxHwlIterations));
+            }
+            if (hwl->pc_stop < hwl->pc_start || hwl->pc_stop - hwl->pc_start > kMaxHwlLength) {
+                throw std::runtime_error(loop + " does not fit the 6-bit body length");
+            }
+            if (hwl->hwl_index < 0 || hwl->hwl_index > kMaxHwlTag) {
+                throw std::runtime_error(loop + " has hwl_index " + std::to_string(hwl->hwl_index) + 
+                                         ", the field has 5 bits");
+            }
+        }
+    }
+
+    // Cycles an instruction occupies the core. A TCDM access takes a fetch
+    // and at least one memory cycle (doc/data_memory_system.md).
+    int issueCycles(const IROp& op) {
+        return (opInfo(op.op).flags & (OP_LOAD | OP_STORE)) ? 2 : 1;
+    }
+
+    // Cycles from the issue of op until its result can be read
+    int resultLatency(const IROp& op) {
+        return (opInfo(op.op).flags & OP_LOAD) ? load_latency : issueCycles(op);
+    }
+
+    static std::vector<int8_t> readRegisters(const IROp& op) {
+        std::vector<int8_t> regs;
+        for (int8_t reg : {op.rs1, op.rs2, op.base}) {
+            if (reg != NO_REG && reg != 0) regs.push_back(reg);
+        }
+        if ((opInfo(op.op).flags & OP_READS_RD) && op.rd != NO_REG && op.rd != 0) regs.push_back(op.rd);
+        return regs;
+    }
+
+    static int8_t writtenRegister(const IROp& op) {
+        return (opInfo(op.op).flags & OP_WRITES_RD) && op.rd != 0 ? op.rd : NO_REG;
+    }
+
+    // Estimated cycles of straight-line code run from an idle core
+    int runCycles(const std::vector<IROp>& code) {
+        std::map<int8_t, int> ready;
+        int cycle = 0;
+        for (const IROp& op : code) {
+            int issue = cycle;
+            for (int8_t reg : readRegisters(op)) {
+                issue = std::max(issue, ready[reg]);
+            }
+            if (writtenRegister(op) != NO_REG) {
+                ready[writtenRegister(op)] = issue + resultLatency(op);
+            }
+            cycle = issue + issueCycles(op);
+        }
+        return cycle;
+    }
+
+    // Estimated cycles of one steady-state iteration of a loop body: the
+    // second of two back-to-back iterations, so results carried into the
+    // next iteration count as well
+    int bodyCycles(const std::vector<IROp>& body) {
+        std::vector<IROp> twice(body);
+        twice.insert(twice.end(), body.begin(), body.end());
+        return runCycles(twice) - runCycles(body);
+    }
+
+    // List schedule of a straight-line body. Register dependences and the
+    // order of stores against all other memory accesses are kept, loads may
+    // pass each other. Each step issues the instruction that can start
+    // soonest, ties go to the longest latency path to the end of the body,
+    // then to the YAML order.
+    std::vector<IROp> listSchedule(const std::vector<IROp>& body) {
+        size_t n = body.size();
+        std::vector<std::vector<std::pair<size_t, int>>> preds(n);  // predecessor, cycles after its issue
+        std::vector<int> height(n, 0);
+        auto orders = [](const IROp& a, const IROp& b) {
+            unsigned ma = opInfo(a.op).flags & (OP_LOAD | OP_STORE), mb = opInfo(b.op).flags & (OP_LOAD | OP_STORE);
+            return ma && mb && ((ma | mb) & OP_STORE || a.op == Opcode::PSRF_ZD_LW || b.op == Opcode::PSRF_ZD_LW);
+        };
+        for (size_t j = 0; j < n; j++) {
+            std::vector<int8_t> reads = readRegisters(body[j]);
+            for (size_t i = 0; i < j; i++) {
+                int8_t wi = writtenRegister(body[i]), wj = writtenRegister(body[j]);
+                std::vector<int8_t> reads_i = readRegisters(body[i]);
+                if (wi != NO_REG && std::find(reads.begin(), reads.end(), wi) != reads.end()) {
+                    preds[j].emplace_back(i, resultLatency(body[i]));
+                } else if ((wi != NO_REG && wi == wj) || orders(body[i], body[j]) ||
+                           (wj != NO_REG && std::find(reads_i.begin(), reads_i.end(), wj) != reads_i.end())) {
+                    preds[j].emplace_back(i, issueCycles(body[i]));
+                }
+            }
+        }
+        for (size_t j = n; j-- > 0;) {
+            height[j] = std::max(height[j], issueCycles(body[j]));
+            for (const auto& [i, latency] : preds[j]) {
+                height[i] = std::max(height[i], latency + height[j]);
+            }
+        }
+
+        std::vector<int> issue(n, -1);
+        std::vector<IROp> order;
+        int cycle = 0;
+        while (order.size() < n) {
+            size_t best = n;
+            int best_start = 0;
+            for (size_t j = 0; j < n; j++) {
+                if (issue[j] >= 0) continue;
+                int start = cycle;
+                bool ready = true;
+                for (const auto& [i, latency] : preds[j]) {
+                    ready = ready && issue[i] >= 0;
+                    if (ready) start = std::max(start, issue[i] + latency);
+                }
+                if (!ready) continue;
+                if (best == n || start < best_start || (start == best_start && height[j] > height[best])) {
+                    best = j;
+                    best_start = start;
+                }
+            }
+            issue[best] = best_start;
+            cycle = best_start + issueCycles(body[best]);
+            order.push_back(body[best]);
+        }
+        return order;
+    }
+
+    // Instructions that may be moved within a loop body
+    static bool isStraightLine(const IROp& op) {
+        OpClass cls = opInfo(op.op).cls;
+        return cls == OpClass::Mem || cls == OpClass::PsrfMem || cls == OpClass::RType ||
+               (cls == OpClass::IType && op.op != Opcode::JALR) || op.op == Opcode::LUI || op.op == Opcode::NOP;
+    }
+
+    // IR range [a, b) of the body of an innermost loop without calls or
+    // branches. False for other loops.
+    bool innermostBody(PEAssignment& assignment, const HardwareLoop& hwl, size_t& a, size_t& b) {
+        const auto& ir = assignment.ir;
+        std::vector<int> pcs = wordPcs(ir);
+        auto first = std::find(pcs.begin(), pcs.end() - 1, hwl.pc_start);
+        auto last = std::find(pcs.begin(), pcs.end() - 1, hwl.pc_stop);
+        if (first == pcs.end() - 1 || last == pcs.end() - 1 || last < first) return false;
+        a = first - pcs.begin();
+        b = last - pcs.begin() + 1;
+
+        std::vector<HardwareLoop*> loops = programLoops(assignment);
+        bool inner = std::none_of(loops.begin(), loops.end(), [&](const HardwareLoop* other) {
+            return other != &hwl && ((hwl.pc_start <= other->pc_start && other->pc_start <= hwl.pc_stop) ||
+                                     (hwl.pc_start <= other->pc_stop && other->pc_stop < hwl.pc_stop));
+        });
+        return inner && std::all_of(ir.begin() + a, ir.begin() + b, isStraightLine);
+    }
+
+    // Executions of a loop body: the product of the counts of its nest
+    double loopExecutions(const std::vector<HardwareLoop*>& loops, const HardwareLoop& hwl) {
+        double executions = 1;
+        for (const HardwareLoop* loop : loops) {
+            if (loop->pc_start <= hwl.pc_start && hwl.pc_stop <= loop->pc_stop) executions *= loop->iterations;
+        }
+        return executions;
+    }
+
+    // Reorder the straight-line body of every innermost loop when the list
+    // schedule saves cycles under the latency model. The words of a body
+    // stay the same, so pc_start and pc_stop don't move. With the default
+    // load_latency the core waits for every load itself, and bodies keep
+    // their YAML order.
+    void scheduleLoopBodies(PEAssignment& assignment) {
+        auto& ir = assignment.ir;
+        std::vector<HardwareLoop*> loops = programLoops(assignment);
+        double before = 0, after = 0;
+        for (const HardwareLoop* hwl : loops) {
+            size_t a, b;
+            if (!innermostBody(assignment, *hwl, a, b)) continue;
+            double executions = loopExecutions(loops, *hwl);
+            std::vector<IROp> body(ir.begin() + a, ir.begin() + b);
+            std::vector<IROp> scheduled = listSchedule(body);
+            int old_cycles = bodyCycles(body), new_cycles = bodyCycles(scheduled);
+            before += executions * old_cycles;
+            if (new_cycles < old_cycles) {
+                std::copy(scheduled.begin(), scheduled.end(), ir.begin() + a);
+                std::cout << "PE " << assignment.pe_id << ": loop L" << hwl->loop_id << " body scheduled, "
+                          << old_cycles << " -> " << new_cycles << " cycles per iteration" << std::endl;
+            }
+            after += executions * std::min(old_cycles, new_cycles);
+        }
+        if (before > 0) {
+            std::cout << "PE " << assignment.pe_id << ": innermost loop bodies take an estimated " << before 
+                      << " cycles, " << after << " after scheduling (load latency " << load_latency << ")" << std::endl;
+        }
+    }
+
+    // Replace the body [a, b) of hwl by before, body and after. Loops that
+    // ended with the old body end with the last instruction of after, loops
+    // behind it move.
+    void replaceLoopBody(PEAssignment& assignment, HardwareLoop& hwl, size_t a, size_t b,
+                         const std::vector<IROp>& before, const std::vector<IROp>& body,
+                         const std::vector<IROp>& after) {
+        auto& ir = assignment.ir;
+        int old_stop = hwl.pc_stop, old_end = wordPcs(ir)[b];
+        std::vector<IROp> region(before);
+        region.insert(region.end(), body.begin(), body.end());
+        region.insert(region.end(), after.begin(), after.end());
+        ir.erase(ir.begin() + a, ir.begin() + b);
+        ir.insert(ir.begin() + a, region.begin(), region.end());
+
+        std::vector<int> pcs = wordPcs(ir);
+        int grow = pcs[a + region.size()] - old_end;
+        for (HardwareLoop* loop : programLoops(assignment)) {
+            if (loop == &hwl) continue;
+            if (loop->pc_start >= old_end) loop->pc_start += grow;
+            if (loop->pc_stop == old_stop) {
+                loop->pc_stop = pcs[a + region.size() - 1];
+            } else if (loop->pc_stop >= old_end) {
+                loop->pc_stop += grow;
+            }
+        }
+        hwl.pc_start = pcs[a + before.size()];
+        hwl.pc_stop = pcs[a + before.size() + body.size() - 1];
+    }
+
+    // Fuse mul t, a, b and a later add r, r, t of an innermost loop body into
+    // mac.fxp r, a, b at the place of the add. mac.fxp adds the same Q16.16
+    // product as mul. The product register t must be written before it is
+    // read in the body, the add must be its only reader, and no code outside
+    // the body may read it. a and b must keep their value up to the add.
+    int fuseMultiplyAccumulates(PEAssignment& assignment, HardwareLoop& hwl) {
+        size_t a, b;
+        if (!fuse_mac || !innermostBody(assignment, hwl, a, b)) return 0;
+        const auto& ir = assignment.ir;
+        std::vector<IROp> body(ir.begin() + a, ir.begin() + b);
+        auto reads = [](const IROp& op, int8_t reg) {
+            std::vector<int8_t> regs = readRegisters(op);
+            return std::find(regs.begin(), regs.end(), reg) != regs.end();
+        };
+        auto readOutside = [&](int8_t reg) {
+            for (size_t i = 0; i < ir.size(); i++) {
+                if ((i < a || i >= b) && reads(ir[i], reg)) return true;
+            }
+            for (const auto& section : assignment.outlined) {
+                for (const IROp& op : section.second) {
+                    if (reads(op, reg)) return true;
+                }
+            }
+            return false;
+        };
+
+        int old_cycles = bodyCycles(body);
+        int fused = 0;
+        for (size_t i = 0; i < body.size(); i++) {
+            const IROp& mul = body[i];
+            int8_t t = writtenRegister(mul);
+            if (mul.op != Opcode::MUL || t == NO_REG || readOutside(t)) continue;
+            // t is not carried: its first reference in the body is a write
+            auto first = std::find_if(body.begin(), body.end(), [&](const IROp& op) {
+                return reads(op, t) || writtenRegister(op) == t;
+            });
+            if (reads(*first, t)) continue;
+
+            // The only reader of the product, before t, a or b change again
+            size_t add = body.size();
+            bool other = false;
+            for (size_t j = i + 1; j < body.size() && !other; j++) {
+                if (reads(body[j], t)) {
+                    const IROp& op = body[j];
+                    bool accumulates = op.op == Opcode::ADD && op.rd != t && 
+                                       ((op.rs1 == op.rd && op.rs2 == t) || (op.rs2 == op.rd && op.rs1 == t));
+                    if (add == body.size() && accumulates) {
+                        add = j;
+                    } else {
+                        other = true;
+                    }
+                }
+                int8_t w = writtenRegister(body[j]);
+                if (w != NO_REG && (w == t || w == mul.rs1 || w == mul.rs2)) break;
+            }
+            if (other || add == body.size()) continue;
+            // Nothing behind the add may see the product in t either
+            bool later = false;
+            for (size_t j = add + 1; j < body.size(); j++) {
+                if (reads(body[j], t)) { later = true; break; }
+                if (writtenRegister(body[j]) == t) break;
+            }
+            if (later) continue;
+
+            IROp mac = body[add];
+            mac.op = Opcode::MAC_FXP;
+            mac.rs1 = mul.rs1;
+            mac.rs2 = mul.rs2;
+            body[add] = mac;
+            body.erase(body.begin() + i);
+            i--;
+            fused++;
+        }
+        if (fused == 0) return 0;
+
+        int new_cycles = bodyCycles(body);
+        replaceLoopBody(assignment, hwl, a, b, {}, body, {});
+        std::cout << "PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " fused " << fused 
+                  << " mul/add pairs into mac.fxp, " << old_cycles << " -> " << new_cycles 
+                  << " cycles per iteration" << std::endl;
+        return fused;
+    }
+
+    // Arrays in packed_int8 hold int8 values four to a word, byte 0 first,
+    // while the YAML addresses them one value per word: coefficients step 4
+    // bytes per value. An innermost loop whose body only loads such values
+    // with psrf.lw, one value further per iteration, and multiplies them
+    // into mac or mac.fxp accumulators runs a quarter of its iterations with
+    // dot4: every load reads the next four values and the coefficients of
+    // the other loops shrink to bytes. dot4 adds integer products, like mul
+    // on the build the int8 kernels run on. Any other access to a packed
+    // array throws, it would read four values as one.
+    int packInt8Products(PEAssignment& assignment, HardwareLoop& hwl, std::set<uint16_t>& packed) {
+        size_t a, b;
+        if (packed_int8.empty() || !innermostBody(assignment, hwl, a, b)) return 0;
+        auto& ir = assignment.ir;
+        auto isPacked = [&](const IROp& op) {
+            return (opInfo(op.op).flags & (OP_LOAD | OP_STORE)) && packed_int8.count(op.base);
+        };
+        if (std::none_of(ir.begin() + a, ir.begin() + b, isPacked)) return 0;
+        std::string where = "PE " + std::to_string(assignment.pe_id) + ": loop L" + std::to_string(hwl.loop_id);
+        auto fail = [&](const std::string& why) {
+            throw std::runtime_error(where + " reads packed int8 values, but " + why);
+        };
+        if (hwl.iterations % 4 != 0) fail("its count " + std::to_string(hwl.iterations) + " is no multiple of 4");
+
+        // Loads first, then the products of values loaded in this iteration
+        std::set<int8_t> values;
+        int products = 0;
+        for (size_t i = a; i < b; i++) {
+            const IROp& op = ir[i];
+            if (!isPacked(op)) {
+                bool product = (op.op == Opcode::MAC || op.op == Opcode::MAC_FXP) && values.count(op.rs1) &&
+                               values.count(op.rs2) && !values.count(op.rd);
+                if (!product) fail("its body does more than multiply-accumulate them");
+                products++;
+                continue;
+            }
+            if (op.op != Opcode::PSRF_LW || op.offs != 0) fail("not every access is a psrf.lw");
+            const Instruction& instr = assignment.instructions[op.src];
+            std::map<int, int> terms = addressTerms(instr);
+            if (terms[hwl.hwl_index] != 4) fail("a load doesn't step one value per iteration");
+            for (const auto& [tag, coef] : terms) {
+                if (tag != hwl.hwl_index && coef % 16 != 0) fail("a load of an outer loop isn't word aligned");
+            }
+            for (const auto& [var_key, tag] : instr.psrf_var) {
+                auto coef = instr.coefficients.find("c" + var_key.substr(1));
+                if (tag != 0 && coef != instr.coefficients.end() && coef->second % 4 != 0) {
+                    fail("a coefficient isn't a multiple of 4");
+                }
+            }
+            if (values.count(op.rd) || op.rd == 0 || op.rd == NO_REG) fail("a value register is loaded twice");
+            values.insert(op.rd);
+        }
+
+        // The values and the loop's tag mean nothing outside the body
+        auto outside = [&](const IROp& op) {
+            std::vector<int8_t> reads = readRegisters(op);
+            if (std::any_of(reads.begin(), reads.end(), [&](int8_t reg) { return values.count(reg) != 0; })) {
+                return true;
+            }
+            return opInfo(op.op).cls == OpClass::PsrfMem &&
+                   addressTerms(assignment.instructions[op.src]).count(hwl.hwl_index) != 0;
+        };
+        for (size_t i = 0; i < ir.size(); i++) {
+            if ((i < a || i >= b) && outside(ir[i])) fail("code outside the loop depends on them");
+        }
+        for (const auto& section : assignment.outlined) {
+            if (std::any_of(section.second.begin(), section.second.end(), outside)) {
+                fail("code outside the loop depends on them");
+            }
+        }
+
+        for (size_t i = a; i < b; i++) {
+            IROp& op = ir[i];
+            if (!isPacked(op)) {
+                op.op = Opcode::DOT4;
+                continue;
+            }
+            // The loop's own term stays 4 bytes: a quarter per value, four values per iteration
+            Instruction& instr = assignment.instructions[op.src];
+            for (const auto& [var_key, tag] : instr.psrf_var) {
+                auto coef = instr.coefficients.find("c" + var_key.substr(1));
+                if (tag != 0 && tag != hwl.hwl_index && coef != instr.coefficients.end()) coef->second /= 4;
+            }
+            packed.insert(op.src);
+        }
+        std::cout << "PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " packs " << products 
+                  << " int8 products into dot4, " << hwl.iterations << " -> " << hwl.iterations / 4 
+                  << " iterations" << std::endl;
+        hwl.iterations /= 4;
+        return products;
+    }
+
+    // Loads from an address that doesn't move with an innermost loop run
+    // once in front of its body. A store of the loaded register back to the
+    // same address runs once behind it, and the register carries the value
+    // across iterations (the accumulator of gemm). Accesses through
+    // different base registers are taken to be different arrays, which the
+    // code can't check, so hoist_invariants has to switch the pass on.
+    int hoistInvariantAccesses(PEAssignment& assignment, HardwareLoop& hwl) {
+        size_t a, b;
+        if (!hoist_invariants || hwl.iterations < 1 || !innermostBody(assignment, hwl, a, b)) return 0;
+        std::vector<IROp> body(assignment.ir.begin() + a, assignment.ir.begin() + b);
+        auto references = [](const IROp& op, int8_t reg) {
+            std::vector<int8_t> reads = readRegisters(op);
+            return writtenRegister(op) == reg || std::find(reads.begin(), reads.end(), reg) != reads.end();
+        };
+        auto writtenIn = [&](int8_t reg) {
+            return std::any_of(body.begin(), body.end(), [&](const IROp& op) { return writtenRegister(op) == reg; });
+        };
+        auto sameAddress = [&](const IROp& load, const IROp& store) {
+            bool words = (load.op == Opcode::LW && store.op == Opcode::SW) ||
+                         (load.op == Opcode::PSRF_LW && store.op == Opcode::PSRF_SW);
+            if (!words || load.base != store.base || load.var != store.var) return false;
+            return load.op == Opcode::LW ? load.imm == store.imm :
+                addressTerms(assignment.instructions[load.src]) == addressTerms(assignment.instructions[store.src]);
+        };
+
+        std::set<size_t> hoisted, sunk;
+        for (size_t i = 0; i < body.size(); i++) {
+            const IROp& load = body[i];
+            int8_t reg = load.rd;
+            bool movable = (load.op == Opcode::LW || load.op == Opcode::LB || load.op == Opcode::LBU ||
+                            load.op == Opcode::LH || load.op == Opcode::LHU || load.op == Opcode::PSRF_LW ||
+                            load.op == Opcode::PSRF_LB) && load.offs == 0;
+            if (!movable || reg == NO_REG || reg == 0 || reg == load.base || writtenIn(load.base)) continue;
+            if (opInfo(load.op).cls == OpClass::PsrfMem &&
+                addressTerms(assignment.instructions[load.src]).count(hwl.hwl_index)) continue;
+            if (std::any_of(body.begin(), body.begin() + i, [&](const IROp& op) { return references(op, reg); })) continue;
+
+            // The only other access to the array may be the store back
+            size_t store = body.size();
+            bool shared = false;
+            for (size_t j = 0; j < body.size(); j++) {
+                if (j == i || body[j].base != load.base || !(opInfo(body[j].op).flags & (OP_LOAD | OP_STORE))) continue;
+                if (store == body.size() && j > i && body[j].rs2 == reg && sameAddress(load, body[j])) {
+                    store = j;
+                } else {
+                    shared = true;
+                }
+            }
+            if (shared) continue;
+            if (store == body.size()) {
+                if (std::count_if(body.begin(), body.end(), [&](const IROp& op) { return writtenRegister(op) == reg; }) > 1) {
+                    continue;
+                }
+            } else if (std::any_of(body.begin() + store + 1, body.end(), [&](const IROp& op) { return references(op, reg); })) {
+                continue;
+            }
+            hoisted.insert(i);
+            if (store < body.size()) sunk.insert(store);
+        }
+        if (hoisted.empty() || hoisted.size() + sunk.size() == body.size()) return 0;
+
+        std::vector<IROp> before, rest, after;
+        for (size_t i = 0; i < body.size(); i++) {
+            (hoisted.count(i) ? before : sunk.count(i) ? after : rest).push_back(body[i]);
+        }
+        int old_cycles = bodyCycles(body), new_cycles = bodyCycles(rest);
+        replaceLoopBody(assignment, hwl, a, b, before, rest, after);
+        std::cout << "PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " moved " << before.size() + after.size()
+                  << " invariant accesses out of its body, " << old_cycles << " -> " << new_cycles 
+                  << " cycles per iteration" << std::endl;
+        return int(before.size() + after.size());
+    }
+
+    // AGU offset register holding value, taking a new one when none does.
+    // offs.addi ORs a 12-bit immediate into a cleared register, o0 stays 0.
+    // NO_REG when the value doesn't fit or all registers are taken.
+    static int8_t offsetRegister(std::map<int, int>& offsets, int value) {
+        if (value == 0) return 0;
+        if (value < 0 || value > 0xFFF) return NO_REG;
+        for (const auto& [reg, held] : offsets) {
+            if (held == value) return static_cast<int8_t>(reg);
+        }
+        int next = 1;
+        while (offsets.count(next)) next++;
+        if (next > 15) return NO_REG;
+        offsets[next] = value;
+        return static_cast<int8_t>(next);
+    }
+
+    // Unroll an innermost loop U times. Copy k of a psrf load reads k
+    // iterations ahead through an AGU offset register and the coefficients
+    // of the loop's tag grow U-fold. Registers that are written before they
+    // are read get a new virtual register in every copy but the last. A
+    // register only carried by an add r, r, s or a mac r, a, b becomes U
+    // partial sums, cleared in front of the loop and added up behind it.
+    // Other carried registers stay chained through the copies. The first
+    // N mod U iterations run in front of the loop. unroll_factor sets U,
+    // otherwise the divisor of N up to 8 with the fewest estimated cycles
+    // is taken if it saves any. With U and N mod U even, a load of a
+    // paired_loads array that steps one word per iteration from 8-byte
+    // aligned addresses writes a register pair in copies 2m and 2m + 1,
+    // which pairWordLoads makes one psrf.ld2 once the pair is allocated.
+    // An add behind the loop copies the last value back if code outside
+    // may read it. A factor set in the YAML that can't be applied is
+    // reported with the reason.
+    bool unrollLoop(PEAssignment& assignment, HardwareLoop& hwl) {
+        size_t a, b;
+        if (unroll_factor == 1 || !innermostBody(assignment, hwl, a, b)) return false;
+        auto skip = [&](const std::string& reason) {
+            if (unroll_factor > 1) {
+                std::cerr << "Warning: PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " is not unrolled " 
+                          << unroll_factor << " times, " << reason << std::endl;
+            }
+            return false;
+        };
+        if (hwl.iterations < 4) return skip("it runs fewer than 4 iterations");
+        const auto& ir = assignment.ir;
+        std::vector<IROp> body(ir.begin() + a, ir.begin() + b);
+
+        // Only loads can read ahead, and no access outside the loop may
+        // share a var group with the ones that move with it
+        std::vector<int> steps(body.size(), 0);
+        std::set<int8_t> vars;
+        std::set<uint16_t> scaled;
+        for (size_t i = 0; i < body.size(); i++) {
+            if (opInfo(body[i].op).cls != OpClass::PsrfMem) continue;
+            std::map<int, int> terms = addressTerms(assignment.instructions[body[i].src]);
+            if (!terms.count(hwl.hwl_index)) continue;
+            if (!(opInfo(body[i].op).flags & OP_LOAD)) return skip("it stores through its own PSRF tag");
+            if (body[i].offs != 0) return skip("a psrf load already reads through an offset register");
+            steps[i] = terms[hwl.hwl_index];
+            vars.insert(body[i].var);
+            scaled.insert(body[i].src);
+        }
+        for (size_t i = 0; i < ir.size(); i++) {
+            if ((i < a || i >= b) && opInfo(ir[i].op).cls == OpClass::PsrfMem && vars.count(ir[i].var)) {
+                return skip("code outside of it shares a var group with its psrf loads");
+            }
+        }
+
+        // Registers written in the body, and whether an iteration reads the
+        // value of the one before
+        std::map<int8_t, bool> carried;
+        for (const IROp& op : body) {
+            std::map<int8_t, bool> first;
+            for (int8_t reg : readRegisters(op)) first.emplace(reg, true);
+            if (writtenRegister(op) != NO_REG) first.emplace(writtenRegister(op), false);
+            for (const auto& [reg, read] : first) carried.emplace(reg, read);
+        }
+        std::set<int8_t> written, sums;
+        for (const IROp& op : body) {
+            if (writtenRegister(op) != NO_REG) written.insert(writtenRegister(op));
+        }
+        for (int8_t reg : written) {
+            if (!carried[reg]) continue;
+            std::vector<const IROp*> uses;
+            for (const IROp& op : body) {
+                std::vector<int8_t> reads = readRegisters(op);
+                if (writtenRegister(op) == reg || std::find(reads.begin(), reads.end(), reg) != reads.end()) {
+                    uses.push_back(&op);
+                }
+            }
+            if (uses.size() != 1) continue;
+            const IROp& use = *uses[0];
+            bool add = use.op == Opcode::ADD && (use.rs1 == reg) != (use.rs2 == reg);
+            bool mac = (opInfo(use.op).flags & OP_READS_RD) && use.rs1 != reg && use.rs2 != reg;
+            if (add || mac) sums.insert(reg);
+        }
+
+        // Registers of the loads that can be paired, and whether code
+        // outside the body reads them
+        std::set<int8_t> paired, read_outside;
+        for (size_t i = 0; i < body.size(); i++) {
+            const IROp& op = body[i];
+            if (op.op != Opcode::PSRF_LW || !paired_loads.count(op.base) || steps[i] != 4 || carried[op.rd]) continue;
+            std::map<int, int> terms = addressTerms(assignment.instructions[op.src]);
+            if (std::all_of(terms.begin(), terms.end(), [&](const std::pair<const int, int>& term) {
+                    return term.first == hwl.hwl_index || term.second % 8 == 0;
+                })) {
+                paired.insert(op.rd);
+            }
+        }
+        auto readsPaired = [&](const IROp& op) {
+            if (opInfo(op.op).cls == OpClass::JType) read_outside.insert(paired.begin(), paired.end());
+            for (int8_t reg : readRegisters(op)) {
+                if (paired.count(reg)) read_outside.insert(reg);
+            }
+        };
+        std::for_each(ir.begin(), ir.begin() + a, readsPaired);
+        std::for_each(ir.begin() + b, ir.end(), readsPaired);
+        for (const auto& section : assignment.outlined) {
+            std::for_each(section.second.begin(), section.second.end(), readsPaired);
+        }
+
+        int next_virtual = kFirstVirtualReg;
+        auto seen = [&](const IROp& op) {
+            for (int8_t reg : {op.rd, op.rs1, op.rs2, op.base}) next_virtual = std::max<int>(next_virtual, reg + 1);
+        };
+        std::for_each(ir.begin(), ir.end(), seen);
+        for (const auto& section : assignment.outlined) {
+            std::for_each(section.second.begin(), section.second.end(), seen);
+        }
+        auto name = [](int8_t reg) {
+            return reg >= kFirstVirtualReg ? "vr" + std::to_string(reg - kFirstVirtualReg) : "x" + std::to_string(reg);
+        };
+
+        struct Unrolled {
+            int factor = 0;
+            long long cycles = 0;
+            std::vector<IROp> before, kernel, after;
+            std::vector<Instruction> added;  // Records of the partial sum code
+            std::map<int, int> offsets;
+            std::vector<std::pair<int8_t, int8_t>> pairs;  // Register pairs of the paired loads
+        };
+        // Why the last build failed
+        std::string failure;
+        auto fail = [&](const std::string& reason) {
+            failure = reason;
+            return false;
+        };
+        auto build = [&](int factor, Unrolled& out) {
+            int count = hwl.iterations / factor, rest = hwl.iterations % factor;
+            if (count < 2) return fail("fewer than 2 iterations would be left");
+            if (count > kMaxHwlIterations) return fail("the loop count doesn't fit the 12-bit field");
+            out = Unrolled();
+            out.factor = factor;
+            out.offsets = assignment.psrf_offsets;
+            int fresh = next_virtual;
+            auto add = [&](std::vector<IROp>& code, const Instruction& instr) {
+                code.push_back(lowerInstruction(instr, assignment.instructions.size() + out.added.size()));
+                out.added.push_back(instr);
+            };
+
+            // Remainder iterations and the partial sums in front of the loop
+            for (int j = 0; j < rest; j++) {
+                for (size_t i = 0; i < body.size(); i++) {
+                    IROp op = body[i];
+                    if (steps[i] != 0 && (op.offs = offsetRegister(out.offsets, j * steps[i])) == NO_REG) {
+                        return fail("the read-ahead offsets don't fit the AGU offset registers");
+                    }
+                    out.before.push_back(op);
+                }
+            }
+            std::map<int8_t, std::vector<int8_t>> partial;
+            for (int8_t reg : sums) {
+                partial[reg].push_back(reg);
+                for (int k = 1; k < factor; k++) {
+                    if (fresh >= kFirstVirtualReg + kMaxVirtualRegs) return fail("it runs out of virtual registers");
+                    int8_t sum = static_cast<int8_t>(fresh++);
+                    partial[reg].push_back(sum);
+                    Instruction clear;
+                    clear.operation = "ADDI";
+                    clear.format = "i-type";
+                    clear.rd = name(sum);
+                    clear.ra1 = "x0";
+                    clear.ra2 = "null";
+                    add(out.before, clear);
+                }
+            }
+
+            std::map<int8_t, std::vector<std::pair<int8_t, int8_t>>> pairs;
+            if (factor % 2 == 0 && rest % 2 == 0) {
+                for (int8_t reg : paired) {
+                    for (int m = 0; m < factor / 2; m++) {
+                        if (fresh + 1 >= kFirstVirtualReg + kMaxVirtualRegs) return fail("it runs out of virtual registers");
+                        pairs[reg].emplace_back(static_cast<int8_t>(fresh), static_cast<int8_t>(fresh + 1));
+                        out.pairs.push_back(pairs[reg].back());
+                        fresh += 2;
+                    }
+                }
+            }
+
+            for (int k = 0; k < factor; k++) {
+                std::map<int8_t, int8_t> rename;
+                for (int8_t reg : written) {
+                    if (k + 1 < factor && !carried[reg] && !pairs.count(reg)) {
+                        if (fresh >= kFirstVirtualReg + kMaxVirtualRegs) return fail("it runs out of virtual registers");
+                        rename[reg] = static_cast<int8_t>(fresh++);
+                    }
+                }
+                for (const auto& [reg, regs] : partial) rename[reg] = regs[k];
+                for (const auto& [reg, regs] : pairs) rename[reg] = k % 2 ? regs[k / 2].second : regs[k / 2].first;
+                for (size_t i = 0; i < body.size(); i++) {
+                    IROp op = body[i];
+                    for (int8_t* reg : {&op.rd, &op.rs1, &op.rs2, &op.base}) {
+                        auto it = rename.find(*reg);
+                        if (it != rename.end()) *reg = it->second;
+                    }
+                    if (steps[i] != 0 && (op.offs = offsetRegister(out.offsets, (rest + k) * steps[i])) == NO_REG) {
+                        return fail("the read-ahead offsets don't fit the AGU offset registers");
+                    }
+                    out.kernel.push_back(op);
+                }
+            }
+            for (const auto& [reg, regs] : partial) {
+                for (int k = 1; k < factor; k++) {
+                    Instruction sum;
+                    sum.operation = "ADD";
+                    sum.format = "r-type";
+                    sum.rd = sum.ra1 = name(reg);
+                    sum.ra2 = name(regs[k]);
+                    add(out.after, sum);
+                }
+            }
+            for (const auto& [reg, regs] : pairs) {
+                if (!read_outside.count(reg)) continue;
+                Instruction copy;
+                copy.operation = "ADD";
+                copy.format = "r-type";
+                copy.rd = name(reg);
+                copy.ra1 = name(regs.back().second);
+                copy.ra2 = "x0";
+                add(out.after, copy);
+            }
+
+            int words = wordPcs(out.kernel).back();
+            int grow = wordPcs(out.before).back() + wordPcs(out.after).back() + words - wordPcs(body).back();
+            if (words - 1 > kMaxHwlLength) return fail("the body would exceed the 6-bit body length");
+            for (const HardwareLoop* loop : programLoops(assignment)) {
+                if (loop != &hwl && loop->pc_start <= hwl.pc_start && hwl.pc_stop <= loop->pc_stop &&
+                    loop->pc_stop - loop->pc_start + grow > kMaxHwlLength) {
+                    return fail("enclosing loop L" + std::to_string(loop->loop_id) + " would exceed the 6-bit body length");
+                }
+            }
+            // The kernel is estimated as if its pairs were psrf.ld2 already
+            std::set<int8_t> highs;
+            for (const auto& pair : out.pairs) highs.insert(pair.second);
+            std::vector<IROp> estimate;
+            std::copy_if(out.kernel.begin(), out.kernel.end(), std::back_inserter(estimate), [&](const IROp& op) {
+                return op.op != Opcode::PSRF_LW || !highs.count(op.rd);
+            });
+            out.cycles = count * (long long)bodyCycles(listSchedule(estimate)) + runCycles(out.before) + 
+                         runCycles(out.after);
+            return true;
+        };
+
+        long long before = hwl.iterations * (long long)bodyCycles(listSchedule(body));
+        Unrolled best, candidate;
+        if (unroll_factor > 1) {
+            if (!build(unroll_factor, best)) return skip(failure);
+        } else {
+            for (int factor = 2; factor <= 8; factor++) {
+                if (hwl.iterations % factor == 0 && build(factor, candidate) && candidate.cycles < before &&
+                    (best.factor == 0 || candidate.cycles < best.cycles)) {
+                    best = candidate;
+                }
+            }
+            if (best.factor == 0) return false;
+        }
+
+        for (uint16_t src : scaled) {
+            Instruction& instr = assignment.instructions[src];
+            for (const auto& [var_key, tag] : instr.psrf_var) {
+                auto coef = instr.coefficients.find("c" + var_key.substr(1));
+                if (tag == hwl.hwl_index && coef != instr.coefficients.end()) coef->second *= best.factor;
+            }
+        }
+        assignment.psrf_offsets = best.offsets;
+        assignment.register_pairs.insert(assignment.register_pairs.end(), best.pairs.begin(), best.pairs.end());
+        replaceLoopBody(assignment, hwl, a, b, best.before, best.kernel, best.after);
+        hwl.iterations /= best.factor;
+        std::cout << "PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " unrolled " << best.factor 
+                  << " times, an estimated " << before << " -> " 
+                  << best.cycles << " cycles per loop" << std::endl;
+        // Last, the records may move the loops
+        assignment.instructions.insert(assignment.instructions.end(), best.added.begin(), best.added.end());
+        return true;
+    }
+
+    // Two-stage software pipelining of an innermost loop: stage 0 is the
+    // run of loads at the head of the body, stage 1 the rest. The prologue
+    // loads for iteration 0, each of the N - 1 kernel iterations computes
+    // iteration i and then loads for i + 1, and the epilogue computes
+    // iteration N - 1. The instruction stream stays the same. Only the psrf
+    // loads of the kernel run before their PSRF registers advance, so they
+    // read one iteration ahead through an AGU offset register. Applied when
+    // the latency model estimates fewer cycles for the whole loop.
+    bool pipelineLoop(PEAssignment& assignment, HardwareLoop& hwl) {
+        size_t a, b;
+        // The kernel keeps at least two iterations, a count of one would
+        // start the loop at the level drop of its last iteration
+        if (hwl.iterations < 3 || !innermostBody(assignment, hwl, a, b)) return false;
+        std::vector<IROp> body(assignment.ir.begin() + a, assignment.ir.begin() + b);
+        size_t loads = 0;
+        while (loads < body.size() && (opInfo(body[loads].op).flags & OP_LOAD) && 
+               body[loads].op != Opcode::PSRF_ZD_LW && body[loads].offs == 0) {
+            loads++;
+        }
+        if (loads == 0 || loads == body.size()) return false;
+
+        // Stage 1 runs once behind the loop, where the PSRF registers of
+        // the loop no longer hold iteration N - 1
+        for (size_t i = loads; i < body.size(); i++) {
+            if (opInfo(body[i].op).cls == OpClass::PsrfMem &&
+                addressTerms(assignment.instructions[body[i].src]).count(hwl.hwl_index)) return false;
+        }
+
+        std::map<int, int> offsets = assignment.psrf_offsets;
+        std::vector<IROp> stage0(body.begin(), body.begin() + loads), stage1(body.begin() + loads, body.end());
+        std::vector<IROp> kernel(stage1);
+        for (IROp op : stage0) {
+            if (opInfo(op.op).cls == OpClass::PsrfMem) {
+                std::map<int, int> terms = addressTerms(assignment.instructions[op.src]);
+                op.offs = offsetRegister(offsets, terms.count(hwl.hwl_index) ? terms[hwl.hwl_index] : 0);
+                if (op.offs == NO_REG) return false;
+            }
+            kernel.push_back(op);
+        }
+
+        int words = wordPcs(body).back();
+        std::vector<HardwareLoop*> loops = programLoops(assignment);
+        for (const HardwareLoop* loop : loops) {
+            if (loop != &hwl && loop->pc_start <= hwl.pc_start && hwl.pc_stop <= loop->pc_stop &&
+                loop->pc_stop - loop->pc_start + words > kMaxHwlLength) return false;
+        }
+        long long count = hwl.iterations;
+        long long before = count * bodyCycles(listSchedule(body));
+        long long after = (count - 1) * bodyCycles(listSchedule(kernel)) + runCycles(stage0) + runCycles(stage1);
+        if (after >= before) return false;
+
+        assignment.psrf_offsets = offsets;
+        replaceLoopBody(assignment, hwl, a, b, stage0, kernel, stage1);
+        hwl.iterations--;
+        std::cout << "PE " << assignment.pe_id << ": loop L" << hwl.loop_id << " software pipelined, an estimated "
+                  << before << " -> " << after << " cycles per loop" << std::endl;
+        return true;
+    }
+
+    void pipelineInnerLoops(PEAssignment& assignment) {
+        // Unrolling adds instruction records, so loops are looked up again
+        std::set<uint16_t> packed;
+        for (size_t l = 0; l < programLoops(assignment).size(); l++) {
+            fuseMultiplyAccumulates(assignment, *programLoops(assignment)[l]);
+            hoistInvariantAccesses(assignment, *programLoops(assignment)[l]);
+            packInt8Products(assignment, *programLoops(assignment)[l], packed);
+            unrollLoop(assignment, *programLoops(assignment)[l]);
+            pipelineLoop(assignment, *programLoops(assignment)[l]);
+        }
+
+        if (packed_int8.empty()) return;
+        auto unpacked = [&](const IROp& op) {
+            return (opInfo(op.op).flags & (OP_LOAD | OP_STORE)) && packed_int8.count(op.base) && 
+                   !(op.op == Opcode::PSRF_LW && packed.count(op.src));
+        };
+        std::vector<int> pcs = wordPcs(assignment.ir);
+        for (size_t i = 0; i < assignment.ir.size(); i++) {
+            if (unpacked(assignment.ir[i])) {
+                throw std::runtime_error("PE " + std::to_string(assignment.pe_id) + ": access at exec pc " +
+                    std::to_string(pcs[i]) + " to the packed int8 array of x" + 
+                    std::to_string(assignment.ir[i].base) + " doesn't feed dot4");
+            }
+        }
+        for (const auto& section : assignment.outlined) {
+            if (std::any_of(section.second.begin(), section.second.end(), unpacked)) {
+                throw std::runtime_error("PE " + std::to_string(assignment.pe_id) + ": code moved to " + 
+                    section.first + " accesses a packed int8 array");
+            }
+        }
+    }
+
+    // Once registers are allocated, two psrf.lw of an innermost loop body
+    // become one psrf.ld2 when they read neighbouring words of a
+    // paired_loads array, the lower one 8-byte aligned, into an even
+    // register and the one above it (see unrollLoop). The later load moves
+    // up to the earlier one, so no instruction between them may touch its
+    // register or store.
+    int pairWordLoads(PEAssignment& assignment) {
+        if (paired_loads.empty()) return 0;
+        auto offset = [&](int8_t reg) {
+            auto it = assignment.psrf_offsets.find(reg);
+            return reg == 0 ? 0 : it != assignment.psrf_offsets.end() ? it->second : -1;
+        };
+        auto references = [](const IROp& op, int8_t reg) {
+            std::vector<int8_t> reads = readRegisters(op);
+            return writtenRegister(op) == reg || std::find(reads.begin(), reads.end(), reg) != reads.end();
+        };
+        int total = 0;
+        for (HardwareLoop* hwl : programLoops(assignment)) {
+            size_t a, b;
+            if (!innermostBody(assignment, *hwl, a, b)) continue;
+            std::vector<IROp> body(assignment.ir.begin() + a, assignment.ir.begin() + b);
+            int pairs = 0;
+            for (size_t i = 0; i < body.size(); i++) {
+                const IROp& first = body[i];
+                if (first.op != Opcode::PSRF_LW || !paired_loads.count(first.base) || offset(first.offs) < 0) continue;
+                std::map<int, int> terms = addressTerms(assignment.instructions[first.src]);
+                if (std::any_of(terms.begin(), terms.end(), [](const std::pair<const int, int>& term) {
+                        return term.second % 8 != 0;
+                    })) continue;
+                for (size_t j = i + 1; j < body.size(); j++) {
+                    const IROp& second = body[j];
+                    if (second.op == Opcode::PSRF_LW && second.src == first.src && second.base == first.base &&
+                        std::abs(offset(second.offs) - offset(first.offs)) == 4) {
+                        const IROp& low = offset(first.offs) < offset(second.offs) ? first : second;
+                        const IROp& high = &low == &first ? second : first;
+                        bool moves = std::none_of(body.begin() + i + 1, body.begin() + j, [&](const IROp& op) {
+                            return references(op, second.rd) || (opInfo(op.op).flags & OP_STORE);
+                        });
+                        if (moves && offset(low.offs) % 8 == 0 && low.rd != 0 && low.rd % 2 == 0 && 
+                            high.rd == low.rd + 1) {
+                            IROp pair = low;
+                            pair.op = Opcode::PSRF_LD2;
+                            body[i] = pair;
+                            body.erase(body.begin() + j);
+                            pairs++;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (pairs == 0) continue;
+            replaceLoopBody(assignment, *hwl, a, b, {}, body, {});
+            std::cout << "PE " << assignment.pe_id << ": loop L" << hwl->loop_id << " reads " << pairs 
+                      << " word pairs with psrf.ld2" << std::endl;
+            total += pairs;
+        }
+        return total;
+    }
+
+    // Registers a virtual register may not take: x0, the base registers,
+    // the x26 return link, the tiling registers and the physical registers
+    // the program names itself
+    std::set<int8_t> reservedRegisters(const PEAssignment& assignment) {
+        std::set<int8_t> reserved = {0, 26};
+        for (const auto& reg : baseRegisters()) {
+            reserved.insert(parseRegister(reg));
+        }
+        if (tiling.enabled) {
+            reserved.insert(parseRegister(tiling.swap_register));
+            reserved.insert(parseRegister(tiling.advance_register));
+        }
+        auto named = [&](const IROp& op) {
+            for (int8_t reg : {op.rd, op.rs1, op.rs2, op.base}) {
+                if (reg != NO_REG && reg < kFirstVirtualReg) reserved.insert(reg);
+            }
+        };
+        std::for_each(assignment.ir.begin(), assignment.ir.end(), named);
+        for (const auto& section : assignment.outlined) {
+            std::for_each(section.second.begin(), section.second.end(), named);
+        }
+        return reserved;
+    }
+
+    // Linear-scan allocation of the virtual registers of a program. A live
+    // interval runs from the first to the last reference in IR order, code
+    // outlined from a loop body counts at its jal. An interval that reaches
+    // into or out of a loop, or whose value is carried to the next
+    // iteration, covers the whole loop. When the free registers run out, the
+    // two highest (three with mac accumulators) become scratch registers and
+    // the lightest intervals live in word slots from spill_register on. Returns true when spill
+    // code was inserted.
+    bool allocateRegisters(PEAssignment& assignment, const std::set<int8_t>& also, const std::string& where) {
+        auto& ir = assignment.ir;
+        auto isVirtual = [](int8_t reg) { return reg >= kFirstVirtualReg; };
+        std::map<std::string, const std::vector<IROp>*> outlined;
+        for (const auto& [label, code] : assignment.outlined) {
+            outlined[label] = &code;
+        }
+
+        // Instructions run at every IR index and the virtual registers they
+        // read and write, in order
+        std::vector<std::vector<std::pair<std::vector<int8_t>, int8_t>>> refs(ir.size());
+        std::map<int8_t, std::pair<size_t, size_t>> live;
+        bool branches = false;
+        for (size_t i = 0; i < ir.size(); i++) {
+            std::vector<const IROp*> run = {&ir[i]};
+            auto section = outlined.find(assignment.instructions[ir[i].src].label);
+            if (section != outlined.end()) {
+                for (const IROp& op : *section->second) run.push_back(&op);
+            }
+            for (const IROp* op : run) {
+                branches = branches || opInfo(op->op).cls == OpClass::BType;
+                if (isVirtual(op->base)) {
+                    throw std::runtime_error(where + ": base register vr" + std::to_string(op->base - kFirstVirtualReg) +
+                                             " must be a physical register from mem_config");
+                }
+                std::vector<int8_t> reads;
+                for (int8_t reg : readRegisters(*op)) {
+                    if (isVirtual(reg)) reads.push_back(reg);
+                }
+                int8_t write = isVirtual(writtenRegister(*op)) ? writtenRegister(*op) : NO_REG;
+                for (int8_t reg : reads) {
+                    auto [it, inserted] = live.emplace(reg, std::make_pair(i, i));
+                    it->second.second = i;
+                }
+                if (write != NO_REG) {
+                    auto [it, inserted] = live.emplace(write, std::make_pair(i, i));
+                    it->second.second = i;
+                }
+                refs[i].emplace_back(reads, write);
+            }
+        }
+        if (live.empty()) return false;
+        if (branches) {
+            throw std::runtime_error(where + ": virtual registers can't be allocated in code with branches");
+        }
+
+        // Loop bodies as IR index ranges
+        std::vector<int> pcs = wordPcs(ir);
+        std::vector<std::pair<size_t, size_t>> bodies;
+        for (const HardwareLoop* hwl : programLoops(assignment)) {
+            auto first = std::find(pcs.begin(), pcs.end() - 1, hwl->pc_start);
+            auto last = std::find(pcs.begin(), pcs.end() - 1, hwl->pc_stop);
+            if (first != pcs.end() - 1 && last != pcs.end() - 1 && first <= last) {
+                bodies.emplace_back(first - pcs.begin(), last - pcs.begin());
+            }
+        }
+        auto readFirst = [&](int8_t reg, size_t a, size_t b) {
+            for (size_t i = a; i <= b; i++) {
+                for (const auto& [reads, write] : refs[i]) {
+                    if (std::find(reads.begin(), reads.end(), reg) != reads.end()) return true;
+                    if (write == reg) return false;
+                }
+            }
+            return false;
+        };
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (const auto& [a, b] : bodies) {
+                for (auto& [reg, range] : live) {
+                    if (range.second < a || range.first > b) continue;
+                    if (range.first < a || range.second > b || readFirst(reg, a, b)) {
+                        std::pair<size_t, size_t> whole = {std::min(range.first, a), std::max(range.second, b)};
+                        changed = changed || whole != range;
+                        range = whole;
+                    }
+                }
+            }
+        }
+
+        // Spill weight: references, each counted as often as its loop nest
+        // runs, per IR instruction of the interval
+        std::vector<HardwareLoop*> loops = programLoops(assignment);
+        std::map<int8_t, double> weight;
+        for (size_t i = 0; i < ir.size(); i++) {
+            double executions = 1;
+            for (const HardwareLoop* loop : loops) {
+                if (loop->pc_start <= pcs[i] && pcs[i] <= loop->pc_stop) executions *= loop->iterations;
+            }
+            for (const auto& [reads, write] : refs[i]) {
+                for (int8_t reg : reads) weight[reg] += executions;
+                if (write != NO_REG) weight[write] += executions;
+            }
+        }
+        for (auto& [reg, value] : weight) {
+            value /= double(live[reg].second - live[reg].first + 1);
+        }
+
+        std::set<int8_t> reserved = reservedRegisters(assignment);
+        reserved.insert(also.begin(), also.end());
+        std::vector<int8_t> pool;
+        for (int8_t reg = 1; reg < kFirstVirtualReg; reg++) {
+            if (!reserved.count(reg)) pool.push_back(reg);
+        }
+        std::vector<std::pair<int8_t, std::pair<size_t, size_t>>> order(live.begin(), live.end());
+        std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+        });
+
+        // A register pair of unrollLoop takes an even register and the one
+        // above it if both are free at the first of the two intervals, the
+        // second register is held until the other interval starts
+        std::map<int8_t, std::pair<int8_t, bool>> partner;  // Other register of the pair, low half
+        for (const auto& [low, high] : assignment.register_pairs) {
+            if (live.count(low) && live.count(high)) {
+                partner[low] = {high, true};
+                partner[high] = {low, false};
+            }
+        }
+
+        std::map<int8_t, int8_t> phys;
+        std::vector<int8_t> spilled;
+        auto scan = [&]() {
+            phys.clear();
+            spilled.clear();
+            std::set<int8_t> free(pool.begin(), pool.end());
+            std::vector<int8_t> active;
+            std::map<int8_t, int8_t> held;
+            for (const auto& [reg, range] : order) {
+                for (auto it = active.begin(); it != active.end();) {
+                    if (live[*it].second < range.first) {
+                        free.insert(phys[*it]);
+                        it = active.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                auto hold = held.find(reg);
+                if (hold != held.end()) {
+                    phys[reg] = hold->second;
+                    held.erase(hold);
+                    active.push_back(reg);
+                    continue;
+                }
+                auto pair = partner.find(reg);
+                if (pair != partner.end() && !phys.count(pair->second.first) &&
+                    std::find(spilled.begin(), spilled.end(), pair->second.first) == spilled.end()) {
+                    auto [other, low] = pair->second;
+                    auto fits = [&](int8_t r) { return r % 2 == (low ? 0 : 1) && free.count(low ? r + 1 : r - 1); };
+                    auto first = std::find_if(free.begin(), free.end(), fits);
+                    if (first != free.end()) {
+                        int8_t r = *first;
+                        phys[reg] = r;
+                        held[other] = low ? r + 1 : r - 1;
+                        free.erase(r);
+                        free.erase(held[other]);
+                        active.push_back(reg);
+                        continue;
+                    }
+                }
+                if (!free.empty()) {
+                    phys[reg] = *free.begin();
+                    free.erase(free.begin());
+                    active.push_back(reg);
+                    continue;
+                }
+                // Spill the lightest interval, of equal ones the one that ends last
+                auto cheaper = [&](int8_t a, int8_t b) {
+                    return weight[a] != weight[b] ? weight[a] < weight[b] : live[a].second > live[b].second;
+                };
+                auto victim = std::min_element(active.begin(), active.end(), cheaper);
+                if (victim != active.end() && cheaper(*victim, reg)) {
+                    phys[reg] = phys[*victim];
+                    phys.erase(*victim);
+                    spilled.push_back(*victim);
+                    *victim = reg;
+                } else {
+                    spilled.push_back(reg);
+                }
+            }
+        };
+        scan();
+
+        std::vector<int8_t> scratch;
+        if (!spilled.empty()) {
+            // A mac may read three spilled registers
+            auto accumulates = [](const IROp& op) { return (opInfo(op.op).flags & OP_READS_RD) != 0; };
+            size_t scratch_count = std::any_of(ir.begin(), ir.end(), accumulates) ? 3 : 2;
+            for (const auto& section : assignment.outlined) {
+                if (std::any_of(section.second.begin(), section.second.end(), accumulates)) scratch_count = 3;
+            }
+            if (spill_register.empty() || pool.size() < scratch_count + 1) {
+                throw std::runtime_error(where + ": " + std::to_string(live.size()) + " virtual registers don't fit in " +
+                                         std::to_string(pool.size()) + " free registers, set hardware_config: " +
+                                         "spill_register to a mem_config register to spill them");
+            }
+            scratch.assign(pool.end() - scratch_count, pool.end());
+            pool.resize(pool.size() - scratch_count);
+            scan();
+        }
+        std::map<int8_t, int> slots;
+        for (int8_t reg : spilled) {
+            slots[reg] = 4 * spill_words++;
+        }
+        if (4 * spill_words > 2048) {
+            throw std::runtime_error(where + ": the spill slots of all programs take " + std::to_string(4 * spill_words) +
+                                     " bytes, more than a 12-bit offset from " + spill_register + " reaches");
+        }
+
+        // Rename one instruction. Spilled sources are loaded into scratch
+        // registers in front of it, a spilled result goes from the first
+        // scratch register to its slot behind it. The accumulator of a mac
+        // is loaded first, so it stays in the first scratch register.
+        auto rename = [&](IROp& op, std::vector<std::pair<int8_t, int>>& loads, int& store) {
+            std::map<int8_t, int8_t> loaded;
+            store = -1;
+            int8_t result = op.rd;
+            std::vector<int8_t*> sources = {&op.rs1, &op.rs2};
+            if (opInfo(op.op).flags & OP_READS_RD) sources.insert(sources.begin(), &op.rd);
+            for (int8_t* reg : sources) {
+                if (!isVirtual(*reg)) continue;
+                auto it = phys.find(*reg);
+                if (it != phys.end()) {
+                    *reg = it->second;
+                    continue;
+                }
+                auto scratch_reg = loaded.find(*reg);
+                if (scratch_reg == loaded.end()) {
+                    scratch_reg = loaded.emplace(*reg, scratch[loaded.size()]).first;
+                    loads.emplace_back(scratch_reg->second, slots[*reg]);
+                }
+                *reg = scratch_reg->second;
+            }
+            if (isVirtual(result)) {
+                auto it = phys.find(result);
+                if (it != phys.end()) {
+                    op.rd = it->second;
+                } else {
+                    store = slots[result];
+                    op.rd = scratch[0];
+                }
+            }
+        };
+        auto spillAccess = [&](const std::string& operation, int8_t reg, int slot) {
+            Instruction access;
+            access.operation = operation;
+            access.format = "mem-type";
+            access.ra1 = "x" + std::to_string(reg);
+            access.ra2 = access.rd = "null";
+            access.base_address = spill_register;
+            access.offset = slot;
+            return access;
+        };
+
+        size_t reloads = 0, stores = 0;
+        for (size_t i = ir.size(); i-- > 0;) {
+            std::vector<std::pair<int8_t, int>> loads;
+            int store;
+            rename(ir[i], loads, store);
+            if (store >= 0) {
+                insertInstruction(assignment, i + 1, spillAccess("SW", scratch[0], store), true);
+                stores++;
+            }
+            for (auto it = loads.rbegin(); it != loads.rend(); ++it) {
+                insertInstruction(assignment, i, spillAccess("LW", it->first, it->second), false);
+                reloads++;
+            }
+        }
+        for (auto& section : assignment.outlined) {
+            auto& code = section.second;
+            for (size_t i = code.size(); i-- > 0;) {
+                std::vector<std::pair<int8_t, int>> loads;
+                int store;
+                rename(code[i], loads, store);
+                if (store >= 0) {
+                    Instruction access = spillAccess("SW", scratch[0], store);
+                    code.insert(code.begin() + i + 1, lowerInstruction(access, assignment.instructions.size()));
+                    assignment.instructions.push_back(access);
+                    stores++;
+                }
+                for (auto it = loads.rbegin(); it != loads.rend(); ++it) {
+                    Instruction access = spillAccess("LW", it->first, it->second);
+                    code.insert(code.begin() + i, lowerInstruction(access, assignment.instructions.size()));
+                    assignment.instructions.push_back(access);
+                    reloads++;
+                }
+            }
+        }
+
+        std::set<int8_t> used;
+        for (const auto& [reg, target] : phys) used.insert(target);
+        std::cout << where << ": " << live.size() << " virtual registers in " << used.size() << " registers";
+        if (!spilled.empty()) {
+            std::cout << ", " << spilled.size() << " spilled to the TCDM stack (" << reloads << " loads, " 
+                      << stores << " stores)";
+            assignment.required_base_registers.insert(spill_register);
+            assignment.has_mem_type = true;
+        }
+        std::cout << std::endl;
+        return !spilled.empty();
+    }
+
+    static void appendReg(std::string& out, int8_t reg) {
+        if (reg == NO_REG) {
+            out += "null";
+            return;
+        }
+        out += 'x';
+        out += std::to_string(reg);
+    }
+
+    // Helper function to expand an ADDI whose immediate does not fit 12 bits
+    std::string generateLargeAddi(const IROp& ir) {
+        auto [lui_val, addi_val] = calculateLuiAddiValues(ir.imm);
+
+        // Convert addi_val to signed 12-bit value if it exceeds range
+        if (addi_val & 0x800) {
+            addi_val = addi_val | 0xFFFFF000;
+        }
+
+        std::string result = "";
+        // Add comment explaining the LUI+ADDI sequence
+        result += "    # Loading immediate " + std::to_string(ir.imm) + 
+                 " using LUI+ADDI: " + std::to_string(lui_val) + " << 12 + " + 
+                 std::to_string(addi_val) + " = " + 
+                 std::to_string((lui_val << 12) + addi_val) + "\n";
+
+        if (lui_val != 0) {
+            result += "    lui ";
+            appendReg(result, ir.rd);
+            result += ", " + std::to_string(lui_val) + "\n";
+            result += "    addi ";
+            appendReg(result, ir.rd);
+            result += ", ";
+            appendReg(result, ir.rs1);
+            result += ", " + std::to_string(addi_val) + "\n";
+        } else {
+            result += "    addi ";
+            appendReg(result, ir.rd);
+            result += ", ";
+            appendReg(result, ir.rs1);
+            result += ", " + std::to_string(ir.imm) + "\n";
+        }
+        return result;
+    }
+
+    std::string generateInstructionCode(const PEAssignment& assignment, const IROp& ir, 
+                                        int& hwl_count, int pe_id, int pc_base = 0,
+                                        const std::pair<std::string, std::string>* loop_labels = nullptr) {
+        const Instruction& instr = assignment.instructions[ir.src];
+        const OpcodeInfo& info = opInfo(ir.op);
+
+        std::string line;
+        line.reserve(48);
+        line += "    ";
+        line += info.mnemonic;
+        line += ' ';
+
+        switch (info.cls) {
+            case OpClass::Hwl:
+                return generateHWLInstructions(instr, ++hwl_count, pe_id, pc_base, loop_labels);
+            case OpClass::PsrfMem:
+                // psrf.lw rd, var(base), offset register in imm[11:6]
+                appendReg(line, (info.flags & OP_LOAD) ? ir.rd : ir.rs2);
+                if (ir.var != NO_REG || ir.offs != 0) {
+                    line += ", " + std::to_string((ir.var != NO_REG ? ir.var : 0) + (ir.offs << 6));
+                }
+                line += '(';
+                appendReg(line, ir.base);
+                line += ")\n";
+                return line;
+            case OpClass::Mem:
+                // lw rd, offset(base)
+                appendReg(line, (info.flags & OP_LOAD) ? ir.rd : ir.rs2);
+                line += ", " + std::to_string(ir.imm) + "(";
+                appendReg(line, ir.base);
+                line += ")\n";
+                return line;
+            case OpClass::IType:
+                if (ir.op == Opcode::ADDI && (ir.imm > 2047 || ir.imm < -2048)) {
+                    return generateLargeAddi(ir);
+                }
+                appendReg(line, ir.rd);
+                line += ", ";
+                appendReg(line, ir.rs1);
+                line += ", " + std::to_string(ir.imm) + "\n";
+                return line;
+            case OpClass::RType:
+                appendReg(line, ir.rd);
+                line += ", ";
+                appendReg(line, ir.rs1);
+                line += ", ";
+                appendReg(line, ir.rs2);
+                line += "\n";
+                return line;
+            case OpClass::BType:
+                appendReg(line, ir.rs1);
+                line += ", ";
+                appendReg(line, ir.rs2);
+                line += ", " + std::to_string(ir.imm) + "\n";
+                return line;
+            case OpClass::UType:
+                appendReg(line, ir.rd);
+                line += ", " + std::to_string(ir.imm) + "\n";
+                return line;
+            case OpClass::JType:
+                // For function calls, use the provided address
+                appendReg(line, ir.rd);
+                if (!instr.label.empty()) {
+                    return line + ", " + instr.label + "  # Call outlined loop body code\n";
+                }
+                line += ", " + std::to_string(ir.imm);
+                line += instr.target.empty() ? "  # Call somewhere\n" : "  # Call " + instr.target + "\n";
+                return line;
+            case OpClass::Special:
+                line.back() = '\n';
+                return line;
+            default:
+                return "    # Unknown instruction: " + instr.operation + " (format: " + instr.format + ")\n";
+        }
+    }
+
+    // Helper function to calculate hardware loop immediate value
+    uint32_t calculateHWLImmediate(const HardwareLoop& hwl, int delay) {
+        uint32_t imm = 0;
+        imm |= (static_cast<uint32_t>((hwl.pc_start + delay) & 0x1FF) << 23);  //  9 bits pc_start
+        imm |= (static_cast<uint32_t>((hwl.pc_stop - hwl.pc_start) & 0x3F) << 17);   // 6 bits pc_stop
+        imm |= (static_cast<uint32_t>(hwl.hwl_index & 0x1F) << 12); // 5 bits hwl_index
+        imm |= (static_cast<uint32_t>(hwl.iterations & 0xFFF));     // 12 bits iterations
+        return imm;
+    }
+
+    // Helper function to split immediate into upper and lower parts
+    std::pair<uint32_t, uint32_t> splitHWLImmediate(uint32_t imm) {
+        uint32_t upper = (imm >> 12) & 0xFFFFF;  // Upper 20 bits
+        uint32_t lower = imm & 0xFFF;            // Lower 12 bits
+        if (lower & 0x800) {  // If the highest bit of lower part is 1
+            upper += 1;       // Add 1 to upper to handle sign extension
+        }
+        return {upper, lower};
+    }
+
+public:
+    DFGProcessor() : output_folder("build/") {}
+    DFGProcessor(const std::string& output_folder) : output_folder(output_folder) {}
+
+    // Helper function to write the tile schedule consumed by the harness DMA model
+    void writeTileSchedule() {
+        if (!tiling.enabled) return;
+
+        std::string filename = output_folder + "tile_schedule.txt";
+        std::ofstream outFile(filename);
+        outFile << "# Tile schedule for double-buffered execution\n";
+        outFile << "# buffer <reg> <ping byte address> / advance <reg> <bytes per tile>\n";
+        outFile << "num_tiles " << tiling.num_tiles << "\n";
+        outFile << "buffer_stride " << tiling.buffer_stride << "\n";
+        outFile << "tile_words " << tiling.tile_words << "\n";
+        for (const auto& reg : tiling.double_buffer) {
+            outFile << "buffer " << reg << " " << mem_config[reg] << "\n";
+        }
+        for (const auto& [reg, stride] : tiling.tile_advance) {
+            outFile << "advance " << reg << " " << stride << "\n";
+        }
+        outFile.close();
+        std::cout << "Generated tile schedule in " << filename << std::endl;
+    }
+
+    void loadConfig(const std::string& yaml_file) {
+        YAML::Node config = YAML::LoadFile(yaml_file);
+
+        // Load memory configuration
+        if (config["mem_config"]) {
+            auto mem_conf = config["mem_config"];
+            for (const auto& entry : mem_conf) {
+                std::string reg = entry.first.as<std::string>();
+                if (!entry.second.IsNull()) {
+                    mem_config[reg] = entry.second.as<int>();
+                }
+            }
+        }
+
+        // Load delay_start array if present
+        if (config["delay_start"]) {
+            auto delay_array = config["delay_start"];
+            delay_start.clear();  // Clear any existing values
+            for (const auto& delay : delay_array) {
+                delay_start.push_back(delay.as<int>());
+            }
+            std::cout << "Loaded delay_start values: ";
+            for (int delay : delay_start) {
+                std::cout << delay << " ";
+            }
+            std::cout << std::endl;
+        } else {
+            // Initialize with zeros if not present
+            delay_start.resize(64, 0);  // Support up to 64 PEs
+        }
+
+        // Load memory offsets
+        if (config["hardware_config"]["psrf_mem_offset"]) {
+            auto offset_conf = config["hardware_config"]["psrf_mem_offset"];
+            for (const auto& entry : offset_conf) {
+                std::string offset_key = entry.first.as<std::string>();
+                if (!entry.second.IsNull()) {
+                    mem_offsets[offset_key] = entry.second.as<int>();
+                }
+            }
+        }
+
+        // Load hardware configuration
+        total_pes = config["hardware_config"]["total_pes"].as<int>();
+        clusters_count = config["hardware_config"]["clusters"]["count"].as<int>();
+        pes_per_cluster = config["hardware_config"]["clusters"]["pes_per_cluster"].as<int>();
+        minimum_pes_required = config["scheduling"]["minimum_pes_required"].as<int>();
+        data_dup = config["hardware_config"]["data_dup"].as<int>();
+        if (config["hardware_config"]["imem_exec_words"]) {
+            imem_exec_words = config["hardware_config"]["imem_exec_words"].as<int>();
+        }
+        if (config["hardware_config"]["optimize_preload"]) {
+            optimize_preload = config["hardware_config"]["optimize_preload"].as<bool>();
+        }
+        if (config["hardware_config"]["load_latency"]) {
+            load_latency = config["hardware_config"]["load_latency"].as<int>();
+        }
+        if (config["hardware_config"]["unroll"]) {
+            std::string unroll = config["hardware_config"]["unroll"].as<std::string>();
+            unroll_factor = unroll == "auto" ? 0 : std::stoi(unroll);
+            if (unroll_factor < 0) {
+                throw std::runtime_error("unroll must be auto or a factor of at least 1");
+            }
+        }
+        if (config["hardware_config"]["mac"]) {
+            fuse_mac = config["hardware_config"]["mac"].as<bool>();
+        }
+        if (config["hardware_config"]["hoist_invariants"]) {
+            hoist_invariants = config["hardware_config"]["hoist_invariants"].as<bool>();
+        }
+        if (config["hardware_config"]["packed_int8"]) {
+            for (const auto& reg : config["hardware_config"]["packed_int8"]) {
+                std::string name = reg.as<std::string>();
+                if (mem_config.count(name) == 0) {
+                    throw std::runtime_error("packed int8 register " + name + " has no mem_config entry");
+                }
+                packed_int8.insert(parseRegister(name));
+            }
+        }
+        if (config["hardware_config"]["spill_register"]) {
+            spill_register = config["hardware_config"]["spill_register"].as<std::string>();
+            if (mem_config.count(spill_register) == 0) {
+                throw std::runtime_error("spill register " + spill_register + " has no mem_config entry");
+            }
+        }
+
+        // Load tiling configuration for double-buffered execution
+        if (config["tiling"]) {
+            auto tiling_conf = config["tiling"];
+            tiling.enabled = true;
+            tiling.num_tiles = tiling_conf["num_tiles"].as<int>();
+            tiling.buffer_stride = tiling_conf["buffer_stride"].as<int>();
+            if (tiling_conf["tile_words"]) {
+                tiling.tile_words = tiling_conf["tile_words"].as<int>();
+            }
+            if (tiling_conf["swap_register"]) {
+                tiling.swap_register = tiling_conf["swap_register"].as<std::string>();
+            }
+            if (tiling_conf["advance_register"]) {
+                tiling.advance_register = tiling_conf["advance_register"].as<std::string>();
+            }
+            if (tiling_conf["double_buffer"]) {
+                for (const auto& reg : tiling_conf["double_buffer"]) {
+                    tiling.double_buffer.push_back(reg.as<std::string>());
+                }
+            }
+            if (tiling_conf["tile_advance"]) {
+                for (const auto& entry : tiling_conf["tile_advance"]) {
+                    tiling.tile_advance[entry.first.as<std::string>()] = entry.second.as<int>();
+                }
+            }
+
+            // The swap registers must not alias a base register or the return link
+            for (const auto& reg : {tiling.swap_register, tiling.advance_register}) {
+                if (mem_config.count(reg) > 0 || reg == "x26") {
+                    throw std::runtime_error("tiling register " + reg + " is already in use");
+                }
+            }
+            for (const auto& reg : tiling.double_buffer) {
+                if (mem_config.count(reg) == 0) {
+                    throw std::runtime_error("double-buffered register " + reg + " has no mem_config entry");
+                }
+            }
+            std::cout << "Tiling enabled: " << tiling.num_tiles << " tiles, buffer stride "
+                      << tiling.buffer_stride << std::endl;
+        }
+
+        // An array read with psrf.ld2 starts on an 8-byte boundary in every
+        // cluster, buffer and tile
+        if (config["hardware_config"]["paired_loads"]) {
+            for (const auto& reg : config["hardware_config"]["paired_loads"]) {
+                std::string name = reg.as<std::string>();
+                if (mem_config.count(name) == 0) {
+                    throw std::runtime_error("paired load register " + name + " has no mem_config entry");
+                }
+                std::vector<int> moves = {mem_config[name]};
+                if (mem_offsets.count(name + "_offset")) moves.push_back(mem_offsets[name + "_offset"]);
+                if (tiling.enabled && std::count(tiling.double_buffer.begin(), tiling.double_buffer.end(), name)) {
+                    moves.push_back(tiling.buffer_stride);
+                }
+                if (tiling.enabled && tiling.tile_advance.count(name)) moves.push_back(tiling.tile_advance[name]);
+                if (std::any_of(moves.begin(), moves.end(), [](int bytes) { return bytes % 8 != 0; })) {
+                    throw std::runtime_error("paired load register " + name + " doesn't address an 8-byte aligned array");
+                }
+                paired_loads.insert(parseRegister(name));
+            }
+        }
+
+        // Load PE assignments
+        auto assignments = config["scheduling"]["pe_assignments"];
+        for (const auto& assignment : assignments) {
+            PEAssignment pe_assignment;
+            pe_assignment.pe_id = assignment["pe_id"].as<int>();
+            pe_assignment.has_psrf_mem_type = false;
+            pe_assignment.has_mem_type = false;
+            pe_assignment.has_hwl = false;
+            
+            for (const auto& instr : assignment["instructions"]) {
+                Instruction instruction;
+                instruction.operation = instr["operation"].as<std::string>();
+                instruction.format = instr["format"].as<std::string>();
+                
+                // Handle hardware loop instructions
+                if (instruction.format == "hwl-type") {
+                    pe_assignment.has_hwl = true;
+                    HardwareLoop hwl;
+                    hwl.loop_id = instr["loop_id"].as<int>();
+                    hwl.pc_start = instr["pc_start"].as<int>();
+                    hwl.pc_stop = instr["pc_stop"].as<int>();
+                    hwl.hwl_index = instr["hwl_index"].as<int>();
+                    hwl.iterations = instr["iterations"].as<int>();
+                    instruction.hwl = hwl;
+                }
+                
+                // Handle register assignments
+                instruction.ra1 = "null";
+                instruction.ra2 = "null";
+                instruction.rd = "null";
+                if (instr["ra1"] && !instr["ra1"].IsNull()) {
+                    instruction.ra1 = instr["ra1"].as<std::string>();
+                }
+                if (instr["ra2"] && !instr["ra2"].IsNull()) {
+                    instruction.ra2 = instr["ra2"].as<std::string>();
+                }
+                if (instr["rd"] && !instr["rd"].IsNull()) {
+                    instruction.rd = instr["rd"].as<std::string>();
+                }
+
+                // Handle immediate value for I-type instructions
+                instruction.imm = 0;  // Default value
+                if (instr["imm"] && !instr["imm"].IsNull()) {
+                    instruction.imm = instr["imm"].as<int>();
+                }
+                
+                // Set operation to uppercase for standard operations if needed
+                if (instruction.format == "i-type" || instruction.format == "r-type") {
+                    instruction.operation = instruction.operation;
+                    // Make sure operation is uppercase for standard operations
+                    if (instruction.operation == "addi" || instruction.operation == "add" ||
+                        instruction.operation == "mul" || instruction.operation == "lw" ||
+                        instruction.operation == "sw") {
+                        // Convert to uppercase for internal processing
+                        std::string upper_op = instruction.operation;
+                        std::transform(upper_op.begin(), upper_op.end(), upper_op.begin(), ::toupper);
+                        instruction.operation = upper_op;
+                    }
+                }
+                
+                // Handle base address
+                if (instr["base_address"] && !instr["base_address"].IsNull()) {
+                    instruction.base_address = instr["base_address"].as<std::string>();
+                    if (instruction.format == "psrf-mem-type" || instruction.format == "mem-type") {
+                        pe_assignment.required_base_registers.insert(instruction.base_address);
+                    }
+                }
+
+                // Load var field for psrf-mem-type
+                if (instruction.format == "psrf-mem-type") {
+                    pe_assignment.has_psrf_mem_type = true;
+                    if (instr["var"] && !instr["var"].IsNull() && instr["var"].as<std::string>() != "auto") {
+                        instruction.var = instr["var"].as<int>();
+                    }
+
+                    // Load psrf_var values
+                    if (instr["psrf_var"] && !instr["psrf_var"].IsNull()) {
+                        auto psrf_vars = instr["psrf_var"];
+                        for (const auto& var : psrf_vars) {
+                            instruction.psrf_var[var.first.as<std::string>()] = var.second.as<int>();
+                        }
+                    }
+
+                    // Load coefficients
+                    if (instr["coefficients"] && !instr["coefficients"].IsNull()) {
+                        auto coeffs = instr["coefficients"];
+                        for (const auto& coeff : coeffs) {
+                            instruction.coefficients[coeff.first.as<std::string>()] = coeff.second.as<int>();
+                        }
+                    }
+                }
+
+                if (instruction.format == "mem-type") {
+                    pe_assignment.has_mem_type = true;
+                }
+                
+                // Load target field for JAL instructions
+                if (instr["target"] && !instr["target"].IsNull()) {
+                    instruction.target = instr["target"].as<std::string>();
+                }
+
+                // Load address field for JAL instructions
+                if (instr["address"] && !instr["address"].IsNull()) {
+                    instruction.address = instr["address"].as<int>();
+                }
+
+                // Load offset field for memory operations
+                if (instr["offset"] && !instr["offset"].IsNull()) {
+                    instruction.offset = instr["offset"].as<int>();
+                }
+
+                pe_assignment.ir.push_back(lowerInstruction(instruction, pe_assignment.instructions.size()));
+                pe_assignment.instructions.push_back(instruction);
+            }
+            allocateVarGroups(pe_assignment);
+            legalizeLoops(pe_assignment);
+            pipelineInnerLoops(pe_assignment);
+            scheduleLoopBodies(pe_assignment);
+            pe_assignments.push_back(pe_assignment);
+        }
+
+        // Load function definitions
+        if (config["functions"]) {
+            auto functions = config["functions"];
+            for (const auto& func : functions) {
+                std::string func_name = func.first.as<std::string>();
+                int func_address = func.second["address"].as<int>();
+                
+                // Store function address for later use
+                function_addresses[func_name] = func_address;
+                
+                // Process PE assignments for this function
+                auto pe_assigns = func.second["pe_assignments"];
+                for (const auto& pe_assign : pe_assigns) {
+                    int pe_id = pe_assign["pe_id"].as<int>();
+                    PEAssignment func_pe_assignment;
+                    func_pe_assignment.pe_id = pe_id;
+                    func_pe_assignment.has_psrf_mem_type = false;
+                    func_pe_assignment.has_hwl = false;
+                    
+                    for (const auto& instr : pe_assign["instructions"]) {
+                        Instruction instruction;
+                        instruction.operation = instr["operation"].as<std::string>();
+                        instruction.format = instr["format"].as<std::string>();
+                        
+                        // Handle register assignments
+                        instruction.ra1 = "null";
+                        instruction.ra2 = "null";
+                        instruction.rd = "null";
+                        if (instr["ra1"] && !instr["ra1"].IsNull()) {
+                            instruction.ra1 = instr["ra1"].as<std::string>();
+                        }
+                        if (instr["ra2"] && !instr["ra2"].IsNull()) {
+                            instruction.ra2 = instr["ra2"].as<std::string>();
+                        }
+                        if (instr["rd"] && !instr["rd"].IsNull()) {
+                            instruction.rd = instr["rd"].as<std::string>();
+                        }
+
+                        // Handle immediate value for I-type instructions
+                        instruction.imm = 0;
+                        if (instr["imm"] && !instr["imm"].IsNull()) {
+                            instruction.imm = instr["imm"].as<int>();
+                        }
+                        
+                        // Set operation to uppercase for standard operations
+                        if (instruction.format == "i-type" || instruction.format == "r-type") {
+                            std::string upper_op = instruction.operation;
+                            std::transform(upper_op.begin(), upper_op.end(), upper_op.begin(), ::toupper);
+                            instruction.operation = upper_op;
+                        }
+                        
+                        func_pe_assignment.ir.push_back(
+                            lowerInstruction(instruction, func_pe_assignment.instructions.size()));
+                        func_pe_assignment.instructions.push_back(instruction);
+                    }
+                    std::cout << "PE " << pe_id << " Function PE assignment: " << func_pe_assignment.instructions.size() << std::endl;
+                    // Store function PE assignment
+                    checkLoopFields(func_pe_assignment, "Function " + func_name + " on PE " + std::to_string(pe_id));
+                    function_pe_assignments[func_name][pe_id] = func_pe_assignment;
+                }
+            }
+        }
+
+        // Virtual registers get physical ones once all programs are known,
+        // programs keep out of the registers of the functions they may call
+        std::set<int8_t> function_registers;
+        bool functions_spill = false;
+        for (auto& [func_name, pe_assigns] : function_pe_assignments) {
+            for (auto& [pe_id, func_assignment] : pe_assigns) {
+                std::string where = "Function " + func_name + " on PE " + std::to_string(pe_id);
+                if (allocateRegisters(func_assignment, {}, where)) {
+                    checkLoopFields(func_assignment, where);
+                    functions_spill = true;
+                }
+                for (const IROp& op : func_assignment.ir) {
+                    for (int8_t reg : {op.rd, op.rs1, op.rs2, op.base}) {
+                        if (reg != NO_REG) function_registers.insert(reg);
+                    }
+                }
+            }
+        }
+        for (auto& pe_assignment : pe_assignments) {
+            if (functions_spill) {
+                pe_assignment.required_base_registers.insert(spill_register);
+            }
+            if (allocateRegisters(pe_assignment, function_registers, "PE " + std::to_string(pe_assignment.pe_id))) {
+                legalizeLoops(pe_assignment);
+            }
+            pairWordLoads(pe_assignment);
+        }
+    }
+
+    // Program layout of one PE, decided before any code is emitted
+    struct PEProgramPlan {
+        int pe;
+        std::vector<OverlaySegment> segments;
+        std::string tail;  // Buffer swap point and function sections
+        std::string outlined;  // Code moved out of long loop bodies, behind the final ret
+    };
+
+    // First pass: pick the PEs to generate and split their programs into
+    // overlay segments. All PEs step through the same number of phases,
+    // PEs with fewer segments get empty ones.
+    std::vector<PEProgramPlan> planPrograms(size_t& max_segments) {
+        std::vector<PEProgramPlan> plans;
+        max_segments = 1;
+        for (int pe = 0; pe < total_pes; pe++) {
+
+            int base_pe = pe % pes_per_cluster;
+            std::cout << "Base PE: " << base_pe << std::endl;
+            std::cout << "Minimum PEs required: " << minimum_pes_required << std::endl;
+            if (base_pe > minimum_pes_required) {
+                std::cout << "Skipping PE " << pe << " due to minimum PEs required" << std::endl;
+                continue;
+            }
+            const PEAssignment& assignment = pe_assignments[base_pe];
+            std::cout << "Assignment: " << assignment.instructions.size() << std::endl;
+            if (assignment.instructions.size() == 0) {
+                std::cout << "Skipping PE " << pe << " without instructions" << std::endl;   
+                continue;
+            }  
+
+            // Function HWLs are numbered after the ones of the main program
+            int hwl_count = std::count_if(assignment.ir.begin(), assignment.ir.end(),
+                                          [](const IROp& ir) { return ir.op == Opcode::HWL; });
+            PEProgramPlan plan;
+            plan.pe = pe;
+            plan.tail = generateBufferSwapPoint() + generateFunctionSections(pe, hwl_count);
+            plan.outlined = generateOutlinedSections(assignment, pe);
+            plan.segments = splitOverlaySegments(assignment, pe, countInstructionWords(plan.tail) + 1 + 
+                                                 countInstructionWords(plan.outlined));
+            max_segments = std::max(max_segments, plan.segments.size());
+            plans.push_back(std::move(plan));
+        }
+        if (max_segments > 1) {
+            std::cout << "Program split into " << max_segments << " imem overlay segments" << std::endl;
+        }
+        return plans;
+    }
+
+    // Second pass: emit the assembly text of one PE. Only reads shared state,
+    // so PEs can be generated concurrently.
+    std::string generatePEProgram(const PEProgramPlan& plan, size_t max_segments, PreloadStats* stats = nullptr) {
+        int pe = plan.pe;
+        const PEAssignment& assignment = pe_assignments[pe % pes_per_cluster];
+        std::string program = generatePEHeader(pe);
+
+        // Generate base address loading if needed
+        if (!assignment.required_base_registers.empty()) {
+            program += generateBaseAddressLoading(pe, data_dup, false, stats);
+        }
+        return program + generatePEBody(plan, max_segments, stats);
+    }
+
+    std::string generatePEHeader(int pe) {
+        std::ostringstream outFile;
+        outFile << "# Assembly for PE" << pe << " (Cluster " << getClusterNumber(pe) << ")\n";
+        outFile << "# Generated with PSRF, HWL and function support\n";
+        outFile << ".text\n";
+        outFile << ".global _start\n\n";
+        outFile << "_start:\n";
+        return outFile.str();
+    }
+
+    // Everything after the base address loading: preload and execution section
+    std::string generatePEBody(const PEProgramPlan& plan, size_t max_segments, PreloadStats* stats = nullptr) {
+        int pe = plan.pe;
+        const PEAssignment& assignment = pe_assignments[pe % pes_per_cluster];
+        std::ostringstream outFile;
+
+        // Generate preload section if needed
+        if (assignment.has_psrf_mem_type || assignment.has_mem_type) {
+            outFile << generatePreloadSection(assignment, stats);
+        }
+
+        // Add comment to mark the beginning of the execution section
+        outFile << "    # ========== Execution Section Begin ==========\n";
+        // Stall for the start delay, one delay instruction per 4095 cycles
+        if (startDelay(pe) > 0) {
+            outFile << "    # Delaying the start by " << startDelay(pe) << " cycles\n";
+            for (int left = startDelay(pe); left > 0; left -= kMaxDelayCycles) {
+                outFile << "    delay " << std::min(left, kMaxDelayCycles) << "\n";
+            }
+            outFile << "\n";
+        }
+        // Generate instructions, one overlay segment after the other
+        int hwl_count = 0;  // Counter for hardware loop immediates
+        for (size_t s = 0; s < max_segments; s++) {
+            if (s > 0) {
+                outFile << "\n    # ========== Overlay Segment " << s << " ==========\n";
+            }
+            if (s < plan.segments.size()) {
+                const OverlaySegment& segment = plan.segments[s];
+                LoopLabels labels = placeLoopLabels(assignment, segment, hwl_count);
+                for (size_t i = segment.first; i < segment.last; i++) {
+                    auto names = labels.before.find(i);
+                    if (names != labels.before.end()) {
+                        for (const auto& name : names->second) {
+                            outFile << name << ":\n";
+                        }
+                    }
+                    auto loop = labels.loops.find(i);
+                    outFile << generateInstructionCode(assignment, assignment.ir[i], hwl_count, pe, 
+                                                       segment.pc_base, 
+                                                       loop == labels.loops.end() ? nullptr : &loop->second);
+                }
+            }
+            if (s + 1 < max_segments) {
+                outFile << "    # End of overlay segment " << s << "\n";
+                outFile << "    ret\n";
+            }
+        }
+        outFile << plan.tail;
+
+        outFile << "    # End of program\n";
+        outFile << "    ret\n";
+        outFile << plan.outlined;
+        return outFile.str();
+    }
+
+    void reportPreloadStats(const PreloadStats& stats, size_t programs, const std::string& what) {
+        std::cout << "Preload instructions of " << programs << " " << what << ": " << stats.before;
+        if (optimize_preload) {
+            std::cout << " before, " << stats.after << " after optimization";
+        }
+        std::cout << std::endl;
+    }
+
+    // Generate the assembly text of every PE on num_threads workers, keyed by
+    // PE id. The text does not depend on the number of threads.
+    std::map<int, std::string> generatePrograms(unsigned num_threads = 1) {
+        std::cout << "Generating assembly for " << total_pes << " PEs" << std::endl;
+
+        size_t max_segments = 1;
+        std::vector<PEProgramPlan> plans = planPrograms(max_segments);
+        std::vector<std::string> texts(plans.size());
+        std::vector<PreloadStats> stats(plans.size());
+        parallelFor(plans.size(), num_threads, [&](size_t i) {
+            texts[i] = generatePEProgram(plans[i], max_segments, &stats[i]);
+        });
+
+        std::map<int, std::string> programs;
+        PreloadStats total;
+        for (size_t i = 0; i < plans.size(); i++) {
+            programs[plans[i].pe] = std::move(texts[i]);
+            total += stats[i];
+        }
+        reportPreloadStats(total, plans.size(), "PE programs");
+        return programs;
+    }
+
+    // Programs of PEs that only differ in their base constants, shared as one
+    // template each. PEs of the same base_pe normally fall into one template,
+    // per-PE start delays or function sections split them further.
+    struct ProgramTemplates {
+        std::vector<std::string> slot_registers;  // Base registers, one LUI/ADDI pair each
+        std::vector<std::string> programs;        // Assembly text of every template
+        std::map<int, std::pair<int, std::vector<int>>> patches;  // pe -> template, base constants
+    };
+
+    ProgramTemplates generateTemplates(unsigned num_threads = 1) {
+        std::cout << "Generating program templates for " << total_pes << " PEs" << std::endl;
+
+        size_t max_segments = 1;
+        std::vector<PEProgramPlan> plans = planPrograms(max_segments);
+        std::vector<std::string> bodies(plans.size());
+        std::vector<PreloadStats> stats(plans.size());
+        parallelFor(plans.size(), num_threads, [&](size_t i) {
+            bodies[i] = generatePEBody(plans[i], max_segments, &stats[i]);
+        });
+
+        ProgramTemplates templates;
+        PreloadStats total;
+        templates.slot_registers = baseRegisters();
+        std::map<std::pair<bool, std::string>, int> template_ids;
+        for (size_t i = 0; i < plans.size(); i++) {
+            int pe = plans[i].pe;
+            const PEAssignment& assignment = pe_assignments[pe % pes_per_cluster];
+            bool loads_bases = !assignment.required_base_registers.empty();
+
+            // The base address loading of a template always comes first in the
+            // preload section, so the patch slots sit at fixed preload words
+            auto [it, inserted] = template_ids.emplace(std::make_pair(loads_bases, bodies[i]), 
+                                                       (int)templates.programs.size());
+            if (inserted) {
+                std::string program = "# Template " + std::to_string(it->second) + 
+                                      " (first used by PE" + std::to_string(pe) + ")\n";
+                program += ".text\n.global _start\n\n_start:\n";
+                if (loads_bases) {
+                    program += generateBaseAddressLoading(pe, data_dup, true, &total);
+                }
+                templates.programs.push_back(program + bodies[i]);
+                total += stats[i];
+            }
+
+            std::vector<int> constants;
+            if (loads_bases) {
+                for (const auto& reg : templates.slot_registers) {
+                    constants.push_back(calculateClusterBaseAddress(reg, getClusterNumber(pe), data_dup, pe));
+                }
+            }
+            templates.patches[pe] = {it->second, constants};
+        }
+        std::cout << "Deduplicated " << plans.size() << " PE programs into " 
+                  << templates.programs.size() << " templates" << std::endl;
+        reportPreloadStats(total, templates.programs.size(), "templates");
+        return templates;
+    }
+
+    void generateAssembly(unsigned num_threads = 1) {
+        // Generate assembly for each PE
+        for (const auto& [pe, program] : generatePrograms(num_threads)) {
+            std::string filename = output_folder + "pe" + std::to_string(pe) + "_assembly.s";
+            std::ofstream outFile(filename);
+            outFile << program;
+            outFile.close();
+            
+            std::cout << "Generated assembly for PE" << pe << " (Cluster " << 
+                     getClusterNumber(pe) << ") in " << filename << std::endl;
+        }
+
+        writeTileSchedule();
+    }
+};
+
+#endif // DFG_PROCESSOR_H
@@ -0,0 +1,205 @@
+// In-memory compile pipeline: YAML -> per-PE assembly text -> combined memory
+// image, without the pe<N>_assembly.s round trip through the file system.
+// Code generation and assembly of the PEs run on a thread pool, the output is
+// byte-identical to dfg_processor followed by risc_v_assembler. With
+// --templates PEs that only differ in their base constants share one
+// assembled program, and the image loader patches the constants per PE.
+// With --lockstep they share one instruction stream instead, see linkGrid.
+#include "dfg_processor.h"
+#include "risc_v_assembler.h"
+#include "thread_pool.h"
+#include <chrono>
+
+// Discards the per-instruction console listing of both tools
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <yaml_file> [output_folder] [options]" << std::endl;
+        std::cerr << "  yaml_file: Path to the YAML configuration file" << std::endl;
+        std::cerr << "  output_folder: Directory to store the memory images (default: 'build')" << std::endl;
+        std::cerr << "  --threads N: Worker threads (default: hardware threads)" << std::endl;
+        std::cerr << "  --emit-asm: Also write pe<N>_assembly.s for debugging" << std::endl;
+        std::cerr << "  --templates: Write template_memory.mem, one program per template plus" << std::endl;
+        std::cerr << "               a per-PE patch table of base constants" << std::endl;
+        std::cerr << "  --lockstep: Link PEs with identical execution sections as lockstep" << std::endl;
+        std::cerr << "              followers of one leader PE, grid image only" << std::endl;
+        std::cerr << "  --verbose: Keep the code generation and assembler listing" << std::endl;
+        return 1;
+    }
+
+    std::string yaml_file = argv[1];
+    std::string output_folder = "build";
+    unsigned num_threads = defaultThreadCount();
+    bool emit_asm = false;
+    bool verbose = false;
+    bool use_templates = false;
+    bool lockstep = false;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            num_threads = std::stoul(argv[++i]);
+        } else if (arg == "--emit-asm") {
+            emit_asm = true;
+        } else if (arg == "--templates") {
+            use_templates = true;
+        } else if (arg == "--lockstep") {
+            lockstep = true;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            output_folder = arg;
+        }
+    }
+
+    if (lockstep && use_templates) {
+        std::cerr << "--lockstep needs the grid image, which --templates does not write" << std::endl;
+        return 1;
+    }
+
+    // Ensure output folder ends with a trailing slash
+    if (!output_folder.empty() && output_folder.back() != '/') {
+        output_folder += '/';
+    }
+    std::string mkdir_cmd = "mkdir -p " + output_folder;
+    if (system(mkdir_cmd.c_str()) != 0) {
+        std::cerr << "Warning: Failed to create output directory: " << output_folder << std::endl;
+    }
+
+    NullBuffer null_buffer;
+    std::streambuf* cout_buffer = std::cout.rdbuf();
+    if (!verbose) {
+        std::cout.rdbuf(&null_buffer);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // Programs to assemble: one per PE, or one per template assembled for PE 0
+    std::map<int, std::string> programs;
+    DFGProcessor::ProgramTemplates templates;
+    DFGProcessor processor(output_folder);
+    try {
+        processor.loadConfig(yaml_file);
+        if (use_templates) {
+            templates = processor.generateTemplates(num_threads);
+            for (size_t t = 0; t < templates.programs.size(); t++) {
+                programs[t] = std::move(templates.programs[t]);
+            }
+        } else {
+            programs = processor.generatePrograms(num_threads);
+        }
+        processor.writeTileSchedule();
+    } catch (const YAML::Exception& e) {
+        std::cout.rdbuf(cout_buffer);
+        std::cerr << "Error processing YAML file: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::exception& e) {
+        std::cout.rdbuf(cout_buffer);
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    auto generated = std::chrono::steady_clock::now();
+
+    // Assemble every program into its own slot, the encoder tables are
+    // read-only so all workers share one assembler
+    std::vector<std::pair<int, const std::string*>> jobs;
+    for (const auto& [id, program] : programs) {
+        jobs.push_back({id, &program});
+    }
+    std::vector<std::vector<std::string>> memory_entries(jobs.size());
+    std::vector<std::map<int, std::vector<std::string>>> overlay_entries(jobs.size());
+    std::vector<KiraObject> objects(jobs.size());
+    std::vector<int> results(jobs.size());
+    RISC_V_Assembler assembler;
+    assembler.listing = verbose;
+    parallelFor(jobs.size(), num_threads, [&](size_t i) {
+        std::istringstream source(*jobs[i].second);
+        results[i] = assembler.assembleSource(source, use_templates ? 0 : jobs[i].first, nullptr, nullptr,
+                                              &memory_entries[i], &overlay_entries[i], &objects[i]);
+    });
+    auto assembled = std::chrono::steady_clock::now();
+    std::cout.rdbuf(cout_buffer);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (results[i] != 0) {
+            std::cerr << "Error assembling " << (use_templates ? "template " : "PE ") << jobs[i].first << std::endl;
+            return 1;
+        }
+    }
+
+    std::string combined_mem_file_path = output_folder + "combined_memory.mem";
+    std::string template_mem_file_path = output_folder + "template_memory.mem";
+    std::string grid_image_path = output_folder + "grid_image.kgi";
+    std::string image_path;
+    int total_pes;
+    std::map<int, std::map<int, std::vector<std::string>>> all_overlay_entries;
+    if (use_templates) {
+        image_path = template_mem_file_path;
+        total_pes = writeTemplateMemory(image_path, templates.slot_registers, memory_entries, templates.patches);
+        std::remove(combined_mem_file_path.c_str());
+        // The harness prefers the grid image, which has no base constant patches
+        std::remove(grid_image_path.c_str());
+
+        // Overlay segments do not hold base constants, place the template
+        // segments at the address of every PE using them
+        for (const auto& [pe, patch] : templates.patches) {
+            for (const auto& [segment, entries] : overlay_entries[patch.first]) {
+                for (const auto& entry : entries) {
+                    uint32_t address = std::stoul(entry.substr(1, 8), nullptr, 16) | ((pe & 0xFF) << 10);
+                    std::stringstream mem_entry;
+                    mem_entry << "@" << std::hex << std::setw(8) << std::setfill('0') << address 
+                              << entry.substr(9);
+                    all_overlay_entries[pe][segment].push_back(mem_entry.str());
+                }
+            }
+        }
+    } else {
+        std::map<int, std::vector<std::string>> all_memory_entries;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            all_memory_entries[jobs[i].first] = std::move(memory_entries[i]);
+            all_overlay_entries[jobs[i].first] = std::move(overlay_entries[i]);
+        }
+        image_path = combined_mem_file_path;
+        total_pes = writeCombinedMemory(image_path, all_memory_entries);
+        std::remove(template_mem_file_path.c_str());
+
+        std::vector<const KiraObject*> linked;
+        for (const auto& object : objects) {
+            linked.push_back(&object);
+        }
+        if (total_pes >= 0 && writeGridImage(grid_image_path, linkGrid(linked, lockstep)) < 0) {
+            return 1;
+        }
+    }
+    if (total_pes < 0) {
+        return 1;
+    }
+    int total_segments = writeOverlayMemory(output_folder + "overlay_memory.mem", all_overlay_entries);
+    if (total_segments < 0) {
+        return 1;
+    }
+
+    // The assembly text is only a debugging artifact in this flow
+    if (emit_asm) {
+        for (const auto& [id, program] : programs) {
+            std::string name = (use_templates ? "template" : "pe") + std::to_string(id) + "_assembly.s";
+            std::ofstream outFile(output_folder + name);
+            outFile << program;
+        }
+    }
+
+    auto ms = [](auto from, auto to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    };
+    std::cout << "Compiled " << programs.size() << (use_templates ? " templates" : " PE programs") 
+              << " on " << num_threads << " threads" << std::endl;
+    std::cout << "  Code generation: " << std::fixed << std::setprecision(2)
+              << ms(start, generated) << " ms" << std::endl;
+    std::cout << "  Assembly:        " << ms(generated, assembled) << " ms" << std::endl;
+    std::cout << "Memory image created: " << image_path << " (" << total_pes << " PEs)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef KIRA_IMAGE_H
+#define KIRA_IMAGE_H
+
+// On-disk layouts of the binary toolchain files. Everything is stored as
+// little-endian 32-bit words, so a file can be mapped and read in place.
+//
+// Object file (pe<N>_binary.kobj), one assembled PE program:
+//   ObjectHeader
+//   num_sections x { ObjectSectionHeader, num_words instruction words }
+//   num_symbols  x { ObjectSymbolHeader, name padded to a multiple of 4 bytes }
+//
+// Grid image (grid_image.kgi), every PE of the grid after linking:
+//   GridImageHeader
+//   num_sections   x GridSection     (runs of the shared word pool)
+//   num_placements x GridPlacement   (sorted by segment, then PE)
+//   num_lockstep   x GridLockstep    (sorted by PE)
+//   num_words instruction words
+// Identical sections of different PEs are stored once. A lockstep follower
+// has no execution placements, it fetches from its leader.
+
+#include <cstdint>
+
+constexpr uint32_t kObjectMagic = 0x4A424F4B;     // "KOBJ"
+constexpr uint32_t kGridImageMagic = 0x3149474B;  // "KGI1"
+constexpr uint32_t kImageVersion = 1;
+constexpr uint32_t kGridImageVersion = 2;  // Version 2 adds the lockstep table
+
+// Imem word offset of the preload section inside a PE
+constexpr uint32_t kPreloadBase = 1u << 9;
+
+// A lockstep leader and its followers sit in the same aligned block of 16
+// PEs. A harness whose grid instances are smaller loads the leader's code
+// into the followers it cannot pair.
+constexpr uint32_t kLockstepBlock = 16;
+
+struct ObjectHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pe;
+    uint32_t num_sections;
+    uint32_t num_symbols;
+};
+
+struct ObjectSectionHeader {
+    uint32_t is_execution;
+    uint32_t segment;      // imem overlay segment, 0 for the preload section
+    uint32_t num_words;
+};
+
+struct ObjectSymbolHeader {
+    uint32_t is_execution;
+    uint32_t segment;
+    uint32_t index;        // word index inside the section
+    uint32_t name_length;
+};
+
+struct GridImageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_pes;
+    uint32_t num_segments;
+    uint32_t num_sections;
+    uint32_t num_placements;
+    uint32_t num_lockstep;
+    uint32_t num_words;
+};
+
+struct GridSection {
+    uint32_t first_word;   // index into the word pool
+    uint32_t num_words;
+};
+
+// A section written to imem words [address, address + num_words) of a PE
+// before the given overlay segment runs
+struct GridPlacement {
+    uint32_t segment;
+    uint32_t pe;
+    uint32_t address;
+    uint32_t section;
+};
+
+// PE executing the instruction stream fetched by the imem of `leader`
+struct GridLockstep {
+    uint32_t pe;
+    uint32_t leader;
+};
+
+static_assert(sizeof(ObjectHeader) == 20 && sizeof(ObjectSectionHeader) == 12 &&
+              sizeof(ObjectSymbolHeader) == 16, "object layout");
+static_assert(sizeof(GridImageHeader) == 32 && sizeof(GridSection) == 8 &&
+              sizeof(GridPlacement) == 16 && sizeof(GridLockstep) == 8, "grid image layout");
+
+#endif // KIRA_IMAGE_H
@@ -0,0 +1,30 @@
+// Grid linker: places previously assembled pe<N>_binary.kobj objects into one
+// grid_image.kgi, so cached kernels can be combined without assembling again.
+#include "kira_object.h"
+
+int main(int argc, char* argv[]) {
+    bool lockstep = argc > 1 && std::string(argv[1]) == "--lockstep";
+    int first = lockstep ? 2 : 1;
+    if (argc < first + 2) {
+        std::cerr << "Usage: " << argv[0] << " [--lockstep] <grid_image> <object_file>..." << std::endl;
+        std::cerr << "  --lockstep: PEs with the same execution sections as a lower PE of their" << std::endl;
+        std::cerr << "              16-PE block fetch from that PE, their sections are not stored" << std::endl;
+        std::cerr << "  grid_image: Output file, e.g. output/<folder>/grid_image.kgi" << std::endl;
+        std::cerr << "  object_file: pe<N>_binary.kobj written by risc_v_assembler, a PE given" << std::endl;
+        std::cerr << "               twice keeps its last object" << std::endl;
+        return 1;
+    }
+
+    std::vector<KiraObject> objects(argc - first - 1);
+    for (int i = first + 1; i < argc; i++) {
+        if (!readObject(argv[i], objects[i - first - 1])) {
+            return 1;
+        }
+    }
+
+    std::vector<const KiraObject*> linked;
+    for (const auto& object : objects) {
+        linked.push_back(&object);
+    }
+    return writeGridImage(argv[first], linkGrid(linked, lockstep)) < 0 ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+#ifndef KIRA_OBJECT_H
+#define KIRA_OBJECT_H
+
+// Binary object files of single PE programs and the grid linker that places
+// them into one grid image. See kira_image.h for the file layouts.
+
+#include "kira_image.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+
+// Preload section or one overlay segment of the execution section
+struct ObjectSection {
+    bool is_execution = false;
+    int segment = 0;
+    std::vector<uint32_t> words;
+};
+
+struct ObjectSymbol {
+    std::string name;
+    bool is_execution = false;
+    int segment = 0;
+    int index = 0;
+};
+
+// An assembled PE program, sections are kept in load order
+struct KiraObject {
+    int pe = 0;
+    std::vector<ObjectSection> sections;
+    std::vector<ObjectSymbol> symbols;
+};
+
+// Linked program of the whole grid
+struct GridImage {
+    uint32_t num_pes = 0;
+    uint32_t num_segments = 1;
+    std::vector<GridSection> sections;
+    std::vector<GridPlacement> placements;
+    std::vector<GridLockstep> lockstep;
+    std::vector<uint32_t> words;
+};
+
+template <typename T>
+inline void writeRaw(std::ostream& out, const T* data, size_t count = 1) {
+    out.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+inline bool readRaw(std::istream& in, T* data, size_t count = 1) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(data), sizeof(T) * count));
+}
+
+inline bool writeObject(const std::string& path, const KiraObject& object) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Cannot create object file: " << path << std::endl;
+        return false;
+    }
+
+    ObjectHeader header{kObjectMagic, kImageVersion, uint32_t(object.pe),
+                        uint32_t(object.sections.size()), uint32_t(object.symbols.size())};
+    writeRaw(out, &header);
+    for (const auto& section : object.sections) {
+        ObjectSectionHeader section_header{section.is_execution, uint32_t(section.segment),
+                                           uint32_t(section.words.size())};
+        writeRaw(out, &section_header);
+        writeRaw(out, section.words.data(), section.words.size());
+    }
+    for (const auto& symbol : object.symbols) {
+        ObjectSymbolHeader symbol_header{symbol.is_execution, uint32_t(symbol.segment),
+                                         uint32_t(symbol.index), uint32_t(symbol.name.size())};
+        writeRaw(out, &symbol_header);
+        std::string name = symbol.name;
+        name.resize((name.size() + 3) & ~size_t(3), '\0');
+        out.write(name.data(), name.size());
+    }
+    return static_cast<bool>(out);
+}
+
+inline bool readObject(const std::string& path, KiraObject& object) {
+    std::ifstream in(path, std::ios::binary);
+    ObjectHeader header;
+    if (!in || !readRaw(in, &header) || header.magic != kObjectMagic || header.version != kImageVersion) {
+        std::cerr << "Error: Not a KIRA object file: " << path << std::endl;
+        return false;
+    }
+
+    object.pe = header.pe;
+    object.sections.resize(header.num_sections);
+    for (auto& section : object.sections) {
+        ObjectSectionHeader section_header;
+        if (!readRaw(in, &section_header)) break;
+        section.is_execution = section_header.is_execution != 0;
+        section.segment = section_header.segment;
+        section.words.resize(section_header.num_words);
+        if (!readRaw(in, section.words.data(), section.words.size())) break;
+    }
+    object.symbols.resize(header.num_symbols);
+    for (auto& symbol : object.symbols) {
+        ObjectSymbolHeader symbol_header;
+        if (!readRaw(in, &symbol_header)) break;
+        symbol.is_execution = symbol_header.is_execution != 0;
+        symbol.segment = symbol_header.segment;
+        symbol.index = symbol_header.index;
+        std::string name((symbol_header.name_length + 3) & ~uint32_t(3), '\0');
+        if (!in.read(&name[0], name.size())) break;
+        symbol.name = name.substr(0, symbol_header.name_length);
+    }
+    if (!in) {
+        std::cerr << "Error: Truncated object file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Place the objects into one grid image. A PE given twice keeps its last
+// object. Sections with identical words, e.g. the execution sections of the
+// same PE role in every cluster, share one run of the word pool. The
+// placements keep the write order of combined_memory.mem and
+// overlay_memory.mem: segment by segment, PE by PE, sections in object order.
+// With lockstep, a PE whose execution sections match those of a lower PE of
+// its kLockstepBlock follows that PE and drops its execution placements.
+inline GridImage linkGrid(const std::vector<const KiraObject*>& objects, bool lockstep = false) {
+    std::map<int, const KiraObject*> by_pe;
+    for (const KiraObject* object : objects) {
+        by_pe[object->pe] = object;
+    }
+
+    GridImage image;
+    std::map<std::vector<uint32_t>, uint32_t> shared;
+    for (const auto& [pe, object] : by_pe) {
+        if (pe != 0xFFFF) {  // Don't count unknown PEs
+            image.num_pes = std::max<uint32_t>(image.num_pes, pe + 1);
+        }
+        for (const auto& section : object->sections) {
+            if (section.words.empty()) continue;
+            auto [it, inserted] = shared.emplace(section.words, uint32_t(image.sections.size()));
+            if (inserted) {
+                image.sections.push_back({uint32_t(image.words.size()), uint32_t(section.words.size())});
+                image.words.insert(image.words.end(), section.words.begin(), section.words.end());
+            }
+            image.placements.push_back({uint32_t(section.segment), uint32_t(pe),
+                                        section.is_execution ? 0 : kPreloadBase, it->second});
+            image.num_segments = std::max<uint32_t>(image.num_segments, section.segment + 1);
+        }
+    }
+    if (lockstep) {
+        // Execution sections of every PE as (segment, section) pairs, a
+        // leader is the first PE of its block with the same list
+        std::map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> execution;
+        for (const auto& placement : image.placements) {
+            if (placement.address == 0) {
+                execution[placement.pe].push_back({placement.segment, placement.section});
+            }
+        }
+        std::map<std::pair<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>>, uint32_t> leaders;
+        for (const auto& [pe, sections] : execution) {
+            if (pe == 0xFFFF) continue;
+            auto [it, inserted] = leaders.emplace(std::make_pair(pe / kLockstepBlock, sections), pe);
+            if (!inserted) {
+                image.lockstep.push_back({pe, it->second});
+            }
+        }
+        image.placements.erase(std::remove_if(image.placements.begin(), image.placements.end(),
+            [&](const GridPlacement& placement) {
+                return placement.address == 0 && 
+                       std::any_of(image.lockstep.begin(), image.lockstep.end(),
+                                   [&](const GridLockstep& entry) { return entry.pe == placement.pe; });
+            }), image.placements.end());
+    }
+    std::stable_sort(image.placements.begin(), image.placements.end(),
+                     [](const GridPlacement& a, const GridPlacement& b) { return a.segment < b.segment; });
+    return image;
+}
+
+// Write the linked image, returns the number of PEs or -1 on error
+inline int writeGridImage(const std::string& path, const GridImage& image) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Cannot create grid image: " << path << std::endl;
+        return -1;
+    }
+    GridImageHeader header{kGridImageMagic, kGridImageVersion, image.num_pes, image.num_segments,
+                           uint32_t(image.sections.size()), uint32_t(image.placements.size()),
+                           uint32_t(image.lockstep.size()), uint32_t(image.words.size())};
+    writeRaw(out, &header);
+    writeRaw(out, image.sections.data(), image.sections.size());
+    writeRaw(out, image.placements.data(), image.placements.size());
+    writeRaw(out, image.lockstep.data(), image.lockstep.size());
+    writeRaw(out, image.words.data(), image.words.size());
+    if (!out) {
+        std::cerr << "Error: Cannot write grid image: " << path << std::endl;
+        return -1;
+    }
+
+    size_t placed_words = 0;
+    for (const auto& placement : image.placements) {
+        placed_words += image.sections[placement.section].num_words;
+    }
+    std::cout << "Grid image created: " << path << " (" << image.num_pes << " PEs, "
+              << image.num_segments << " segments, " << image.words.size() << " of "
+              << placed_words << " words stored";
+    if (!image.lockstep.empty()) {
+        std::cout << ", " << image.lockstep.size() << " lockstep followers";
+    }
+    std::cout << ")" << std::endl;
+    return image.num_pes;
+}
+
+inline bool readGridImage(const std::string& path, GridImage& image) {
+    std::ifstream in(path, std::ios::binary);
+    GridImageHeader header;
+    if (!in || !readRaw(in, &header) || header.magic != kGridImageMagic || header.version != kGridImageVersion) {
+        std::cerr << "Error: Not a KIRA grid image: " << path << std::endl;
+        return false;
+    }
+    image.num_pes = header.num_pes;
+    image.num_segments = header.num_segments;
+    image.sections.resize(header.num_sections);
+    image.placements.resize(header.num_placements);
+    image.lockstep.resize(header.num_lockstep);
+    image.words.resize(header.num_words);
+    if (!readRaw(in, image.sections.data(), image.sections.size()) ||
+        !readRaw(in, image.placements.data(), image.placements.size()) ||
+        !readRaw(in, image.lockstep.data(), image.lockstep.size()) ||
+        !readRaw(in, image.words.data(), image.words.size())) {
+        std::cerr << "Error: Truncated grid image: " << path << std::endl;
+        return false;
+    }
+    for (const auto& section : image.sections) {
+        if (uint64_t(section.first_word) + section.num_words > image.words.size()) {
+            std::cerr << "Error: Grid image section exceeds the word pool: " << path << std::endl;
+            return false;
+        }
+    }
+    for (const auto& placement : image.placements) {
+        if (placement.section >= image.sections.size()) {
+            std::cerr << "Error: Grid image placement uses an unknown section: " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // KIRA_OBJECT_H
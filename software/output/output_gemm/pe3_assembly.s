@@ -36,30 +36,25 @@ _start:
     ppsrf.addi v13, v12, 11
     corf.addi c12, c12, 256
     corf.addi c13, c12, 4
-    # Using var=2 (registers 12-17)
-    ppsrf.addi v12, v12, 10
-    ppsrf.addi v13, v12, 11
-    corf.addi c12, c12, 256
-    corf.addi c13, c12, 4
+    # var=2 (registers 12-17) already loaded
 
     # ========== Execution Section Begin ==========
-    # hwl_imm_1 = ((2 << 23) + (9 << 17) + (10 << 12) + 8
-    # Original pc_start=2, pc_stop=11, delay=0
-    hwlrf.lui L1, 4394
-    hwlrf.addi L1, L1, 8
-    # hwl_imm_2 = ((4 << 23) + (7 << 17) + (11 << 12) + 64
-    # Original pc_start=4, pc_stop=11, delay=0
-    hwlrf.lui L2, 8427
-    hwlrf.addi L2, L2, 64
-    # hwl_imm_3 = ((6 << 23) + (5 << 17) + (12 << 12) + 64
-    # Original pc_start=6, pc_stop=11, delay=0
-    hwlrf.lui L3, 12460
-    hwlrf.addi L3, L3, 64
+    # hwl 1: pc_start=2, pc_stop=10
+    hwlrf L1, hwl1_start, hwl1_end, 10, 8
+hwl1_start:
+    # hwl 2: pc_start=4, pc_stop=10
+    hwlrf L2, hwl2_start, hwl2_end, 11, 64
+hwl2_start:
+    # hwl 3: pc_start=6, pc_stop=10
+    hwlrf L3, hwl3_start, hwl3_end, 12, 64
+hwl3_start:
     psrf.lw x1, 0(x18)
     psrf.lw x2, 1(x19)
     psrf.lw x3, 2(x20)
-    mul x1, x1, x2
-    add x3, x3, x1
+    mac.fxp x3, x1, x2
+hwl1_end:
+hwl2_end:
+hwl3_end:
     psrf.sw x3, 2(x20)
     # End of program
     ret
@@ -0,0 +1,110 @@
+# Assembly for PE1 (Cluster 1)
+# Generated with PSRF, HWL and function support
+.text
+.global _start
+
+_start:
+    # Base address loading section for cluster 1
+    # Loading x18 with address 0x8C8 (2248)
+    # Using lui 1 and addi -1848 to create 2248
+    lui x18, 1
+    addi x18, x18, -1848
+
+    # Loading x19 with address 0x4E20 (20000)
+    # Using lui 5 and addi -480 to create 20000
+    lui x19, 5
+    addi x19, x19, -480
+
+    # Loading x20 with address 0xA444 (42052)
+    # Using lui 10 and addi 1092 to create 42052
+    lui x20, 10
+    addi x20, x20, 1092
+
+    # Preload section for PSRF variables and coefficients
+    # Using var=2 (registers 12-17)
+    ppsrf.addi v12, v12, 10
+    ppsrf.addi v13, v12, 11
+    corf.addi c12, c12, 256
+    corf.addi c13, c12, 4
+    # Using var=0 (registers 0-5)
+    ppsrf.addi v0, v0, 10
+    ppsrf.addi v1, v0, 12
+    corf.addi c0, c0, 256
+    corf.addi c1, c0, 32
+    # Using var=1 (registers 6-11)
+    ppsrf.addi v6, v6, 12
+    ppsrf.addi v7, v6, 11
+    corf.addi c6, c6, 2048
+    corf.addi c7, c6, 4
+    # var=2 (registers 12-17) already loaded
+    # AGU offset registers
+    offs.addi o1, o1, 4
+    offs.addi o2, o2, 256
+    offs.addi o3, o3, 8
+    offs.addi o4, o4, 512
+    offs.addi o5, o5, 12
+    offs.addi o6, o6, 768
+    offs.addi o7, o7, 16
+    offs.addi o8, o8, 1024
+    offs.addi o9, o9, 20
+    offs.addi o10, o10, 1280
+    offs.addi o11, o11, 24
+    offs.addi o12, o12, 1536
+    offs.addi o13, o13, 28
+    offs.addi o14, o14, 1792
+
+    # ========== Execution Section Begin ==========
+    # hwl 1: pc_start=2, pc_stop=45
+    hwlrf L1, hwl1_start, hwl1_end, 10, 8
+hwl1_start:
+    # hwl 2: pc_start=4, pc_stop=45
+    hwlrf L2, hwl2_start, hwl2_end, 11, 64
+hwl2_start:
+    # hwl 3: pc_start=14, pc_stop=37
+    hwlrf L3, hwl3_start, hwl3_end, 12, 8
+    psrf.lw x3, 2(x20)
+    addi x4, x0, 0
+    addi x5, x0, 0
+    addi x6, x0, 0
+    addi x7, x0, 0
+    addi x8, x0, 0
+    addi x9, x0, 0
+    addi x10, x0, 0
+hwl3_start:
+    psrf.lw x11, 0(x18)
+    psrf.lw x12, 1(x19)
+    psrf.lw x13, 64(x18)
+    psrf.lw x14, 129(x19)
+    psrf.lw x15, 192(x18)
+    psrf.lw x16, 257(x19)
+    psrf.lw x17, 320(x18)
+    psrf.lw x21, 385(x19)
+    psrf.lw x22, 448(x18)
+    psrf.lw x23, 513(x19)
+    psrf.lw x24, 576(x18)
+    psrf.lw x25, 641(x19)
+    psrf.lw x27, 704(x18)
+    psrf.lw x28, 769(x19)
+    psrf.lw x1, 832(x18)
+    psrf.lw x2, 897(x19)
+    mac.fxp x3, x11, x12
+    mac.fxp x4, x13, x14
+    mac.fxp x5, x15, x16
+    mac.fxp x6, x17, x21
+    mac.fxp x7, x22, x23
+    mac.fxp x8, x24, x25
+    mac.fxp x9, x27, x28
+hwl3_end:
+    mac.fxp x10, x1, x2
+    add x3, x3, x4
+    add x3, x3, x5
+    add x3, x3, x6
+    add x3, x3, x7
+    add x3, x3, x8
+    add x3, x3, x9
+    add x3, x3, x10
+hwl1_end:
+hwl2_end:
+    psrf.sw x3, 2(x20)
+    # End of program
+    ret
@@ -0,0 +1,68 @@
+# Assembly for PE2 (Cluster 2)
+# Generated with PSRF, HWL and function support
+.text
+.global _start
+
+_start:
+    # Base address loading section for cluster 2
+    # Loading x18 with address 0x4C8 (1224)
+    addi x18, x18, 1224
+
+    # Loading x19 with address 0x4E20 (20000)
+    # Using lui 5 and addi -480 to create 20000
+    lui x19, 5
+    addi x19, x19, -480
+
+    # Loading x20 with address 0xA044 (41028)
+    # Using lui 10 and addi 68 to create 41028
+    lui x20, 10
+    addi x20, x20, 68
+
+    # Loading x27 with buffer stride 8192
+    lui x27, 2
+
+    # Preload section for PSRF variables and coefficients
+    # Using var=0 (registers 0-5)
+    ppsrf.addi v0, v0, 10
+    ppsrf.addi v1, v0, 12
+    corf.addi c0, c0, 256
+    corf.addi c1, c0, 4
+    # Using var=1 (registers 6-11)
+    ppsrf.addi v6, v6, 12
+    ppsrf.addi v7, v6, 11
+    corf.addi c6, c6, 256
+    corf.addi c7, c6, 4
+    # Using var=2 (registers 12-17)
+    ppsrf.addi v12, v12, 10
+    ppsrf.addi v13, v12, 11
+    corf.addi c12, c12, 256
+    corf.addi c13, c12, 4
+    # var=2 (registers 12-17) already loaded
+
+    # ========== Execution Section Begin ==========
+    # hwl 1: pc_start=2, pc_stop=10
+    hwlrf L1, hwl1_start, hwl1_end, 10, 2
+hwl1_start:
+    # hwl 2: pc_start=4, pc_stop=10
+    hwlrf L2, hwl2_start, hwl2_end, 11, 64
+hwl2_start:
+    # hwl 3: pc_start=6, pc_stop=10
+    hwlrf L3, hwl3_start, hwl3_end, 12, 64
+hwl3_start:
+    psrf.lw x1, 0(x18)
+    psrf.lw x2, 1(x19)
+    psrf.lw x3, 2(x20)
+    mac.fxp x3, x1, x2
+hwl1_end:
+hwl2_end:
+hwl3_end:
+    psrf.sw x3, 2(x20)
+    # ========== Buffer Swap Point ==========
+    add x18, x18, x27
+    sub x27, x0, x27
+    # Advancing x20 by 4096 bytes per tile
+    lui x28, 1
+    addi x28, x28, 0
+    add x20, x20, x28
+    # End of program
+    ret
@@ -0,0 +1,922 @@
+#ifndef RISC_V_ASSEMBLER_H
+#define RISC_V_ASSEMBLER_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <regex>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <cctype>
+#include "kira_object.h"
+
+struct AssembledInstruction {
+    std::string op;
+    uint32_t word = 0;
+    bool encoded = false;  // false for mnemonics the encoder does not know
+    std::string hex;
+    bool is_execution;
+    int segment = 0;  // imem overlay segment of execution instructions
+    int index = 0;    // word index inside its section and segment
+};
+
+// Label position, resolved against instructions of the same section and segment
+struct AssemblySymbol {
+    bool is_execution;
+    int segment;
+    int index;
+};
+
+// Operand fields patched in the second pass, once every label is known
+enum class RelocationType : uint8_t {
+    Branch,       // B-type byte offset to a label
+    Jump,         // jal offset to a label
+    HardwareLoop  // hwlrf pseudo-op, loop body from the start to the end label
+};
+
+struct Relocation {
+    RelocationType type = RelocationType::Branch;
+    size_t instruction = 0;  // first assembled word of the instruction
+    std::string symbol;
+    std::string end_symbol;  // last body instruction of a HardwareLoop
+    uint32_t loop_register = 0;
+    uint32_t hwl_index = 0;
+    uint32_t iterations = 0;
+    std::string line;
+};
+
+// Operand layouts of the integer encoder. PSRF loads and stores share the
+// I-type layout, the stored register of psrf.sw/psrf.sb goes into rd.
+enum class EncodingFormat : uint8_t {
+    R,          // op rd, rs1, rs2
+    Shift,      // op rd, rs1, shamt (R layout, shamt in rs2)
+    I,          // op rd, rs1, imm
+    Load,       // op rd, imm(rs1)
+    S,          // op rs2, imm(rs1)
+    B,          // op rs1, rs2, imm
+    U,          // op rd, imm
+    J,          // op rd, imm
+    PsrfMem,    // op reg, imm(rs1)
+    PpsrfAddi,  // op vd, vs1, imm
+    CorfAddi,   // op cd, cs1, imm
+    OffsAddi,   // op od, os1, imm
+    CorfLui,    // op cd, imm
+    HwlrfAddi,  // op Ld, Ls1, imm
+    HwlrfLui,   // op Ld, imm
+    Delay,      // op cycles, unsigned 12-bit cycle count in the I immediate
+    Nop         // ret / nop, encoded as addi x0, x0, 0; halt as the all-zero word that stops a PE
+};
+
+struct EncodingEntry {
+    const char* mnemonic;
+    EncodingFormat format;
+    uint32_t opcode;
+    uint32_t funct3;
+    uint32_t funct7;
+};
+
+static constexpr EncodingEntry kEncodingTable[] = {
+    {"lb",   EncodingFormat::Load, 0x03, 0, 0}, {"lh",  EncodingFormat::Load, 0x03, 1, 0},
+    {"lw",   EncodingFormat::Load, 0x03, 2, 0}, {"lbu", EncodingFormat::Load, 0x03, 4, 0},
+    {"lhu",  EncodingFormat::Load, 0x03, 5, 0},
+
+    {"addi",  EncodingFormat::I, 0x13, 0, 0}, {"slti", EncodingFormat::I, 0x13, 2, 0},
+    {"sltiu", EncodingFormat::I, 0x13, 3, 0}, {"xori", EncodingFormat::I, 0x13, 4, 0},
+    {"ori",   EncodingFormat::I, 0x13, 6, 0}, {"andi", EncodingFormat::I, 0x13, 7, 0},
+    {"jalr",  EncodingFormat::I, 0x67, 0, 0},
+    {"slli",  EncodingFormat::Shift, 0x13, 1, 0x00}, {"srli", EncodingFormat::Shift, 0x13, 5, 0x00},
+    {"srai",  EncodingFormat::Shift, 0x13, 5, 0x20},
+
+    {"sb", EncodingFormat::S, 0x23, 0, 0}, {"sh", EncodingFormat::S, 0x23, 1, 0},
+    {"sw", EncodingFormat::S, 0x23, 2, 0},
+
+    {"add",  EncodingFormat::R, 0x33, 0, 0x00}, {"sub", EncodingFormat::R, 0x33, 0, 0x20},
+    {"sll",  EncodingFormat::R, 0x33, 1, 0x00}, {"slt", EncodingFormat::R, 0x33, 2, 0x00},
+    {"sltu", EncodingFormat::R, 0x33, 3, 0x00}, {"xor", EncodingFormat::R, 0x33, 4, 0x00},
+    {"srl",  EncodingFormat::R, 0x33, 5, 0x00}, {"sra", EncodingFormat::R, 0x33, 5, 0x20},
+    {"or",   EncodingFormat::R, 0x33, 6, 0x00}, {"and", EncodingFormat::R, 0x33, 7, 0x00},
+    {"mul",  EncodingFormat::R, 0x33, 0, 0x01},
+    {"mac",  EncodingFormat::R, 0x33, 0, 0x02}, {"mac.fxp", EncodingFormat::R, 0x33, 0, 0x03},
+    {"dot4", EncodingFormat::R, 0x33, 0, 0x04},
+
+    {"lui", EncodingFormat::U, 0x37, 0, 0}, {"auipc", EncodingFormat::U, 0x17, 0, 0},
+
+    {"beq",  EncodingFormat::B, 0x63, 0, 0}, {"bne",  EncodingFormat::B, 0x63, 1, 0},
+    {"blt",  EncodingFormat::B, 0x63, 4, 0}, {"bge",  EncodingFormat::B, 0x63, 5, 0},
+    {"bltu", EncodingFormat::B, 0x63, 6, 0}, {"bgeu", EncodingFormat::B, 0x63, 7, 0},
+
+    {"jal", EncodingFormat::J, 0x6F, 0, 0},
+
+    {"psrf.lw",    EncodingFormat::PsrfMem, 0x04, 7, 0}, {"psrf.lb", EncodingFormat::PsrfMem, 0x04, 0, 0},
+    {"psrf.zd.lw", EncodingFormat::PsrfMem, 0x04, 6, 0}, {"psrf.ld2", EncodingFormat::PsrfMem, 0x04, 3, 0},
+    {"psrf.sw",    EncodingFormat::PsrfMem, 0x24, 4, 0}, {"psrf.sb", EncodingFormat::PsrfMem, 0x24, 0, 0},
+    {"ppsrf.addi", EncodingFormat::PpsrfAddi, 0x14, 1, 0},
+    {"corf.addi",  EncodingFormat::CorfAddi,  0x14, 0, 0},
+    {"offs.addi",  EncodingFormat::OffsAddi,  0x14, 3, 0},
+    {"corf.lui",   EncodingFormat::CorfLui,   0x3B, 0, 0},
+    {"hwlrf.addi", EncodingFormat::HwlrfAddi, 0x14, 2, 0},
+    {"hwlrf.lui",  EncodingFormat::HwlrfLui,  0x3C, 0, 0},
+    {"delay",      EncodingFormat::Delay,     0x0B, 0, 0},
+
+    {"ret", EncodingFormat::Nop, 0x13, 0, 0}, {"nop", EncodingFormat::Nop, 0x13, 0, 0},
+    {"halt", EncodingFormat::Nop, 0x00, 0, 0},
+};
+
+// Field packers, immediates are truncated to their field width
+constexpr uint32_t encode_r(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, 
+                            uint32_t rd, uint32_t opcode) {
+    return (funct7 << 25) | ((rs2 & 0x1F) << 20) | ((rs1 & 0x1F) << 15) | (funct3 << 12) | 
+           ((rd & 0x1F) << 7) | opcode;
+}
+
+constexpr uint32_t encode_i(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return ((uint32_t(imm) & 0xFFF) << 20) | ((rs1 & 0x1F) << 15) | (funct3 << 12) | 
+           ((rd & 0x1F) << 7) | opcode;
+}
+
+constexpr uint32_t encode_s(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+    uint32_t u = uint32_t(imm) & 0xFFF;
+    return ((u >> 5) << 25) | ((rs2 & 0x1F) << 20) | ((rs1 & 0x1F) << 15) | (funct3 << 12) | 
+           ((u & 0x1F) << 7) | opcode;
+}
+
+constexpr uint32_t encode_b(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+    uint32_t u = uint32_t(imm) & 0x1FFF;
+    return (((u >> 12) & 0x1) << 31) | (((u >> 5) & 0x3F) << 25) | ((rs2 & 0x1F) << 20) | 
+           ((rs1 & 0x1F) << 15) | (funct3 << 12) | (((u >> 1) & 0xF) << 8) | 
+           (((u >> 11) & 0x1) << 7) | opcode;
+}
+
+constexpr uint32_t encode_u(int32_t imm, uint32_t rd, uint32_t opcode) {
+    return ((uint32_t(imm) & 0xFFFFF) << 12) | ((rd & 0x1F) << 7) | opcode;
+}
+
+// The JAL offset is taken as given: imm[20] | imm[9:0] | imm[10] | imm[19:12],
+// the layout the KIRA core decodes
+constexpr uint32_t encode_j(int32_t imm, uint32_t rd, uint32_t opcode) {
+    uint32_t u = uint32_t(imm) & 0x1FFFFF;
+    return (((u >> 20) & 0x1) << 31) | ((u & 0x3FF) << 21) | (((u >> 10) & 0x1) << 20) | 
+           (((u >> 12) & 0xFF) << 12) | ((rd & 0x1F) << 7) | opcode;
+}
+
+static_assert(encode_i(0, 0, 0, 0, 0x13) == 0x00000013, "nop");
+static_assert(encode_r(0x01, 3, 2, 0, 1, 0x33) == 0x023100b3, "mul x1, x2, x3");
+static_assert(encode_s(8, 9, 18, 2, 0x23) == 0x00992423, "sw x9, 8(x18)");
+static_assert(encode_b(-4, 2, 1, 1, 0x63) == 0xfe209ee3, "bne x1, x2, -4");
+
+class RISC_V_Assembler {
+private:
+    // Helper function to trim whitespace from start and end of string
+    std::string trim_string(const std::string& str) const {
+        size_t first = str.find_first_not_of(" \t\n\r\f\v");
+        if (std::string::npos == first) {
+            return "";
+        }
+        size_t last = str.find_last_not_of(" \t\n\r\f\v");
+        return str.substr(first, (last - first + 1));
+    }
+
+    // Number of register "<prefix><n>" with first <= n <= last. Names outside
+    // the register file encode as register 0.
+    static uint32_t parse_register(const std::string& name, char prefix, int first = 0, int last = 31) {
+        if (name.size() < 2 || name.size() > 3 || name[0] != prefix) return 0;
+        if (name.size() == 3 && name[1] == '0') return 0;
+        int value = 0;
+        for (size_t i = 1; i < name.size(); i++) {
+            if (name[i] < '0' || name[i] > '9') return 0;
+            value = value * 10 + (name[i] - '0');
+        }
+        return (value >= first && value <= last) ? value : 0;
+    }
+
+    // Decimal operand without a sign, up to 9 digits. Anything else returns
+    // false instead of throwing, so the caller can report the line.
+    static bool parse_unsigned(const std::string& text, uint32_t& value) {
+        if (text.empty() || text.size() > 9) return false;
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    // Split "imm(reg)" into its immediate and register
+    bool parse_offset_base(const std::string& offset_base, int& offset, std::string& base_reg) const {
+        size_t open_paren = offset_base.find('(');
+        size_t close_paren = offset_base.find(')', open_paren);
+        if (open_paren == std::string::npos || close_paren == std::string::npos) {
+            return false;
+        }
+        std::string offset_str = trim_string(offset_base.substr(0, open_paren));
+        base_reg = trim_string(offset_base.substr(open_paren + 1, close_paren - open_paren - 1));
+        offset = offset_str.empty() ? 0 : std::stoi(offset_str);
+        return true;
+    }
+
+public:
+    static const EncodingEntry* find_encoding(const std::string& mnemonic) {
+        static const std::unordered_map<std::string, const EncodingEntry*> index = []() {
+            std::unordered_map<std::string, const EncodingEntry*> table;
+            for (const auto& entry : kEncodingTable) {
+                table[entry.mnemonic] = &entry;
+            }
+            return table;
+        }();
+        auto it = index.find(mnemonic);
+        return it == index.end() ? nullptr : it->second;
+    }
+
+    // Print every assembled instruction to the console
+    bool listing = true;
+
+    // "@AAAAAAAA HHHHHHHH" line of the .mem files
+    static std::string mem_entry(uint32_t address, const std::string& hex) {
+        char buffer[12];
+        std::snprintf(buffer, sizeof(buffer), "@%08x ", address);
+        return buffer + hex;
+    }
+
+    static std::string to_hex(uint32_t word) {
+        char buffer[9];
+        std::snprintf(buffer, sizeof(buffer), "%08x", word);
+        return buffer;
+    }
+
+    // Encode one instruction from its table entry and operands. Returns false
+    // if the operands do not match the format.
+    bool encode(const EncodingEntry& e, const std::vector<std::string>& args, uint32_t& word) const {
+        int offset = 0;
+        std::string base_reg;
+        switch (e.format) {
+            case EncodingFormat::R:
+                if (args.size() < 3) return false;
+                word = encode_r(e.funct7, parse_register(args[2], 'x'), parse_register(args[1], 'x'), 
+                                e.funct3, parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::Shift:
+                if (args.size() < 3) return false;
+                word = encode_r(e.funct7, std::stoi(args[2]), parse_register(args[1], 'x'), 
+                                e.funct3, parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::I:
+                if (args.size() < 3) return false;
+                word = encode_i(std::stoi(args[2]), parse_register(args[1], 'x'), e.funct3, 
+                                parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::Load:
+            case EncodingFormat::PsrfMem:
+                if (args.size() < 2 || !parse_offset_base(args[1], offset, base_reg)) return false;
+                word = encode_i(offset, parse_register(base_reg, 'x'), e.funct3, 
+                                parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::S:
+                if (args.size() < 2 || !parse_offset_base(args[1], offset, base_reg)) return false;
+                word = encode_s(offset, parse_register(args[0], 'x'), parse_register(base_reg, 'x'), 
+                                e.funct3, e.opcode);
+                return true;
+            case EncodingFormat::B:
+                if (args.size() < 3) return false;
+                word = encode_b(std::stoi(args[2]), parse_register(args[1], 'x'), 
+                                parse_register(args[0], 'x'), e.funct3, e.opcode);
+                return true;
+            case EncodingFormat::U:
+                if (args.size() < 2) return false;
+                word = encode_u(std::stoi(args[1]), parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::J:
+                if (args.size() < 2) return false;
+                word = encode_j(std::stoi(args[1]), parse_register(args[0], 'x'), e.opcode);
+                return true;
+            case EncodingFormat::PpsrfAddi:
+                if (args.size() < 3) return false;
+                word = encode_i(std::stoi(args[2]), parse_register(args[1], 'v'), e.funct3, 
+                                parse_register(args[0], 'v'), e.opcode);
+                return true;
+            case EncodingFormat::CorfAddi:
+                if (args.size() < 3) return false;
+                word = encode_i(std::stoi(args[2]), parse_register(args[1], 'c'), e.funct3, 
+                                parse_register(args[0], 'c'), e.opcode);
+                return true;
+            case EncodingFormat::OffsAddi:
+                if (args.size() < 3) return false;
+                word = encode_i(std::stoi(args[2]), parse_register(args[1], 'o', 0, 15), e.funct3, 
+                                parse_register(args[0], 'o', 0, 15), e.opcode);
+                return true;
+            case EncodingFormat::CorfLui:
+                if (args.size() < 2) return false;
+                word = encode_u(std::stoi(args[1]), parse_register(args[0], 'c'), e.opcode);
+                return true;
+            case EncodingFormat::HwlrfAddi:
+                if (args.size() < 3) return false;
+                word = encode_i(std::stoi(args[2]), parse_register(args[1], 'L', 1, 7), e.funct3, 
+                                parse_register(args[0], 'L', 1, 7), e.opcode);
+                return true;
+            case EncodingFormat::HwlrfLui:
+                if (args.size() < 2) return false;
+                word = encode_u(std::stoi(args[1]), parse_register(args[0], 'L', 1, 7), e.opcode);
+                return true;
+            case EncodingFormat::Delay: {
+                if (args.size() < 1) return false;
+                int cycles = std::stoi(args[0]);
+                if (cycles < 0 || cycles > 0xFFF) return false;
+                word = encode_i(cycles, 0, e.funct3, 0, e.opcode);
+                return true;
+            }
+            case EncodingFormat::Nop:
+                word = encode_i(0, 0, 0, 0, e.opcode);
+                return true;
+        }
+        return false;
+    }
+
+    // "name:" label definition at the start of a line, the remainder may hold
+    // an instruction
+    bool split_label(const std::string& line, std::string& label, std::string& rest) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos || colon == 0 || (line[0] >= '0' && line[0] <= '9')) {
+            return false;
+        }
+        for (size_t i = 0; i < colon; i++) {
+            char c = line[i];
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') {
+                return false;
+            }
+        }
+        label = line.substr(0, colon);
+        rest = trim_string(line.substr(colon + 1));
+        return true;
+    }
+
+    // Operands naming a label instead of a number
+    static bool is_symbol(const std::string& operand) {
+        return !operand.empty() && (std::isalpha(static_cast<unsigned char>(operand[0])) || 
+                                    operand[0] == '_' || operand[0] == '.');
+    }
+
+    // Split an instruction line into its mnemonic and comma separated operands
+    void split_operands(const std::string& line, std::string& op, std::vector<std::string>& args) {
+        size_t op_begin = line.find_first_not_of(" \t\n\r\f\v");
+        size_t op_end = line.find_first_of(" \t\n\r\f\v", op_begin);
+        op = op_begin == std::string::npos ? "" : line.substr(op_begin, op_end - op_begin);
+        std::string args_str = op_end == std::string::npos ? "" : trim_string(line.substr(op_end));
+        
+        args.clear();
+        size_t pos = 0;
+        std::string token;
+        bool in_parentheses = false;
+        
+        for (size_t i = 0; i < args_str.length(); i++) {
+            char c = args_str[i];
+            if (c == '(') {
+                in_parentheses = true;
+            } else if (c == ')') {
+                in_parentheses = false;
+            }
+            
+            if (c == ',' && !in_parentheses) {
+                // Found argument separator outside parentheses
+                token = trim_string(args_str.substr(pos, i - pos));
+                if (!token.empty()) {
+                    args.push_back(token);
+                }
+                pos = i + 1;
+            }
+        }
+        
+        // Add the last argument
+        if (pos < args_str.length()) {
+            token = trim_string(args_str.substr(pos));
+            if (!token.empty()) {
+                args.push_back(token);
+            }
+        }
+    }
+
+    // Encode an already split instruction, line is only used for the warning
+    AssembledInstruction encode_instruction(const std::string& op, const std::vector<std::string>& args,
+                                            const std::string& line) {
+        AssembledInstruction result;
+        result.op = op;
+        const EncodingEntry* entry = find_encoding(op);
+        if (entry != nullptr && encode(*entry, args, result.word)) {
+            result.encoded = true;
+            result.hex = to_hex(result.word);
+        } else {
+            std::cerr << "Warning: Cannot encode instruction: " << line << std::endl;
+        }
+        
+        return result;
+    }
+
+    // Parse a single assembly instruction line
+    AssembledInstruction parse_instruction(const std::string& line) {
+        std::string op;
+        std::vector<std::string> args;
+        split_operands(line, op, args);
+        return encode_instruction(op, args, line);
+    }
+
+    // Assemble program text held in memory in two passes, the first one
+    // records label positions, the second one resolves the label operands of
+    // branches, jal and the hwlrf pseudo-op. Hex words and mem entries are
+    // written to the optional streams, the memory entries of the base image and
+    // of later overlay segments are collected for the combined files, object
+    // receives the sections and labels for the grid linker. Console messages
+    // go to log, so concurrent calls can buffer them per PE.
+    int assembleSource(std::istream& source, int pe_number,
+                       std::ostream* hex_file = nullptr, std::ostream* mem_file = nullptr,
+                       std::vector<std::string>* memory_entries = nullptr,
+                       std::map<int, std::vector<std::string>>* overlay_entries = nullptr,
+                       KiraObject* object = nullptr,
+                       std::ostream& log = std::cout) {
+        // First pass: collect the instructions and the label positions. Word
+        // indices restart for every overlay segment, like the imem addresses.
+        std::vector<AssembledInstruction> assembled;
+        std::map<std::string, AssemblySymbol> symbols;
+        std::vector<Relocation> relocations;
+        int errors = 0;
+        
+        std::string line;
+        bool in_execution_section = false;
+        int segment = 0;
+        int preload_words = 0, execution_words = 0;
+
+        auto append = [&](AssembledInstruction instr) {
+            instr.is_execution = in_execution_section;
+            instr.segment = in_execution_section ? segment : 0;
+            instr.index = in_execution_section ? execution_words++ : preload_words++;
+            assembled.push_back(std::move(instr));
+        };
+        
+        while (std::getline(source, line)) {
+            std::string trimmed = trim_string(line);
+            if (!trimmed.empty() && trimmed[0] != '#') {
+                // Trailing comments
+                trimmed = trim_string(trimmed.substr(0, trimmed.find('#')));
+
+                std::string label, rest;
+                if (split_label(trimmed, label, rest)) {
+                    AssemblySymbol symbol{in_execution_section, in_execution_section ? segment : 0,
+                                          in_execution_section ? execution_words : preload_words};
+                    if (!symbols.emplace(label, symbol).second) {
+                        std::cerr << "Error: PE " << pe_number << ": label '" << label 
+                                  << "' is defined twice" << std::endl;
+                        errors++;
+                    }
+                    trimmed = rest;
+                }
+            }
+
+            // Skip empty lines, comments, directives and other lines with colons
+            if (trimmed.empty() || trimmed[0] == '#' || trimmed[0] == '.' || 
+                trimmed[0] == '_' || trimmed.find(':') != std::string::npos) {
+                
+                // Check for execution section marker
+                if (trimmed.find("Execution Section Begin") != std::string::npos) {
+                    in_execution_section = true;
+                }
+                // Each overlay segment restarts at the beginning of the execution section
+                if (in_execution_section && trimmed.find("Overlay Segment") != std::string::npos) {
+                    segment++;
+                    execution_words = 0;
+                }
+                continue;
+            }
+
+            std::string op;
+            std::vector<std::string> args;
+            split_operands(trimmed, op, args);
+
+            // hwlrf Lk, start_label, end_label, hwl_index, iterations expands to
+            // the hwlrf.lui/hwlrf.addi pair, filled in once the labels are known
+            if (op == "hwlrf") {
+                uint32_t hwl_index = 0, iterations = 0;
+                if (args.size() != 5 || !is_symbol(args[1]) || !is_symbol(args[2]) ||
+                    parse_register(args[0], 'L', 1, 7) == 0 || !parse_unsigned(args[3], hwl_index) ||
+                    !parse_unsigned(args[4], iterations)) {
+                    std::cerr << "Error: PE " << pe_number << ": expected hwlrf Lk, start_label, end_label, "
+                              << "hwl_index, iterations: " << trimmed << std::endl;
+                    errors++;
+                    continue;
+                }
+                Relocation relocation;
+                relocation.type = RelocationType::HardwareLoop;
+                relocation.instruction = assembled.size();
+                relocation.symbol = args[1];
+                relocation.end_symbol = args[2];
+                relocation.loop_register = parse_register(args[0], 'L', 1, 7);
+                relocation.hwl_index = hwl_index;
+                relocation.iterations = iterations;
+                relocation.line = trimmed;
+                relocations.push_back(relocation);
+
+                AssembledInstruction lui, addi;
+                lui.op = "hwlrf.lui";
+                addi.op = "hwlrf.addi";
+                append(lui);
+                append(addi);
+                continue;
+            }
+
+            // Label operands of branches and jal are encoded as 0 and patched
+            const EncodingEntry* entry = find_encoding(op);
+            if (entry != nullptr && (entry->format == EncodingFormat::B || entry->format == EncodingFormat::J)) {
+                size_t operand = entry->format == EncodingFormat::B ? 2 : 1;
+                if (operand < args.size() && is_symbol(args[operand])) {
+                    Relocation relocation;
+                    relocation.type = entry->format == EncodingFormat::B ? RelocationType::Branch : RelocationType::Jump;
+                    relocation.instruction = assembled.size();
+                    relocation.symbol = args[operand];
+                    relocation.line = trimmed;
+                    relocations.push_back(relocation);
+                    args[operand] = "0";
+                }
+            }
+            append(encode_instruction(op, args, trimmed));
+        }
+
+        // Second pass: resolve the label operands
+        for (const auto& relocation : relocations) {
+            AssembledInstruction& instr = assembled[relocation.instruction];
+            auto resolve = [&](const std::string& name) -> const AssemblySymbol* {
+                auto it = symbols.find(name);
+                if (it == symbols.end()) {
+                    std::cerr << "Error: PE " << pe_number << ": undefined label '" << name 
+                              << "' in: " << relocation.line << std::endl;
+                    errors++;
+                    return nullptr;
+                }
+                if (it->second.is_execution != instr.is_execution || it->second.segment != instr.segment) {
+                    std::cerr << "Error: PE " << pe_number << ": label '" << name 
+                              << "' is not in the section or overlay segment of: " << relocation.line << std::endl;
+                    errors++;
+                    return nullptr;
+                }
+                return &it->second;
+            };
+
+            const AssemblySymbol* target = resolve(relocation.symbol);
+            if (target == nullptr) continue;
+            int distance = target->index - instr.index;
+
+            switch (relocation.type) {
+                case RelocationType::Branch:
+                    // Byte offset from the branch
+                    if (distance * 4 < -4096 || distance * 4 > 4094) {
+                        std::cerr << "Error: PE " << pe_number << ": branch target out of range: " 
+                                  << relocation.line << std::endl;
+                        errors++;
+                        continue;
+                    }
+                    instr.word |= encode_b(distance * 4, 0, 0, 0, 0);
+                    break;
+                case RelocationType::Jump:
+                    // The core takes offset[10:1] from the operand bits [9:0], so the
+                    // jal operand counts half-words. Within +-2 KiB, i.e. any target in
+                    // a PE's imem, the sign bits of encode_j line up with the core.
+                    if (distance * 2 < -1024 || distance * 2 > 1023) {
+                        std::cerr << "Error: PE " << pe_number << ": jal target out of range: " 
+                                  << relocation.line << std::endl;
+                        errors++;
+                        continue;
+                    }
+                    instr.word |= encode_j(distance * 2, 0, 0);
+                    break;
+                case RelocationType::HardwareLoop: {
+                    const AssemblySymbol* end = resolve(relocation.end_symbol);
+                    if (end == nullptr) continue;
+                    // Body from the start label to the instruction at the end label,
+                    // pc_start is a word index into the segment
+                    int start = target->index;
+                    int length = end->index - start;
+                    if (start > 0x1FF || length < 0 || length > 0x3F || 
+                        relocation.hwl_index > 0x1F || relocation.iterations > 0xFFF) {
+                        std::cerr << "Error: PE " << pe_number << ": hardware loop does not fit the hwlrf "
+                                  << "fields (start " << start << ", length " << length << ", index " 
+                                  << relocation.hwl_index << ", iterations " << relocation.iterations 
+                                  << "): " << relocation.line << std::endl;
+                        errors++;
+                        continue;
+                    }
+                    uint32_t imm = (uint32_t(start) << 23) | (uint32_t(length) << 17) | 
+                                   (relocation.hwl_index << 12) | relocation.iterations;
+                    uint32_t lower = imm & 0xFFF;
+                    // hwlrf.addi sign extends its immediate
+                    uint32_t upper = ((imm >> 12) + ((lower & 0x800) ? 1 : 0)) & 0xFFFFF;
+                    const EncodingEntry& lui = *find_encoding("hwlrf.lui");
+                    const EncodingEntry& addi = *find_encoding("hwlrf.addi");
+                    uint32_t reg = relocation.loop_register;
+                    instr.word = encode_u(upper, reg, lui.opcode);
+                    instr.encoded = true;
+                    instr.hex = to_hex(instr.word);
+                    AssembledInstruction& second = assembled[relocation.instruction + 1];
+                    second.word = encode_i(lower, reg, addi.funct3, reg, addi.opcode);
+                    second.encoded = true;
+                    second.hex = to_hex(second.word);
+                    continue;
+                }
+            }
+            instr.hex = to_hex(instr.word);
+        }
+        if (errors > 0) {
+            return 1;
+        }
+        
+        // Print and save each assembled instruction
+        int preload_count = 0, execution_count = 0;
+        int current_segment = 0, execution_extent = 0;
+
+        // An overlay segment shorter than an earlier one clears the stale tail,
+        // so the PE still reaches an all-zero word and finishes
+        auto close_segment = [&]() {
+            if (current_segment > 0) {
+                for (int count = execution_count; count < execution_extent; count++) {
+                    std::string entry = mem_entry(((pe_number & 0xFF) << 10) | count, "00000000");
+                    if (mem_file != nullptr) {
+                        *mem_file << entry << '\n';
+                    }
+                    if (overlay_entries != nullptr) {
+                        (*overlay_entries)[current_segment].push_back(entry);
+                    }
+                    if (object != nullptr) {
+                        object->sections.back().words.push_back(0);
+                    }
+                }
+            }
+            execution_extent = std::max(execution_extent, execution_count);
+            if (execution_count > 512) {
+                std::cerr << "Warning: PE " << pe_number << " execution segment " << current_segment 
+                          << " has " << execution_count << " words and overlaps the preload section" << std::endl;
+            }
+        };
+
+        if (object != nullptr) {
+            object->pe = pe_number;
+            object->sections.clear();
+            object->symbols.clear();
+            for (const auto& [name, symbol] : symbols) {
+                object->symbols.push_back({name, symbol.is_execution, symbol.segment, symbol.index});
+            }
+        }
+
+        for (size_t i = 0; i < assembled.size(); i++) {
+            const auto& instr = assembled[i];
+
+            if (instr.is_execution && instr.segment != current_segment) {
+                close_segment();
+                current_segment = instr.segment;
+                execution_count = 0;
+                if (mem_file != nullptr) {
+                    *mem_file << "// Overlay segment " << current_segment << std::endl;
+                }
+            }
+
+            // A new section starts with the execution section and every overlay segment
+            if (object != nullptr) {
+                if (object->sections.empty() || object->sections.back().is_execution != instr.is_execution ||
+                    object->sections.back().segment != instr.segment) {
+                    object->sections.push_back({instr.is_execution, instr.segment, {}});
+                }
+                object->sections.back().words.push_back(instr.word);
+            }
+            
+            // Calculate memory address based on section
+            int address;
+            if (instr.is_execution) {
+                // Execution section: bit 10 = 0, PE number in bits [13:10]
+                address = ((pe_number & 0xFF) << 10) | execution_count;
+                execution_count++;
+            } else {
+                // Preload section: bit 10 = 1, PE number in bits [13:10]
+                // PE number occupies bits [13:10], bit 10 is set to 1 for preload
+                address = ((pe_number & 0xFF) << 10) | (1 << 9) | preload_count;
+                preload_count++;
+            }
+            
+            if (listing) {
+                log << std::setw(5) << i << ": " << instr.op 
+                          << " -> 0x" << instr.hex 
+                          << " (addr: 0x" << std::hex << address << std::dec << ")"
+                          << (instr.is_execution ? " [EXEC]" : " [PRELOAD]")
+                          << std::endl;
+            }
+            
+            // Write hex to file
+            if (hex_file != nullptr) {
+                *hex_file << instr.hex << '\n';
+            }
+            
+            // Create memory entry
+            std::string entry = mem_entry(address, instr.hex);
+            
+            // Write to individual mem file
+            if (mem_file != nullptr) {
+                *mem_file << entry << '\n';
+            }
+            
+            // Store for combined file if requested, later overlay segments go to
+            // the overlay file
+            if (instr.segment > 0) {
+                if (overlay_entries != nullptr) {
+                    (*overlay_entries)[instr.segment].push_back(entry);
+                }
+            } else if (memory_entries != nullptr) {
+                memory_entries->push_back(std::move(entry));
+            }
+        }
+        close_segment();
+        
+        log << "Preload instructions: " << preload_count << ", Execution instructions: " << execution_count << std::endl;
+        if (current_segment > 0) {
+            log << "Overlay segments: " << current_segment + 1 << std::endl;
+        }
+        
+        return 0;
+    }
+
+    // Main assembly function - reads input file, writes output files
+    int assemble(const std::string& input_file, const std::string& output_file, 
+                int pe_number = 0, const std::string& mem_file_path = "",
+                std::vector<std::string>* memory_entries = nullptr,
+                std::map<int, std::vector<std::string>>* overlay_entries = nullptr,
+                KiraObject* object = nullptr,
+                std::ostream& log = std::cout) {
+        // Read each line from input file
+        std::ifstream file(input_file);
+        if (!file) {
+            std::cerr << "Error: Cannot open input file" << std::endl;
+            return 1;
+        }
+        
+        log << "Input file: " << input_file << std::endl;
+        log << "Output file: " << output_file << std::endl;
+        log << "PE number: " << pe_number << " (will be encoded in bits [13:10])" << std::endl;
+        
+        // Use provided mem file path or create one based on output file
+        std::string actual_mem_file_path = mem_file_path.empty() ? 
+                                          output_file + ".mem" : mem_file_path;
+        
+        // Open output files
+        std::ofstream hex_file(output_file);
+        std::ofstream mem_file(actual_mem_file_path);
+        if (!hex_file || !mem_file) {
+            std::cerr << "Error: Cannot open output files" << std::endl;
+            return 1;
+        }
+        
+        int result = assembleSource(file, pe_number, &hex_file, &mem_file, memory_entries, overlay_entries, 
+                                    object, log);
+        
+        file.close();
+        hex_file.close();
+        mem_file.close();
+        
+        log << "Assembly conversion complete." << std::endl;
+        log << "Hex code written to: " << output_file << std::endl;
+        log << "Memory initialization written to: " << actual_mem_file_path << std::endl;
+        
+        return result;
+    }
+};
+
+// Write the combined memory image of all PEs, entries of unknown PEs (0xFFFF)
+// go last. Returns the number of PEs or -1 if the file cannot be created.
+inline int writeCombinedMemory(const std::string& path,
+                               const std::map<int, std::vector<std::string>>& all_memory_entries) {
+    std::ofstream combined_mem_file(path);
+    if (!combined_mem_file) {
+        std::cerr << "Error: Cannot create combined memory file: " << path << std::endl;
+        return -1;
+    }
+
+    // Write all memory entries to the combined file
+    combined_mem_file << "// Combined memory initialization file for all PEs" << std::endl;
+    combined_mem_file << "// Format: @ADDRESS HEX_INSTRUCTION" << std::endl;
+    
+    // Count the number of PEs
+    int total_pes = 0;
+    for (const auto& entry : all_memory_entries) {
+        if (entry.first != 0xFFFF) {  // Don't count unknown PEs
+            total_pes = std::max(total_pes, entry.first + 1);
+        }
+    }
+    
+    // Write the total number of PEs
+    combined_mem_file << "// Total PEs: " << total_pes << std::endl;
+    
+    // Write entries for each PE in order
+    for (int pe = 0; pe < total_pes; pe++) {
+        auto it = all_memory_entries.find(pe);
+        if (it != all_memory_entries.end()) {
+            combined_mem_file << std::endl << "// PE" << pe << " memory entries" << std::endl;
+            for (const auto& entry : it->second) {
+                combined_mem_file << entry << std::endl;
+            }
+        }
+    }
+    
+    // Then write entries for unknown PEs (0xFFFF)
+    auto unknown = all_memory_entries.find(0xFFFF);
+    if (unknown != all_memory_entries.end()) {
+        combined_mem_file << std::endl << "// Unknown PE memory entries" << std::endl;
+        for (const auto& entry : unknown->second) {
+            combined_mem_file << entry << std::endl;
+        }
+    }
+    
+    combined_mem_file.close();
+    return total_pes;
+}
+
+// Write the overlay segments, segment N is loaded before execution phase N.
+// Returns the number of segments (1 removes a stale overlay file) or -1 on error.
+inline int writeOverlayMemory(const std::string& path,
+                              const std::map<int, std::map<int, std::vector<std::string>>>& all_overlay_entries) {
+    int total_segments = 1;
+    for (const auto& [pe, segments] : all_overlay_entries) {
+        if (!segments.empty()) {
+            total_segments = std::max(total_segments, segments.rbegin()->first + 1);
+        }
+    }
+    if (total_segments > 1) {
+        std::ofstream overlay_mem_file(path);
+        if (!overlay_mem_file) {
+            std::cerr << "Error: Cannot create overlay memory file: " << path << std::endl;
+            return -1;
+        }
+        overlay_mem_file << "// Overlay memory file for all PEs" << std::endl;
+        overlay_mem_file << "// Format: @ADDRESS HEX_INSTRUCTION" << std::endl;
+        overlay_mem_file << "// Total Segments: " << total_segments << std::endl;
+        for (int segment = 1; segment < total_segments; segment++) {
+            overlay_mem_file << std::endl << "// Segment " << segment << std::endl;
+            for (const auto& [pe, segments] : all_overlay_entries) {
+                auto it = segments.find(segment);
+                if (it == segments.end()) continue;
+                overlay_mem_file << "// PE" << pe << " memory entries" << std::endl;
+                for (const auto& entry : it->second) {
+                    overlay_mem_file << entry << std::endl;
+                }
+            }
+        }
+        overlay_mem_file.close();
+        std::cout << "Overlay memory file created: " << path 
+                  << " (" << total_segments << " segments)" << std::endl;
+    } else {
+        // Do not leave a stale overlay image next to a fresh combined image
+        std::remove(path.c_str());
+    }
+    return total_segments;
+}
+
+// Write the template image: one program per template with the PE field of the
+// addresses cleared, followed by the patch table. Base register slot i is the
+// LUI/ADDI pair at preload words 2i and 2i+1 of a template. The loader writes
+// the template of every PE and re-encodes the pairs from the base constants.
+// Returns the number of PEs or -1 if the file cannot be created.
+inline int writeTemplateMemory(const std::string& path, const std::vector<std::string>& slot_registers,
+                               const std::vector<std::vector<std::string>>& template_entries,
+                               const std::map<int, std::pair<int, std::vector<int>>>& patches) {
+    std::ofstream template_mem_file(path);
+    if (!template_mem_file) {
+        std::cerr << "Error: Cannot create template memory file: " << path << std::endl;
+        return -1;
+    }
+
+    template_mem_file << "// Template memory file for all PEs" << std::endl;
+    template_mem_file << "// Format: @ADDRESS HEX_INSTRUCTION with PE field 0, then" << std::endl;
+    template_mem_file << "//         patch PE TEMPLATE BASE_CONSTANT..." << std::endl;
+    template_mem_file << "// Total PEs: " << patches.size() << std::endl;
+    template_mem_file << "// Total Templates: " << template_entries.size() << std::endl;
+    template_mem_file << "slots";
+    for (const auto& reg : slot_registers) {
+        template_mem_file << " " << reg;
+    }
+    template_mem_file << std::endl;
+
+    for (size_t t = 0; t < template_entries.size(); t++) {
+        template_mem_file << std::endl << "template " << t << std::endl;
+        for (const auto& entry : template_entries[t]) {
+            template_mem_file << entry << std::endl;
+        }
+    }
+
+    template_mem_file << std::endl << "// Patch table" << std::endl;
+    for (const auto& [pe, patch] : patches) {
+        template_mem_file << "patch " << pe << " " << patch.first;
+        for (int constant : patch.second) {
+            template_mem_file << " " << constant;
+        }
+        template_mem_file << std::endl;
+    }
+    template_mem_file.close();
+    return patches.size();
+}
+
+#endif // RISC_V_ASSEMBLER_H
@@ -0,0 +1,156 @@
+#include "risc_v_disassembler.h"
+
+// Prints one word per line. A hwlrf.addi completing the hwlrf.lui before it
+// also gets the loop fields as a comment.
+class Listing {
+private:
+    uint32_t previous = 0;
+
+public:
+    void print(const std::string& location, uint32_t word) {
+        std::cout << location << "  " << RISC_V_Assembler::to_hex(word) << "  "
+                  << RISC_V_Disassembler::disassemble(word);
+        bool is_hwlrf_addi = (word & 0x707F) == 0x2014;
+        bool after_hwlrf_lui = (previous & 0x7F) == 0x3C && ((previous >> 7) & 0x1F) == ((word >> 7) & 0x1F);
+        if (is_hwlrf_addi && after_hwlrf_lui) {
+            std::cout << "  # " << RISC_V_Disassembler::describe_hardware_loop(previous, word);
+        }
+        std::cout << '\n';
+        previous = word;
+    }
+
+    // Location of an imem address: PE field, preload or execution section
+    void print_address(uint32_t address, uint32_t word) {
+        char location[48];
+        std::snprintf(location, sizeof(location), "@%08x PE%-3u %-7s %3u", address, (address >> 10) & 0xFF,
+                      (address & 0x200) ? "preload" : "exec", address & 0x1FF);
+        print(location, word);
+    }
+};
+
+int disassembleGridImage(const std::string& path) {
+    GridImage image;
+    if (!readGridImage(path, image)) {
+        return 1;
+    }
+    std::cout << "// Grid image: " << image.num_pes << " PEs, " << image.num_segments << " segments, "
+              << image.sections.size() << " sections" << std::endl;
+    for (const auto& entry : image.lockstep) {
+        std::cout << "// PE" << entry.pe << " runs in lockstep with PE" << entry.leader << std::endl;
+    }
+    Listing listing;
+    uint32_t segment = ~0u;
+    for (const auto& placement : image.placements) {
+        if (placement.segment != segment) {
+            segment = placement.segment;
+            std::cout << "\n// Segment " << segment << std::endl;
+        }
+        const GridSection& section = image.sections[placement.section];
+        std::cout << "// PE" << placement.pe << " section " << placement.section << std::endl;
+        for (uint32_t w = 0; w < section.num_words; w++) {
+            listing.print_address((((placement.pe & 0xFF) << 10) | (placement.address + w)) & 0xFFFF,
+                                  image.words[section.first_word + w]);
+        }
+    }
+    return 0;
+}
+
+int disassembleObject(const std::string& path) {
+    KiraObject object;
+    if (!readObject(path, object)) {
+        return 1;
+    }
+    std::cout << "// Object of PE " << object.pe << ": " << object.sections.size() << " sections, "
+              << object.symbols.size() << " labels" << std::endl;
+    Listing listing;
+    for (const auto& section : object.sections) {
+        std::cout << "\n// " << (section.is_execution ? "Execution" : "Preload") << " section";
+        if (section.is_execution) {
+            std::cout << ", overlay segment " << section.segment;
+        }
+        std::cout << std::endl;
+        for (size_t w = 0; w < section.words.size(); w++) {
+            for (const auto& symbol : object.symbols) {
+                if (symbol.is_execution == section.is_execution && symbol.segment == section.segment &&
+                    symbol.index == int(w)) {
+                    std::cout << symbol.name << ":" << std::endl;
+                }
+            }
+            char location[16];
+            std::snprintf(location, sizeof(location), "%5u", unsigned(w));
+            listing.print(location, section.words[w]);
+        }
+    }
+    return 0;
+}
+
+// .mem images (per PE, combined, overlay and template) and .bin hex listings.
+// Comments and template directives are passed through.
+int disassembleText(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: Cannot open input file: " << path << std::endl;
+        return 1;
+    }
+    Listing listing;
+    std::string line;
+    int index = 0;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        std::istringstream fields(line[0] == '@' ? line.substr(1) : line);
+        std::string first, second;
+        fields >> first >> second;
+        try {
+            if (line[0] == '@' && !second.empty()) {
+                listing.print_address(std::stoul(first, nullptr, 16) & 0xFFFF, std::stoul(second, nullptr, 16));
+            } else if (line[0] != '@' && first.size() == 8 && second.empty() &&
+                       first.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos) {
+                char location[16];
+                std::snprintf(location, sizeof(location), "%5d", index++);
+                listing.print(location, std::stoul(first, nullptr, 16));
+            } else {
+                std::cout << (line.substr(0, 2) == "//" ? "" : "// ") << line << std::endl;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Failed to parse line: " << line << std::endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <image_file>" << std::endl;
+        std::cerr << "       " << argv[0] << " --verify [count] [seed] [num_threads]" << std::endl;
+        std::cerr << "  image_file: .mem, .bin, .kobj or .kgi file written by the toolchain" << std::endl;
+        std::cerr << "  --verify: Encode -> decode -> encode round trip of the whole instruction" << std::endl;
+        std::cerr << "            table with count random instructions and words (default: 10000000)" << std::endl;
+        return 1;
+    }
+
+    std::string arg = argv[1];
+    if (arg == "--verify") {
+        uint64_t count = (argc >= 3) ? std::stoull(argv[2]) : 10000000;
+        uint32_t seed = (argc >= 4) ? std::stoul(argv[3]) : 1;
+        unsigned num_threads = (argc >= 5) ? std::stoul(argv[4]) : defaultThreadCount();
+        RISC_V_Assembler assembler;
+        auto result = RISC_V_Disassembler::verify(assembler, count, seed, num_threads);
+        std::cout << "Round trip: " << result.instructions << " instructions, " << result.words
+                  << " decodable random words, " << result.mismatches << " mismatches" << std::endl;
+        std::cout << "Throughput: " << std::fixed << std::setprecision(0)
+                  << (result.instructions + result.words) / result.seconds << " round trips/s on " 
+                  << num_threads << " threads" << std::endl;
+        return result.mismatches == 0 ? 0 : 1;
+    }
+
+    auto ends_with = [&](const std::string& suffix) {
+        return arg.size() >= suffix.size() && arg.compare(arg.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (ends_with(".kgi")) {
+        return disassembleGridImage(arg);
+    }
+    if (ends_with(".kobj")) {
+        return disassembleObject(arg);
+    }
+    return disassembleText(arg);
+}
@@ -0,0 +1,281 @@
+#ifndef RISC_V_DISASSEMBLER_H
+#define RISC_V_DISASSEMBLER_H
+
+// Table-driven decoder for the words produced by RISC_V_Assembler, including
+// the psrf/ppsrf/corf/hwlrf extensions. It is driven by kEncodingTable, and
+// its operand text goes back through RISC_V_Assembler::encode, so
+// encode(decode(word)) == word holds for every word it accepts.
+
+#include "risc_v_assembler.h"
+#include "thread_pool.h"
+#include <array>
+#include <chrono>
+#include <random>
+
+class RISC_V_Disassembler {
+private:
+    static int32_t sign_extend(uint32_t value, int bits) {
+        uint32_t mask = 1u << (bits - 1);
+        value &= (1u << bits) - 1;
+        return int32_t((value ^ mask) - mask);
+    }
+
+    static std::string reg(char prefix, uint32_t number) {
+        return prefix + std::to_string(number);
+    }
+
+    // Entries sharing each 7-bit opcode, candidates for one word
+    static const std::vector<const EncodingEntry*>& candidates(uint32_t opcode) {
+        static const std::array<std::vector<const EncodingEntry*>, 128> index = []() {
+            std::array<std::vector<const EncodingEntry*>, 128> table;
+            for (const auto& entry : kEncodingTable) {
+                // ret, nop and halt are fixed words, which decode() handles up front
+                if (entry.format != EncodingFormat::Nop) {
+                    table[entry.opcode].push_back(&entry);
+                }
+            }
+            return table;
+        }();
+        return index[opcode & 0x7F];
+    }
+
+    static bool matches(const EncodingEntry& e, uint32_t funct3, uint32_t funct7) {
+        switch (e.format) {
+            case EncodingFormat::U:
+            case EncodingFormat::J:
+            case EncodingFormat::CorfLui:
+            case EncodingFormat::HwlrfLui:
+                return true;
+            case EncodingFormat::R:
+            case EncodingFormat::Shift:
+                return e.funct3 == funct3 && e.funct7 == funct7;
+            default:
+                return e.funct3 == funct3;
+        }
+    }
+
+public:
+    // Decode one word into its table entry and assembler operands. Returns
+    // false for words no table entry produces.
+    static bool decode(uint32_t word, const EncodingEntry*& entry, std::vector<std::string>& args) {
+        args.clear();
+        if (word == encode_i(0, 0, 0, 0, 0x13)) {
+            entry = RISC_V_Assembler::find_encoding("nop");
+            return true;
+        }
+        if (word == 0) {
+            entry = RISC_V_Assembler::find_encoding("halt");
+            return true;
+        }
+
+        uint32_t rd = (word >> 7) & 0x1F;
+        uint32_t funct3 = (word >> 12) & 0x7;
+        uint32_t rs1 = (word >> 15) & 0x1F;
+        uint32_t rs2 = (word >> 20) & 0x1F;
+        uint32_t funct7 = word >> 25;
+        entry = nullptr;
+        for (const EncodingEntry* candidate : candidates(word)) {
+            if (matches(*candidate, funct3, funct7)) {
+                entry = candidate;
+                break;
+            }
+        }
+        if (entry == nullptr) return false;
+
+        int32_t imm_i = sign_extend(word >> 20, 12);
+        int32_t imm_s = sign_extend(((word >> 25) << 5) | rd, 12);
+        int32_t imm_b = sign_extend((((word >> 31) & 0x1) << 12) | (((word >> 7) & 0x1) << 11) |
+                                    (((word >> 25) & 0x3F) << 5) | (((word >> 8) & 0xF) << 1), 13);
+        uint32_t imm_u = word >> 12;
+        // encode_j drops operand bit 11, the sign is repeated there
+        uint32_t j = (((word >> 31) & 0x1) << 20) | (((word >> 31) & 0x1) << 11) |
+                     (((word >> 12) & 0xFF) << 12) | (((word >> 20) & 0x1) << 10) | ((word >> 21) & 0x3FF);
+        int32_t imm_j = sign_extend(j, 21);
+
+        switch (entry->format) {
+            case EncodingFormat::R:
+                args = {reg('x', rd), reg('x', rs1), reg('x', rs2)};
+                return true;
+            case EncodingFormat::Shift:
+                args = {reg('x', rd), reg('x', rs1), std::to_string(rs2)};
+                return true;
+            case EncodingFormat::I:
+                args = {reg('x', rd), reg('x', rs1), std::to_string(imm_i)};
+                return true;
+            case EncodingFormat::Load:
+            case EncodingFormat::PsrfMem:
+                args = {reg('x', rd), std::to_string(imm_i) + "(" + reg('x', rs1) + ")"};
+                return true;
+            case EncodingFormat::S:
+                args = {reg('x', rs2), std::to_string(imm_s) + "(" + reg('x', rs1) + ")"};
+                return true;
+            case EncodingFormat::B:
+                args = {reg('x', rs1), reg('x', rs2), std::to_string(imm_b)};
+                return true;
+            case EncodingFormat::U:
+                args = {reg('x', rd), std::to_string(imm_u)};
+                return true;
+            case EncodingFormat::J:
+                args = {reg('x', rd), std::to_string(imm_j)};
+                return true;
+            case EncodingFormat::PpsrfAddi:
+                args = {reg('v', rd), reg('v', rs1), std::to_string(imm_i)};
+                return true;
+            case EncodingFormat::CorfAddi:
+                args = {reg('c', rd), reg('c', rs1), std::to_string(imm_i)};
+                return true;
+            case EncodingFormat::OffsAddi:
+                // The AGU has 16 offset registers, the assembler encodes other names as 0
+                if (rd > 15 || rs1 > 15) return false;
+                args = {reg('o', rd), reg('o', rs1), std::to_string(imm_i)};
+                return true;
+            case EncodingFormat::CorfLui:
+                args = {reg('c', rd), std::to_string(imm_u)};
+                return true;
+            case EncodingFormat::HwlrfAddi:
+                // Only L1..L7 exist, the assembler encodes other names as 0
+                if (rd > 7 || rs1 > 7) return false;
+                args = {reg('L', rd), reg('L', rs1), std::to_string(imm_i)};
+                return true;
+            case EncodingFormat::HwlrfLui:
+                if (rd > 7) return false;
+                args = {reg('L', rd), std::to_string(imm_u)};
+                return true;
+            case EncodingFormat::Delay:
+                // The cycle count is unsigned, rd and rs1 are always x0
+                if (rd != 0 || rs1 != 0) return false;
+                args = {std::to_string(word >> 20)};
+                return true;
+            case EncodingFormat::Nop:
+                return true;
+        }
+        return false;
+    }
+
+    // Assembly text of one word, ".word 0x..." if it does not decode
+    static std::string disassemble(uint32_t word) {
+        const EncodingEntry* entry;
+        std::vector<std::string> args;
+        if (!decode(word, entry, args)) {
+            return ".word 0x" + RISC_V_Assembler::to_hex(word);
+        }
+        std::string text = entry->mnemonic;
+        for (size_t i = 0; i < args.size(); i++) {
+            text += (i == 0 ? " " : ", ") + args[i];
+        }
+        return text;
+    }
+
+    // Fields of the hardware loop set by a hwlrf.lui/hwlrf.addi pair
+    static std::string describe_hardware_loop(uint32_t lui, uint32_t addi) {
+        uint32_t imm = (lui & 0xFFFFF000u) + uint32_t(sign_extend(addi >> 20, 12));
+        return "loop L" + std::to_string((lui >> 7) & 0x1F) + ": pc_start " + std::to_string(imm >> 23) +
+               ", length " + std::to_string((imm >> 17) & 0x3F) + ", hwl_index " +
+               std::to_string((imm >> 12) & 0x1F) + ", " + std::to_string(imm & 0xFFF) + " iterations";
+    }
+
+    struct VerifyResult {
+        uint64_t instructions = 0;  // Random operands encoded, decoded and encoded again
+        uint64_t words = 0;         // Random words that decoded
+        uint64_t mismatches = 0;
+        double seconds = 0;
+    };
+
+    // Round-trip fuzzing of the whole table. Every entry is encoded with random
+    // operands, decoded and encoded again, then random 32-bit words are
+    // decoded and re-encoded. Both must reproduce the word bit for bit. The
+    // count is split into chunks with their own seed, so the result does not
+    // depend on num_threads.
+    static VerifyResult verify(const RISC_V_Assembler& assembler, uint64_t count, uint32_t seed = 1,
+                               unsigned num_threads = 1) {
+        const uint64_t chunk_size = 1 << 16;
+        size_t chunks = (count + chunk_size - 1) / chunk_size;
+        std::vector<VerifyResult> results(chunks);
+        std::vector<std::vector<std::string>> messages(chunks);
+
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(chunks, num_threads, [&](size_t c) {
+            uint64_t first = c * chunk_size;
+            verify_chunk(assembler, first, std::min(count, first + chunk_size), seed, results[c], messages[c]);
+        });
+
+        VerifyResult result;
+        size_t printed = 0;
+        for (size_t c = 0; c < chunks; c++) {
+            result.instructions += results[c].instructions;
+            result.words += results[c].words;
+            result.mismatches += results[c].mismatches;
+            for (const auto& message : messages[c]) {
+                if (printed++ < 10) {
+                    std::cerr << message << std::endl;
+                }
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+private:
+    static void verify_chunk(const RISC_V_Assembler& assembler, uint64_t first, uint64_t last, uint32_t seed,
+                             VerifyResult& result, std::vector<std::string>& messages) {
+        std::seed_seq seeds{seed, uint32_t(first >> 32), uint32_t(first)};
+        std::mt19937 rng(seeds);
+        auto value = [&](int low, int high) {
+            return low + int(rng() % uint32_t(high - low + 1));
+        };
+        auto range = [&](int low, int high) {
+            return std::to_string(value(low, high));
+        };
+        auto report = [&](const std::string& what, uint32_t expected, uint32_t actual) {
+            if (result.mismatches++ < 10) {
+                messages.push_back("Mismatch: " + what + " 0x" + RISC_V_Assembler::to_hex(expected) + 
+                                   " -> 0x" + RISC_V_Assembler::to_hex(actual));
+            }
+        };
+
+        const size_t table_size = sizeof(kEncodingTable) / sizeof(kEncodingTable[0]);
+        std::vector<std::string> args, decoded;
+        for (uint64_t n = first; n < last; n++) {
+            const EncodingEntry& e = kEncodingTable[n % table_size];
+            std::string x1 = "x" + range(0, 31), x2 = "x" + range(0, 31), x3 = "x" + range(0, 31);
+            std::string imm12 = range(-2048, 2047);
+            switch (e.format) {
+                case EncodingFormat::R:         args = {x1, x2, x3}; break;
+                case EncodingFormat::Shift:     args = {x1, x2, range(0, 31)}; break;
+                case EncodingFormat::I:         args = {x1, x2, imm12}; break;
+                case EncodingFormat::Load:
+                case EncodingFormat::S:
+                case EncodingFormat::PsrfMem:   args = {x1, imm12 + "(" + x2 + ")"}; break;
+                case EncodingFormat::B:         args = {x1, x2, std::to_string(2 * value(-2048, 2047))}; break;
+                case EncodingFormat::U:         args = {x1, range(0, 0xFFFFF)}; break;
+                case EncodingFormat::J:         args = {x1, range(-(1 << 20), (1 << 20) - 1)}; break;
+                case EncodingFormat::PpsrfAddi: args = {"v" + range(0, 31), "v" + range(0, 31), imm12}; break;
+                case EncodingFormat::CorfAddi:  args = {"c" + range(0, 31), "c" + range(0, 31), imm12}; break;
+                case EncodingFormat::OffsAddi:  args = {"o" + range(0, 15), "o" + range(0, 15), imm12}; break;
+                case EncodingFormat::CorfLui:   args = {"c" + range(0, 31), range(0, 0xFFFFF)}; break;
+                case EncodingFormat::HwlrfAddi: args = {"L" + range(1, 7), "L" + range(1, 7), imm12}; break;
+                case EncodingFormat::HwlrfLui:  args = {"L" + range(1, 7), range(0, 0xFFFFF)}; break;
+                case EncodingFormat::Delay:     args = {range(0, 0xFFF)}; break;
+                case EncodingFormat::Nop:       args.clear(); break;
+            }
+
+            uint32_t word = 0, again = 0;
+            const EncodingEntry* entry;
+            if (!assembler.encode(e, args, word) || !decode(word, entry, decoded) ||
+                !assembler.encode(*entry, decoded, again) || again != word) {
+                report(e.mnemonic, word, again);
+            }
+            result.instructions++;
+
+            uint32_t random_word = rng();
+            if (decode(random_word, entry, decoded)) {
+                result.words++;
+                if (!assembler.encode(*entry, decoded, again) || again != random_word) {
+                    report(std::string("word ") + entry->mnemonic, random_word, again);
+                }
+            }
+        }
+    }
+};
+
+#endif // RISC_V_DISASSEMBLER_H
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// Number of workers used when the caller does not ask for a specific count
+inline unsigned defaultThreadCount() {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+// Run body(i) for every i in [0, count) on up to num_threads workers.
+// Workers pull indices from a shared counter, so uneven PE programs still
+// balance. Results must be written to per-index slots by the body, which keeps
+// the output independent of the scheduling order. The first exception thrown
+// by a body is rethrown on the calling thread after all workers joined.
+template <typename Body>
+void parallelFor(size_t count, unsigned num_threads, Body body) {
+    unsigned workers = std::min<size_t>(std::max(num_threads, 1u), count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (unsigned w = 0; w < workers; w++) {
+        pool.emplace_back([&]() {
+            for (size_t i = next++; i < count && !failed; i = next++) {
+                try {
+                    body(i);
+                } catch (...) {
+                    if (!failed.exchange(true)) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : pool) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // THREAD_POOL_H